@@ -0,0 +1,94 @@
+#include "config.h"
+
+#include "mnemo.h"
+
+#include <time.h>
+
+/* Compare the time spent by the thread generating accesses when it adds them
+ * inline to a reuse distance manager, and when it pushes them to an
+ * asynchronous front end, blocking or dropping when the ring is full.
+ *
+ * usage: async [accesses] [footprint]
+ */
+
+static double now(void)
+{
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+/* xorshift64*, good enough to generate a trace */
+static unsigned long long next(unsigned long long *state)
+{
+	unsigned long long x = *state;
+
+	x ^= x >> 12;
+	x ^= x << 25;
+	x ^= x >> 27;
+	*state = x;
+	return x * 0x2545F4914F6CDD1DULL;
+}
+
+static const struct {
+	const char *name;
+	enum mnemo_async_policy policy;
+} policies[] = {
+	{ "block", MNEMO_ASYNC_BLOCK },
+	{ "drop", MNEMO_ASYNC_DROP },
+};
+
+#define NPOLICIES (sizeof(policies) / sizeof(policies[0]))
+
+int main(int argc, char *argv[])
+{
+	size_t n = 10000000, footprint = 1000000;
+	unsigned long long *keys, state = 42;
+	struct mnemo_reusedm *r;
+	double start, t;
+
+	if (argc > 1)
+		n = strtoull(argv[1], NULL, 0);
+	if (argc > 2)
+		footprint = strtoull(argv[2], NULL, 0);
+	assert(footprint > 0);
+
+	keys = malloc(n * sizeof(*keys));
+	assert(keys != NULL);
+	for (size_t i = 0; i < n; i++)
+		keys[i] = (next(&state) % footprint) * 64;
+
+	printf("accesses: %zu, footprint: %zu\n", n, footprint);
+
+	r = mnemo_reusedm_init(0);
+	start = now();
+	for (size_t i = 0; i < n; i++)
+		mnemo_reusedm_add(r, keys[i]);
+	t = now() - start;
+	mnemo_reusedm_fini(r);
+	printf("inline: %.3f s, %.2f ns/access\n", t, t / n * 1e9);
+
+	for (size_t p = 0; p < NPOLICIES; p++) {
+		struct mnemo_reuse_async *a;
+		double t_push, t_total;
+		unsigned long long dropped;
+
+		r = mnemo_reusedm_init(0);
+		a = mnemo_reuse_async_init(r, 1 << 16, policies[p].policy);
+		start = now();
+		for (size_t i = 0; i < n; i++)
+			mnemo_reuse_async_push(a, keys[i]);
+		t_push = now() - start;
+		dropped = mnemo_reuse_async_dropped(a);
+		mnemo_reuse_async_fini(a);
+		t_total = now() - start;
+		mnemo_reusedm_fini(r);
+		printf("async, %s: push %.3f s, %.2f ns/access, total %.3f s,"
+		       " %llu dropped\n", policies[p].name, t_push,
+		       t_push / n * 1e9, t_total, dropped);
+	}
+
+	free(keys);
+	return 0;
+}
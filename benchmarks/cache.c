@@ -0,0 +1,104 @@
+#include "config.h"
+
+#include "mnemo.h"
+
+#include <time.h>
+
+/* Simulate typical L1 and L2 geometries with each replacement policy in a
+ * single pass, and report their miss ratios along with the one of a fully
+ * associative LRU cache of the same size, from reuse distances.
+ *
+ * usage: cache [accesses] [footprint]
+ */
+
+static double now(void)
+{
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+/* xorshift64*, good enough to generate a trace */
+static unsigned long long next(unsigned long long *state)
+{
+	unsigned long long x = *state;
+
+	x ^= x >> 12;
+	x ^= x << 25;
+	x ^= x >> 27;
+	*state = x;
+	return x * 0x2545F4914F6CDD1DULL;
+}
+
+static const char *policies[] = { "lru", "plru", "random" };
+
+static const struct mnemo_cache_config configs[] = {
+	{ 32768, 8, 64, MNEMO_CACHE_LRU },
+	{ 32768, 8, 64, MNEMO_CACHE_PLRU },
+	{ 32768, 8, 64, MNEMO_CACHE_RANDOM },
+	{ 1 << 20, 16, 64, MNEMO_CACHE_LRU },
+	{ 1 << 20, 16, 64, MNEMO_CACHE_PLRU },
+	{ 1 << 20, 16, 64, MNEMO_CACHE_RANDOM },
+};
+
+#define NCONFIGS (sizeof(configs) / sizeof(configs[0]))
+
+int main(int argc, char *argv[])
+{
+	size_t n = 10000000, footprint = 100000;
+	unsigned long long *addrs, *lines, state = 42;
+	struct mnemo_cache *c;
+	struct mnemo_reusedm *r;
+	int64_t *dist;
+	double start, t;
+
+	if (argc > 1)
+		n = strtoull(argv[1], NULL, 0);
+	if (argc > 2)
+		footprint = strtoull(argv[2], NULL, 0);
+	assert(footprint > 0);
+
+	/* random lines, and a strided stream conflicting on a few sets */
+	addrs = malloc(n * sizeof(*addrs));
+	lines = malloc(n * sizeof(*lines));
+	dist = malloc(n * sizeof(*dist));
+	assert(addrs != NULL && lines != NULL && dist != NULL);
+	for (size_t i = 0; i < n; i++) {
+		if (i % 4)
+			addrs[i] = (next(&state) % footprint) * 64;
+		else
+			addrs[i] = (i / 4 % 64) * 4096 + (1ULL << 40);
+		lines[i] = addrs[i] >> 6;
+	}
+
+	printf("accesses: %zu, footprint: %zu lines\n", n, footprint);
+
+	c = mnemo_cache_init(configs, NCONFIGS);
+	start = now();
+	mnemo_cache_add_batch(c, addrs, n, NULL);
+	t = now() - start;
+	printf("simulation: %.3f s, %.2f ns/access/config\n", t,
+	       t / n / NCONFIGS * 1e9);
+
+	r = mnemo_reusedm_init(0);
+	mnemo_reusedm_add_batch(r, lines, n, dist);
+	mnemo_reusedm_fini(r);
+
+	for (size_t k = 0; k < NCONFIGS; k++) {
+		unsigned long long capacity = configs[k].size / configs[k].line;
+		size_t fa = 0;
+
+		for (size_t i = 0; i < n; i++)
+			fa += dist[i] < 0 || (unsigned long long)dist[i] >= capacity;
+		printf("%llu KiB %u-way %s: miss ratio %.4f, fully associative LRU %.4f\n",
+		       configs[k].size >> 10, configs[k].assoc,
+		       policies[configs[k].policy],
+		       (double)mnemo_cache_misses(c, k) / n, (double)fa / n);
+	}
+	mnemo_cache_fini(c);
+	free(addrs);
+	free(lines);
+	free(dist);
+	return EXIT_SUCCESS;
+}
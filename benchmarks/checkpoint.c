@@ -0,0 +1,100 @@
+#include "config.h"
+
+#include "mnemo.h"
+
+#include <time.h>
+
+/* Compare the time to save and restore the state of a reuse distance manager
+ * with the time to build it again by replaying its trace, for each engine, and
+ * check that the restored manager gives the same distances.
+ *
+ * usage: checkpoint [accesses] [footprint] [path]
+ */
+
+static double now(void)
+{
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+/* xorshift64*, good enough to generate a trace */
+static unsigned long long next(unsigned long long *state)
+{
+	unsigned long long x = *state;
+
+	x ^= x >> 12;
+	x ^= x << 25;
+	x ^= x >> 27;
+	*state = x;
+	return x * 0x2545F4914F6CDD1DULL;
+}
+
+/* number of accesses added after the restore, to compare distances */
+#define CHECK 100000
+
+int main(int argc, char *argv[])
+{
+	size_t n = 10000000, footprint = 1000000;
+	const char *path = "checkpoint.bin";
+	unsigned long long *keys, state = 42;
+	int64_t *a, *b;
+	const char *names[] = { "splay", "fenwick", "approx" };
+	double start, replay, save, load;
+
+	if (argc > 1)
+		n = strtoull(argv[1], NULL, 0);
+	if (argc > 2)
+		footprint = strtoull(argv[2], NULL, 0);
+	if (argc > 3)
+		path = argv[3];
+	assert(footprint > 0);
+
+	keys = malloc((n + CHECK) * sizeof(*keys));
+	a = malloc(CHECK * sizeof(*a));
+	b = malloc(CHECK * sizeof(*b));
+	assert(keys != NULL && a != NULL && b != NULL);
+	for (size_t i = 0; i < n + CHECK; i++)
+		keys[i] = next(&state) % footprint;
+
+	printf("accesses: %zu, footprint: %zu\n", n, footprint);
+	for (int e = MNEMO_REUSE_SPLAY; e <= MNEMO_REUSE_APPROX; e++) {
+		struct mnemo_reusedm *r, *restored;
+		size_t diff = 0;
+		int err;
+
+		r = mnemo_reusedm_init_engine(0, e);
+		start = now();
+		mnemo_reusedm_add_batch(r, keys, n, NULL);
+		replay = now() - start;
+		start = now();
+		err = mnemo_reusedm_save(r, path);
+		save = now() - start;
+		if (err != 0) {
+			fprintf(stderr, "save: %s\n", strerror(-err));
+			return EXIT_FAILURE;
+		}
+		start = now();
+		restored = mnemo_reusedm_load(path);
+		load = now() - start;
+		if (restored == NULL) {
+			perror("load");
+			return EXIT_FAILURE;
+		}
+		mnemo_reusedm_add_batch(r, &keys[n], CHECK, a);
+		mnemo_reusedm_add_batch(restored, &keys[n], CHECK, b);
+		for (size_t i = 0; i < CHECK; i++)
+			diff += a[i] != b[i];
+		printf("%s: replay %.3f s, save %.3f s, load %.3f s, %zu "
+		       "different distances\n", names[e], replay, save, load,
+		       diff);
+		mnemo_reusedm_fini(r);
+		mnemo_reusedm_fini(restored);
+	}
+	unlink(path);
+	free(keys);
+	free(a);
+	free(b);
+	return EXIT_SUCCESS;
+}
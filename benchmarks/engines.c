@@ -0,0 +1,102 @@
+#include "config.h"
+
+#include "mnemo.h"
+
+#include <time.h>
+
+/* Compare the throughput of the reuse distance engines on synthetic traces of
+ * increasing footprint.
+ *
+ * usage: engines [accesses] [max footprint]
+ */
+
+static double now(void)
+{
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+/* xorshift64*, good enough to generate a trace */
+static unsigned long long next(unsigned long long *state)
+{
+	unsigned long long x = *state;
+
+	x ^= x >> 12;
+	x ^= x << 25;
+	x ^= x >> 27;
+	*state = x;
+	return x * 0x2545F4914F6CDD1DULL;
+}
+
+static const struct {
+	const char *name;
+	enum mnemo_reuse_engine engine;
+	/* allowed relative error on the distances */
+	double error;
+} engines[] = {
+	{ "splay", MNEMO_REUSE_SPLAY, 0 },
+	{ "fenwick", MNEMO_REUSE_FENWICK, 0 },
+	{ "approx", MNEMO_REUSE_APPROX, MNEMO_REUSE_APPROX_ERROR },
+};
+
+#define NENGINES (sizeof(engines) / sizeof(engines[0]))
+
+int main(int argc, char *argv[])
+{
+	size_t n = 4000000, maxfootprint = 1000000;
+	unsigned long long *keys, state = 42;
+	int64_t *out, *ref;
+
+	if (argc > 1)
+		n = strtoull(argv[1], NULL, 0);
+	if (argc > 2)
+		maxfootprint = strtoull(argv[2], NULL, 0);
+
+	keys = malloc(n * sizeof(*keys));
+	out = malloc(n * sizeof(*out));
+	ref = malloc(n * sizeof(*ref));
+	assert(keys != NULL && out != NULL && ref != NULL);
+
+	printf("%12s", "footprint");
+	for (size_t e = 0; e < NENGINES; e++)
+		printf(" %10s", engines[e].name);
+	printf("   (Macc/s, %zu accesses)\n", n);
+
+	for (size_t footprint = 1000; footprint <= maxfootprint;
+	     footprint *= 10) {
+		for (size_t i = 0; i < n; i++)
+			keys[i] = (next(&state) % footprint) * 64;
+
+		printf("%12zu", footprint);
+		for (size_t e = 0; e < NENGINES; e++) {
+			struct mnemo_reusedm *r;
+			double start, t;
+
+			r = mnemo_reusedm_init_engine(0, engines[e].engine);
+			start = now();
+			mnemo_reusedm_add_batch(r, keys, n, e ? out : ref);
+			t = now() - start;
+			mnemo_reusedm_fini(r);
+			printf(" %10.2f", n / t / 1e6);
+			fflush(stdout);
+
+			/* all engines must agree with the first one, within
+			 * their error bound.
+			 */
+			for (size_t i = 0; e && i < n; i++) {
+				double d = llabs(out[i] - ref[i]);
+
+				assert((out[i] < 0) == (ref[i] < 0));
+				assert(ref[i] < 0 || d <= engines[e].error * ref[i]);
+			}
+		}
+		printf("\n");
+	}
+
+	free(keys);
+	free(out);
+	free(ref);
+	return 0;
+}
@@ -0,0 +1,94 @@
+#include "config.h"
+
+#include "mnemo.h"
+
+#include <time.h>
+
+/* Compare computing reuse distances at cache line, page and huge page
+ * granularity with one reuse distance manager per granularity, each replaying
+ * the trace, and with a single multi-granularity manager.
+ *
+ * usage: granularity [accesses] [footprint]
+ */
+
+static double now(void)
+{
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+/* xorshift64*, good enough to generate a trace */
+static unsigned long long next(unsigned long long *state)
+{
+	unsigned long long x = *state;
+
+	x ^= x >> 12;
+	x ^= x << 25;
+	x ^= x >> 27;
+	*state = x;
+	return x * 0x2545F4914F6CDD1DULL;
+}
+
+static const unsigned int shifts[] = { 6, 12, 21 };
+
+#define NLEVELS (sizeof(shifts) / sizeof(shifts[0]))
+
+int main(int argc, char *argv[])
+{
+	size_t n = 10000000, footprint = 1000000;
+	unsigned long long *addrs, *keys, state = 42;
+	struct mnemo_reuse_gran *g;
+	int64_t *out, *ref;
+	double start, t;
+
+	if (argc > 1)
+		n = strtoull(argv[1], NULL, 0);
+	if (argc > 2)
+		footprint = strtoull(argv[2], NULL, 0);
+	assert(footprint > 0);
+
+	/* sequential 8-byte accesses, with a random cache line every 16 */
+	addrs = malloc(n * sizeof(*addrs));
+	keys = malloc(n * sizeof(*keys));
+	out = malloc(NLEVELS * n * sizeof(*out));
+	ref = malloc(n * sizeof(*ref));
+	assert(addrs != NULL && keys != NULL && out != NULL && ref != NULL);
+	for (size_t i = 0; i < n; i++) {
+		if (i % 16)
+			addrs[i] = (i % (footprint * 8)) * 8;
+		else
+			addrs[i] = (next(&state) % footprint) * 64 + (1ULL << 40);
+	}
+
+	printf("accesses: %zu, footprint: %zu\n", n, footprint);
+
+	start = now();
+	for (size_t l = 0; l < NLEVELS; l++) {
+		struct mnemo_reusedm *r = mnemo_reusedm_init(0);
+
+		for (size_t i = 0; i < n; i++)
+			keys[i] = addrs[i] >> shifts[l];
+		mnemo_reusedm_add_batch(r, keys, n, &out[l * n]);
+		mnemo_reusedm_fini(r);
+	}
+	t = now() - start;
+	printf("separate: %.3f s, %.2f ns/access\n", t, t / n * 1e9);
+
+	memcpy(ref, out, n * sizeof(*out));
+	g = mnemo_reuse_gran_init(0, MNEMO_REUSE_SPLAY, shifts, NLEVELS);
+	start = now();
+	mnemo_reuse_gran_add_batch(g, addrs, n, out);
+	t = now() - start;
+	mnemo_reuse_gran_fini(g);
+	printf("multi-granularity: %.3f s, %.2f ns/access\n", t, t / n * 1e9);
+
+	/* check the finest level against the first run */
+	assert(!memcmp(ref, out, n * sizeof(*out)));
+	free(addrs);
+	free(keys);
+	free(out);
+	free(ref);
+	return EXIT_SUCCESS;
+}
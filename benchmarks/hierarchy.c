@@ -0,0 +1,99 @@
+#include "config.h"
+
+#include "mnemo.h"
+
+#include <time.h>
+
+/* Simulate an L1/L2/L3 hierarchy and a two level TLB in one pass, with
+ * accesses fed one at a time and by batch, and report the counters of each
+ * level for a range holding half of the footprint.
+ *
+ * usage: hierarchy [accesses] [footprint]
+ */
+
+static double now(void)
+{
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+/* xorshift64*, good enough to generate a trace */
+static unsigned long long next(unsigned long long *state)
+{
+	unsigned long long x = *state;
+
+	x ^= x >> 12;
+	x ^= x << 25;
+	x ^= x >> 27;
+	*state = x;
+	return x * 0x2545F4914F6CDD1DULL;
+}
+
+static const char *names[] = { "L1", "L2", "L3", "DTLB", "STLB" };
+
+static const struct mnemo_hierarchy_level levels[] = {
+	{ { 32768, 8, 64, MNEMO_CACHE_PLRU }, MNEMO_INCLUSION_NINE,
+		MNEMO_HIERARCHY_TOP },
+	{ { 1 << 20, 16, 64, MNEMO_CACHE_PLRU }, MNEMO_INCLUSION_NINE, 0 },
+	{ { 8 << 20, 16, 64, MNEMO_CACHE_LRU }, MNEMO_INCLUSION_EXCLUSIVE, 1 },
+	{ { 64 * 4096, 4, 4096, MNEMO_CACHE_LRU }, MNEMO_INCLUSION_NINE,
+		MNEMO_HIERARCHY_TOP },
+	{ { 1536 * 4096, 12, 4096, MNEMO_CACHE_LRU }, MNEMO_INCLUSION_NINE, 3 },
+};
+
+#define NLEVELS (sizeof(levels) / sizeof(levels[0]))
+
+int main(int argc, char *argv[])
+{
+	size_t n = 10000000, footprint = 1000000;
+	unsigned long long *addrs, state = 42;
+	struct mnemo_hierarchy *h;
+	struct mnemo_range range;
+	double start, t;
+
+	if (argc > 1)
+		n = strtoull(argv[1], NULL, 0);
+	if (argc > 2)
+		footprint = strtoull(argv[2], NULL, 0);
+	assert(footprint > 1);
+
+	/* a hot 1/256th of the footprint gets 3/4 of the accesses */
+	addrs = malloc(n * sizeof(*addrs));
+	assert(addrs != NULL);
+	for (size_t i = 0; i < n; i++) {
+		size_t bound = i % 4 ? footprint / 256 + 1 : footprint;
+
+		addrs[i] = (next(&state) % bound) * 64;
+	}
+	range.start = 0;
+	range.end = footprint / 2 * 64;
+
+	printf("accesses: %zu, footprint: %zu lines\n", n, footprint);
+
+	h = mnemo_hierarchy_init(levels, NLEVELS, &range, 1);
+	start = now();
+	for (size_t i = 0; i < n; i++)
+		mnemo_hierarchy_add(h, addrs[i]);
+	t = now() - start;
+	printf("one at a time: %.3f s, %.2f ns/access\n", t, t / n * 1e9);
+
+	mnemo_hierarchy_reset(h);
+	start = now();
+	mnemo_hierarchy_add_batch(h, addrs, n);
+	t = now() - start;
+	printf("batch: %.3f s, %.2f ns/access\n", t, t / n * 1e9);
+
+	for (size_t l = 0; l < NLEVELS; l++) {
+		struct mnemo_cache_stats all, low;
+
+		all = mnemo_hierarchy_stats(h, l, MNEMO_HIERARCHY_ALL);
+		low = mnemo_hierarchy_stats(h, l, 0);
+		printf("%s: %llu hits, %llu misses, lower half %llu hits, %llu misses\n",
+		       names[l], all.hits, all.misses, low.hits, low.misses);
+	}
+	mnemo_hierarchy_fini(h);
+	free(addrs);
+	return EXIT_SUCCESS;
+}
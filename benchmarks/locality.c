@@ -0,0 +1,91 @@
+#include "config.h"
+
+#include "mnemo.h"
+
+#include <time.h>
+
+/* Compare the time per access of the locality engine, which only computes
+ * reuse times, with the fastest exact reuse distance engine, and the miss ratio
+ * curve predicted from the average footprint with the one from reuse distances.
+ *
+ * usage: locality [accesses] [footprint]
+ */
+
+static double now(void)
+{
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+/* xorshift64*, good enough to generate a trace */
+static unsigned long long next(unsigned long long *state)
+{
+	unsigned long long x = *state;
+
+	x ^= x >> 12;
+	x ^= x << 25;
+	x ^= x >> 27;
+	*state = x;
+	return x * 0x2545F4914F6CDD1DULL;
+}
+
+#define NSIZES 6
+
+int main(int argc, char *argv[])
+{
+	size_t n = 10000000, footprint = 1000000;
+	unsigned long long *keys, state = 42, sizes[NSIZES];
+	struct mnemo_locality *l;
+	struct mnemo_reusedm *r;
+	struct mnemo_histogram *h;
+	double start, t, hotl[NSIZES], lru[NSIZES];
+
+	if (argc > 1)
+		n = strtoull(argv[1], NULL, 0);
+	if (argc > 2)
+		footprint = strtoull(argv[2], NULL, 0);
+	assert(footprint > 0);
+
+	/* a hot tenth of the footprint gets half of the accesses */
+	keys = malloc(n * sizeof(*keys));
+	assert(keys != NULL);
+	for (size_t i = 0; i < n; i++) {
+		size_t bound = i % 2 ? footprint : footprint / 10 + 1;
+
+		keys[i] = next(&state) % bound;
+	}
+	for (size_t i = 0; i < NSIZES; i++)
+		sizes[i] = footprint / 64 << i;
+
+	printf("accesses: %zu, footprint: %zu\n", n, footprint);
+
+	l = mnemo_locality_init(0);
+	start = now();
+	mnemo_locality_add_batch(l, keys, n, NULL);
+	t = now() - start;
+	printf("locality: %.3f s, %.2f ns/access\n", t, t / n * 1e9);
+	start = now();
+	mnemo_locality_mrc(l, sizes, NSIZES, hotl);
+	t = now() - start;
+	printf("footprint mrc: %.3f ms\n", t * 1e3);
+	mnemo_locality_fini(l);
+
+	h = mnemo_histogram_init(MNEMO_HISTOGRAM_LINEAR, footprint / 64 + 1,
+				 64);
+	r = mnemo_reusedm_init_engine(0, MNEMO_REUSE_FENWICK);
+	mnemo_reusedm_attach(r, h);
+	start = now();
+	mnemo_reusedm_add_batch(r, keys, n, NULL);
+	t = now() - start;
+	mnemo_reusedm_fini(r);
+	printf("fenwick: %.3f s, %.2f ns/access\n", t, t / n * 1e9);
+	mnemo_histogram_mrc(h, sizes, NSIZES, lru);
+	for (size_t i = 0; i < NSIZES; i++)
+		printf("size %llu: footprint %.4f, reuse distance %.4f\n",
+		       sizes[i], hotl[i], lru[i]);
+	mnemo_histogram_fini(h);
+	free(keys);
+	return EXIT_SUCCESS;
+}
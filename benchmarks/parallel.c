@@ -0,0 +1,86 @@
+#include "config.h"
+
+#include "mnemo.h"
+
+#include <time.h>
+
+/* Compare the throughput of the parallel batch interface at increasing thread
+ * counts against the sequential one, on a synthetic trace with some locality.
+ *
+ * usage: parallel [accesses] [footprint] [max threads]
+ */
+
+static double now(void)
+{
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+/* xorshift64*, good enough to generate a trace */
+static unsigned long long next(unsigned long long *state)
+{
+	unsigned long long x = *state;
+
+	x ^= x >> 12;
+	x ^= x << 25;
+	x ^= x >> 27;
+	*state = x;
+	return x * 0x2545F4914F6CDD1DULL;
+}
+
+int main(int argc, char *argv[])
+{
+	size_t n = 20000000, footprint = 100000;
+	unsigned int maxthreads = 8;
+	unsigned long long *keys, state = 42;
+	int64_t *ref, *out;
+	struct mnemo_reusedm *r;
+	double start, t;
+
+	if (argc > 1)
+		n = strtoull(argv[1], NULL, 0);
+	if (argc > 2)
+		footprint = strtoull(argv[2], NULL, 0);
+	if (argc > 3)
+		maxthreads = strtoul(argv[3], NULL, 0);
+	assert(footprint > 0);
+
+	keys = malloc(n * sizeof(*keys));
+	ref = malloc(n * sizeof(*ref));
+	out = malloc(n * sizeof(*out));
+	assert(keys != NULL && ref != NULL && out != NULL);
+
+	/* a working set sliding over the footprint: chunks of the trace reuse
+	 * most of their keys.
+	 */
+	for (size_t i = 0; i < n; i++)
+		keys[i] = ((i / 64 + next(&state) % 4096) % footprint) * 64;
+
+	r = mnemo_reusedm_init_engine(0, MNEMO_REUSE_FENWICK);
+	start = now();
+	mnemo_reusedm_add_batch(r, keys, n, ref);
+	t = now() - start;
+	mnemo_reusedm_fini(r);
+
+	printf("accesses: %zu, footprint: %zu\n", n, footprint);
+	printf("batch: %.3f s, %.2f Macc/s\n", t, n / t / 1e6);
+	for (unsigned int threads = 1; threads <= maxthreads; threads *= 2) {
+		r = mnemo_reusedm_init_engine(0, MNEMO_REUSE_FENWICK);
+		start = now();
+		mnemo_reusedm_add_parallel(r, keys, n, out, threads);
+		t = now() - start;
+		mnemo_reusedm_fini(r);
+
+		for (size_t i = 0; i < n; i++)
+			assert(out[i] == ref[i]);
+		printf("parallel, %u threads: %.3f s, %.2f Macc/s\n", threads,
+		       t, n / t / 1e6);
+	}
+
+	free(keys);
+	free(ref);
+	free(out);
+	return 0;
+}
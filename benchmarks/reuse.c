@@ -0,0 +1,94 @@
+#include "config.h"
+
+#include "mnemo.h"
+
+#include <time.h>
+
+/* Compare the throughput of the single key and the batch interfaces of the
+ * reuse distance manager on a synthetic trace, and of the batch interface on a
+ * manager presized for the footprint of the trace.
+ *
+ * usage: reuse [accesses] [footprint]
+ */
+
+static double now(void)
+{
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+/* xorshift64*, good enough to generate a trace */
+static unsigned long long next(unsigned long long *state)
+{
+	unsigned long long x = *state;
+
+	x ^= x >> 12;
+	x ^= x << 25;
+	x ^= x >> 27;
+	*state = x;
+	return x * 0x2545F4914F6CDD1DULL;
+}
+
+int main(int argc, char *argv[])
+{
+	size_t n = 10000000, footprint = 1000000;
+	unsigned long long *keys, state = 42;
+	int64_t *single, *batch;
+	struct mnemo_reusedm *r;
+	double start, t_single, t_batch, t_presized;
+
+	if (argc > 1)
+		n = strtoull(argv[1], NULL, 0);
+	if (argc > 2)
+		footprint = strtoull(argv[2], NULL, 0);
+	assert(footprint > 0);
+
+	keys = malloc(n * sizeof(*keys));
+	single = malloc(n * sizeof(*single));
+	batch = malloc(n * sizeof(*batch));
+	assert(keys != NULL && single != NULL && batch != NULL);
+
+	/* keys are spread over the address space, like cache lines of a
+	 * scattered working set.
+	 */
+	for (size_t i = 0; i < n; i++)
+		keys[i] = (next(&state) % footprint) * 64;
+
+	r = mnemo_reusedm_init(0);
+	start = now();
+	for (size_t i = 0; i < n; i++)
+		single[i] = mnemo_reusedm_add(r, keys[i]);
+	t_single = now() - start;
+	mnemo_reusedm_fini(r);
+
+	r = mnemo_reusedm_init(0);
+	start = now();
+	mnemo_reusedm_add_batch(r, keys, n, batch);
+	t_batch = now() - start;
+	mnemo_reusedm_fini(r);
+
+	for (size_t i = 0; i < n; i++)
+		assert(single[i] == batch[i]);
+
+	r = mnemo_reusedm_init(footprint);
+	start = now();
+	mnemo_reusedm_add_batch(r, keys, n, batch);
+	t_presized = now() - start;
+	mnemo_reusedm_fini(r);
+
+	for (size_t i = 0; i < n; i++)
+		assert(single[i] == batch[i]);
+
+	printf("accesses: %zu, footprint: %zu\n", n, footprint);
+	printf("single: %.3f s, %.2f Macc/s\n", t_single, n / t_single / 1e6);
+	printf("batch:  %.3f s, %.2f Macc/s\n", t_batch, n / t_batch / 1e6);
+	printf("batch, presized: %.3f s, %.2f Macc/s\n", t_presized,
+	       n / t_presized / 1e6);
+
+	free(keys);
+	free(single);
+	free(batch);
+	return 0;
+}
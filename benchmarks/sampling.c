@@ -0,0 +1,90 @@
+#include "config.h"
+
+#include "mnemo.h"
+
+#include <time.h>
+
+/* Compare the throughput of sampled reuse distance managers at decreasing
+ * rates, and of a fixed-size sampler, against the full trace.
+ *
+ * usage: sampling [accesses] [footprint]
+ */
+
+static double now(void)
+{
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+/* xorshift64*, good enough to generate a trace */
+static unsigned long long next(unsigned long long *state)
+{
+	unsigned long long x = *state;
+
+	x ^= x >> 12;
+	x ^= x << 25;
+	x ^= x >> 27;
+	*state = x;
+	return x * 0x2545F4914F6CDD1DULL;
+}
+
+static const struct {
+	double rate;
+	size_t smax;
+} samplers[] = {
+	{ 1.0, 0 },
+	{ 0.1, 0 },
+	{ 0.01, 0 },
+	{ 0.001, 0 },
+	{ 1.0, 8192 },
+};
+
+#define NSAMPLERS (sizeof(samplers) / sizeof(samplers[0]))
+
+int main(int argc, char *argv[])
+{
+	size_t n = 10000000, footprint = 1000000;
+	unsigned long long *keys, state = 42;
+	int64_t *out;
+
+	if (argc > 1)
+		n = strtoull(argv[1], NULL, 0);
+	if (argc > 2)
+		footprint = strtoull(argv[2], NULL, 0);
+	assert(footprint > 0);
+
+	keys = malloc(n * sizeof(*keys));
+	out = malloc(n * sizeof(*out));
+	assert(keys != NULL && out != NULL);
+
+	for (size_t i = 0; i < n; i++)
+		keys[i] = (next(&state) % footprint) * 64;
+
+	printf("accesses: %zu, footprint: %zu\n", n, footprint);
+	for (size_t s = 0; s < NSAMPLERS; s++) {
+		struct mnemo_reusedm *r;
+		size_t tracked = 0;
+		double start, t;
+
+		r = mnemo_reusedm_init_sampled(0, MNEMO_REUSE_FENWICK,
+					       samplers[s].rate,
+					       samplers[s].smax);
+		start = now();
+		mnemo_reusedm_add_batch(r, keys, n, out);
+		t = now() - start;
+
+		for (size_t i = 0; i < n; i++)
+			tracked += out[i] != MNEMO_REUSE_SKIPPED;
+		printf("rate %g, max %zu keys: %.3f s, %.2f Macc/s, final rate %g,"
+		       " %zu accesses tracked\n", samplers[s].rate,
+		       samplers[s].smax, t, n / t / 1e6, mnemo_reusedm_rate(r),
+		       tracked);
+		mnemo_reusedm_fini(r);
+	}
+
+	free(keys);
+	free(out);
+	return 0;
+}
@@ -0,0 +1,143 @@
+#include "config.h"
+
+#include "mnemo.h"
+
+#include <sys/wait.h>
+#include <time.h>
+
+/* Split a trace among several processes, each summarizing a segment of it to
+ * a file, and merge the segments in trace order. The merged histogram is
+ * compared to the one of a single replay of the trace.
+ *
+ * usage: segment [accesses] [footprint] [processes] [directory]
+ */
+
+static double now(void)
+{
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+/* xorshift64*, good enough to generate a trace */
+static unsigned long long next(unsigned long long *state)
+{
+	unsigned long long x = *state;
+
+	x ^= x >> 12;
+	x ^= x << 25;
+	x ^= x >> 27;
+	*state = x;
+	return x * 0x2545F4914F6CDD1DULL;
+}
+
+#define NBINS 40
+
+int main(int argc, char *argv[])
+{
+	size_t n = 10000000, footprint = 1000000, nprocs = 4;
+	const char *dir = ".";
+	unsigned long long *keys, state = 42;
+	struct mnemo_reusedm *r;
+	struct mnemo_histogram *h;
+	struct mnemo_segment *merged = NULL;
+	const struct mnemo_histogram *m;
+	char path[4096];
+	double start, t, diff = 0.0;
+
+	if (argc > 1)
+		n = strtoull(argv[1], NULL, 0);
+	if (argc > 2)
+		footprint = strtoull(argv[2], NULL, 0);
+	if (argc > 3)
+		nprocs = strtoull(argv[3], NULL, 0);
+	if (argc > 4)
+		dir = argv[4];
+	assert(footprint > 0 && nprocs > 0);
+
+	/* a hot tenth of the footprint gets half of the accesses */
+	keys = malloc(n * sizeof(*keys));
+	assert(keys != NULL);
+	for (size_t i = 0; i < n; i++) {
+		size_t bound = i % 2 ? footprint : footprint / 10 + 1;
+
+		keys[i] = next(&state) % bound;
+	}
+	printf("accesses: %zu, footprint: %zu, processes: %zu\n", n, footprint,
+	       nprocs);
+
+	h = mnemo_histogram_init(MNEMO_HISTOGRAM_LOG2, NBINS, 0);
+	r = mnemo_reusedm_init_engine(0, MNEMO_REUSE_FENWICK);
+	mnemo_reusedm_attach(r, h);
+	start = now();
+	mnemo_reusedm_add_batch(r, keys, n, NULL);
+	t = now() - start;
+	mnemo_reusedm_fini(r);
+	printf("single replay: %.3f s\n", t);
+
+	start = now();
+	for (size_t p = 0; p < nprocs; p++) {
+		size_t first = p * (n / nprocs);
+		size_t end = p + 1 == nprocs ? n : first + n / nprocs;
+		struct mnemo_segment *s;
+		pid_t pid = fork();
+
+		assert(pid != -1);
+		if (pid != 0)
+			continue;
+		s = mnemo_segment_init(0, MNEMO_HISTOGRAM_LOG2, NBINS, 0);
+		mnemo_segment_add_batch(s, &keys[first], end - first);
+		snprintf(path, sizeof(path), "%s/segment.%zu", dir, p);
+		if (mnemo_segment_save(s, path) != 0)
+			_exit(EXIT_FAILURE);
+		mnemo_segment_fini(s);
+		_exit(EXIT_SUCCESS);
+	}
+	for (size_t p = 0; p < nprocs; p++) {
+		int status;
+
+		wait(&status);
+		if (!WIFEXITED(status) || WEXITSTATUS(status) != 0) {
+			fprintf(stderr, "a segment failed\n");
+			return EXIT_FAILURE;
+		}
+	}
+	t = now() - start;
+	printf("segments: %.3f s\n", t);
+
+	start = now();
+	for (size_t p = 0; p < nprocs; p++) {
+		struct mnemo_segment *s;
+
+		snprintf(path, sizeof(path), "%s/segment.%zu", dir, p);
+		s = mnemo_segment_load(path);
+		if (s == NULL) {
+			perror(path);
+			return EXIT_FAILURE;
+		}
+		unlink(path);
+		if (merged == NULL) {
+			merged = s;
+			continue;
+		}
+		mnemo_segment_merge(merged, s);
+		mnemo_segment_fini(s);
+	}
+	t = now() - start;
+	printf("load and merge: %.3f s\n", t);
+
+	m = mnemo_segment_histogram(merged);
+	for (size_t i = 0; i <= NBINS; i++) {
+		double d = i < NBINS ? mnemo_histogram_bins(m)[i] -
+			mnemo_histogram_bins(h)[i] :
+			mnemo_histogram_cold(m) - mnemo_histogram_cold(h);
+
+		diff += d > 0 ? d : -d;
+	}
+	printf("difference with the single replay: %g accesses\n", diff);
+	mnemo_segment_fini(merged);
+	mnemo_histogram_fini(h);
+	free(keys);
+	return EXIT_SUCCESS;
+}
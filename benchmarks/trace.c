@@ -0,0 +1,155 @@
+#include "config.h"
+
+#include "mnemo.h"
+
+#include <sys/stat.h>
+#include <time.h>
+
+/* Compare a raw and a compressed trace of the same accesses: size on disk,
+ * time to decode all the blocks, and time to add the trace to a reuse distance
+ * manager. The trace interleaves a sequential stream, a strided stream and
+ * random accesses, all at cache line granularity.
+ *
+ * usage: trace [accesses] [footprint]
+ */
+
+#define RAW_PATH "trace-bench.raw"
+#define COMPRESSED_PATH "trace-bench.mtr"
+
+static double now(void)
+{
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+/* xorshift64*, good enough to generate a trace */
+static unsigned long long next(unsigned long long *state)
+{
+	unsigned long long x = *state;
+
+	x ^= x >> 12;
+	x ^= x << 25;
+	x ^= x >> 27;
+	*state = x;
+	return x * 0x2545F4914F6CDD1DULL;
+}
+
+static int run(const char *name, const char *path, size_t n)
+{
+	struct mnemo_trace *t;
+	struct mnemo_reusedm *r;
+	unsigned long long *keys;
+	struct stat st;
+	double start, t_decode, t_reuse;
+	int err = 0;
+
+	t = mnemo_trace_open(path);
+	if (t == NULL) {
+		perror(path);
+		return -1;
+	}
+	assert(mnemo_trace_length(t) == n);
+	stat(path, &st);
+	keys = malloc(mnemo_trace_block_length(t, 0) * sizeof(*keys));
+	assert(keys != NULL);
+	start = now();
+	for (size_t b = 0; b < mnemo_trace_nblocks(t) && err == 0; b++)
+		err = mnemo_trace_decode(t, b, keys);
+	t_decode = now() - start;
+	free(keys);
+	mnemo_trace_close(t);
+	if (err != 0) {
+		fprintf(stderr, "%s: decode: %s\n", path, strerror(-err));
+		return -1;
+	}
+
+	/* reopen, pages of raw traces are dropped as they are processed */
+	t = mnemo_trace_open(path);
+	if (t == NULL) {
+		perror(path);
+		return -1;
+	}
+	r = mnemo_reusedm_init_engine(0, MNEMO_REUSE_FENWICK);
+	start = now();
+	err = mnemo_reuse_from_trace(r, t, NULL);
+	t_reuse = now() - start;
+	mnemo_reusedm_fini(r);
+	mnemo_trace_close(t);
+	if (err != 0) {
+		fprintf(stderr, "%s: reuse: %s\n", path, strerror(-err));
+		return -1;
+	}
+	printf("%s: %.2f bytes/access, decode %.2f ns/access, reuse %.2f ns/access\n",
+	       name, (double)st.st_size / n, t_decode / n * 1e9,
+	       t_reuse / n * 1e9);
+	return 0;
+}
+
+int main(int argc, char *argv[])
+{
+	size_t n = 10000000, footprint = 1000000;
+	unsigned long long *keys, state = 42;
+	struct mnemo_trace_writer *w;
+	size_t written;
+	FILE *f;
+	int err;
+
+	if (argc > 1)
+		n = strtoull(argv[1], NULL, 0);
+	if (argc > 2)
+		footprint = strtoull(argv[2], NULL, 0);
+	assert(n > 0 && footprint > 0);
+
+	keys = malloc(n * sizeof(*keys));
+	assert(keys != NULL);
+	for (size_t i = 0; i < n; i++) {
+		switch (i % 3) {
+		case 0:
+			keys[i] = 0x7f0000000000ULL + (i / 3 % footprint) * 64;
+			break;
+		case 1:
+			keys[i] = 0x600000ULL + (i * 7 % footprint) * 4096;
+			break;
+		default:
+			keys[i] = (next(&state) % footprint) * 64;
+		}
+	}
+
+	printf("accesses: %zu, footprint: %zu\n", n, footprint);
+
+	/* little-endian hosts only, the raw format is the native array */
+	f = fopen(RAW_PATH, "wb");
+	if (f == NULL) {
+		perror(RAW_PATH);
+		return EXIT_FAILURE;
+	}
+	written = fwrite(keys, sizeof(*keys), n, f);
+	if (fclose(f) != 0 || written != n) {
+		perror(RAW_PATH);
+		return EXIT_FAILURE;
+	}
+	w = mnemo_trace_writer_open(COMPRESSED_PATH, 0);
+	if (w == NULL) {
+		perror(COMPRESSED_PATH);
+		return EXIT_FAILURE;
+	}
+	err = mnemo_trace_writer_add(w, keys, n);
+	if (err == 0)
+		err = mnemo_trace_writer_close(w);
+	else
+		mnemo_trace_writer_close(w);
+	free(keys);
+	if (err != 0) {
+		fprintf(stderr, "%s: %s\n", COMPRESSED_PATH, strerror(-err));
+		return EXIT_FAILURE;
+	}
+
+	err = run("raw", RAW_PATH, n);
+	if (err == 0)
+		err = run("compressed", COMPRESSED_PATH, n);
+	unlink(RAW_PATH);
+	unlink(COMPRESSED_PATH);
+	return err == 0 ? EXIT_SUCCESS : EXIT_FAILURE;
+}
@@ -4,6 +4,6 @@ import os
 
 mnemopath = os.environ.get("LIBMNEMO_SO", find_library("mnemo"))
 assert mnemopath is not None
-libmnemo = ct.cdll.LoadLibrary(mnemopath)
+libmnemo = ct.CDLL(mnemopath, use_errno=True)
 
 from .reuse import *
@@ -1,4 +1,6 @@
 import ctypes as ct
+import os
+import numpy as np
 from . import libmnemo
 
 # Base types
@@ -8,29 +10,901 @@ mn_handle = ct.c_void_p
 mn_key = ct.c_ulonglong
 
 mn_reusedm = mn_handle
+mn_reuse_engine = ct.c_int
+
+# Reuse distance engines, see enum mnemo_reuse_engine
+REUSE_SPLAY = 0
+REUSE_FENWICK = 1
+REUSE_APPROX = 2
+
+# Distance of the accesses a sampling ReuseDM does not track
+REUSE_SKIPPED = -2
+
+# Histogram scales, see enum mnemo_histogram_scale
+HISTOGRAM_LOG2 = 0
+HISTOGRAM_LINEAR = 1
+
+# Cache replacement policies, see enum mnemo_cache_policy
+CACHE_LRU = 0
+CACHE_PLRU = 1
+CACHE_RANDOM = 2
+
+# Inclusion policies of a hierarchy level, see enum mnemo_inclusion
+INCLUSION_NINE = 0
+INCLUSION_INCLUSIVE = 1
+INCLUSION_EXCLUSIVE = 2
+
+# Level without a level above, and range of all accesses, both SIZE_MAX
+HIERARCHY_TOP = ct.c_size_t(-1).value
+HIERARCHY_ALL = ct.c_size_t(-1).value
+
+mn_trace = mn_handle
+mn_histogram = mn_handle
+mn_histogram_scale = ct.c_int
+
+# Arrays passed without copy to the batch interfaces
+mn_key_array = np.ctypeslib.ndpointer(dtype=np.uint64, ndim=1,
+                                      flags='C_CONTIGUOUS')
+mn_distance_array = np.ctypeslib.ndpointer(dtype=np.int64, ndim=1,
+                                           flags=('C_CONTIGUOUS', 'WRITEABLE'))
+mn_ratio_array = np.ctypeslib.ndpointer(dtype=np.float64, ndim=1,
+                                        flags=('C_CONTIGUOUS', 'WRITEABLE'))
 
 def _mn_get_function(method, argtypes=[], restype=mn_result):
-    res = getattr(libmnemo, method)
+    # a new function object each time, so that a function can be bound
+    # with different argument types
+    res = libmnemo[method]
     res.restype = restype
     res.argtypes = argtypes
     return res
 
 libmn_reusedm_init = _mn_get_function("mnemo_reusedm_init", [mn_size], mn_reusedm)
-libmn_reusedm_add = _mn_get_function("mnemo_reusedm_add", [mn_reusedm, mn_key])
+libmn_reusedm_init_engine = _mn_get_function("mnemo_reusedm_init_engine",
+                                             [mn_size, mn_reuse_engine],
+                                             mn_reusedm)
+libmn_reusedm_init_approx = _mn_get_function("mnemo_reusedm_init_approx",
+                                             [mn_size, ct.c_double],
+                                             mn_reusedm)
+libmn_reusedm_init_sampled = _mn_get_function("mnemo_reusedm_init_sampled",
+                                              [mn_size, mn_reuse_engine,
+                                               ct.c_double, mn_size],
+                                              mn_reusedm)
+libmn_reusedm_rate = _mn_get_function("mnemo_reusedm_rate", [mn_reusedm],
+                                      ct.c_double)
+libmn_reusedm_add = _mn_get_function("mnemo_reusedm_add64", [mn_reusedm, mn_key],
+                                     ct.c_int64)
+libmn_reusedm_add_batch = _mn_get_function("mnemo_reusedm_add_batch",
+                                           [mn_reusedm, mn_key_array, mn_size,
+                                            mn_distance_array], None)
+libmn_reusedm_count_batch = _mn_get_function("mnemo_reusedm_add_batch",
+                                             [mn_reusedm, mn_key_array, mn_size,
+                                              ct.c_void_p], None)
+libmn_reusedm_attach = _mn_get_function("mnemo_reusedm_attach",
+                                        [mn_reusedm, mn_histogram], None)
+libmn_trace_open = _mn_get_function("mnemo_trace_open", [ct.c_char_p], mn_trace)
+libmn_trace_close = _mn_get_function("mnemo_trace_close", [mn_trace], None)
+libmn_trace_nblocks = _mn_get_function("mnemo_trace_nblocks", [mn_trace], mn_size)
+libmn_reuse_from_trace = _mn_get_function("mnemo_reuse_from_trace",
+                                          [mn_reusedm, mn_trace, ct.c_char_p])
+mn_trace_writer = mn_handle
+libmn_trace_writer_open = _mn_get_function("mnemo_trace_writer_open",
+                                           [ct.c_char_p, mn_size],
+                                           mn_trace_writer)
+libmn_trace_writer_add = _mn_get_function("mnemo_trace_writer_add",
+                                          [mn_trace_writer, mn_key_array,
+                                           mn_size])
+libmn_trace_writer_close = _mn_get_function("mnemo_trace_writer_close",
+                                            [mn_trace_writer])
 libmn_reusedm_reset = _mn_get_function("mnemo_reusedm_reset", [mn_reusedm], None)
 libmn_reusedm_fini = _mn_get_function("mnemo_reusedm_fini", [mn_reusedm], None)
+libmn_reusedm_save = _mn_get_function("mnemo_reusedm_save",
+                                      [mn_reusedm, ct.c_char_p], ct.c_int)
+libmn_reusedm_load = _mn_get_function("mnemo_reusedm_load", [ct.c_char_p],
+                                      mn_reusedm)
+
+libmn_histogram_init = _mn_get_function("mnemo_histogram_init",
+                                        [mn_histogram_scale, mn_size,
+                                         ct.c_ulonglong], mn_histogram)
+libmn_histogram_nbins = _mn_get_function("mnemo_histogram_nbins",
+                                         [mn_histogram], mn_size)
+libmn_histogram_bins = _mn_get_function("mnemo_histogram_bins",
+                                        [mn_histogram],
+                                        ct.POINTER(ct.c_double))
+libmn_histogram_cold = _mn_get_function("mnemo_histogram_cold",
+                                        [mn_histogram], ct.c_double)
+libmn_histogram_bin_start = _mn_get_function("mnemo_histogram_bin_start",
+                                             [mn_histogram, mn_size],
+                                             ct.c_ulonglong)
+libmn_histogram_mrc = _mn_get_function("mnemo_histogram_mrc",
+                                       [mn_histogram, mn_key_array, mn_size,
+                                        mn_ratio_array], None)
+libmn_histogram_mrc_bins = _mn_get_function("mnemo_histogram_mrc",
+                                            [mn_histogram, ct.c_void_p,
+                                             mn_size, mn_ratio_array], None)
+libmn_histogram_reset = _mn_get_function("mnemo_histogram_reset",
+                                         [mn_histogram], None)
+libmn_histogram_fini = _mn_get_function("mnemo_histogram_fini",
+                                        [mn_histogram], None)
+
+def write_trace(path, keys, blocksize=0):
+    """Write an array of keys to a compressed trace file, readable by
+    ReuseDM.add_trace. blocksize is the number of keys per block, 0 for the
+    library default."""
+    keys = np.ascontiguousarray(keys, dtype=np.uint64).reshape(-1)
+    writer = libmn_trace_writer_open(os.fsencode(path), blocksize)
+    if not writer:
+        err = ct.get_errno()
+        raise OSError(err, os.strerror(err), path)
+    err = libmn_trace_writer_add(writer, keys, keys.shape[0])
+    close = libmn_trace_writer_close(writer)
+    if err == 0:
+        err = close
+    if err < 0:
+        raise OSError(-err, os.strerror(-err), path)
+
+mn_reuse_gran = mn_handle
+libmn_reuse_gran_init = _mn_get_function("mnemo_reuse_gran_init",
+                                         [mn_size, mn_reuse_engine,
+                                          ct.POINTER(ct.c_uint), mn_size],
+                                         mn_reuse_gran)
+libmn_reuse_gran_attach = _mn_get_function("mnemo_reuse_gran_attach",
+                                           [mn_reuse_gran, mn_size,
+                                            mn_histogram], None)
+libmn_reuse_gran_add_batch = _mn_get_function("mnemo_reuse_gran_add_batch",
+                                              [mn_reuse_gran, mn_key_array,
+                                               mn_size, mn_distance_array],
+                                              None)
+libmn_reuse_gran_count_batch = _mn_get_function("mnemo_reuse_gran_add_batch",
+                                                [mn_reuse_gran, mn_key_array,
+                                                 mn_size, ct.c_void_p], None)
+libmn_reuse_gran_from_trace = _mn_get_function("mnemo_reuse_gran_from_trace",
+                                               [mn_reuse_gran, mn_trace])
+libmn_reuse_gran_reset = _mn_get_function("mnemo_reuse_gran_reset",
+                                          [mn_reuse_gran], None)
+libmn_reuse_gran_fini = _mn_get_function("mnemo_reuse_gran_fini",
+                                         [mn_reuse_gran], None)
+
+class mn_cache_config(ct.Structure):
+    _fields_ = [("size", ct.c_ulonglong),
+                ("assoc", ct.c_uint),
+                ("line", ct.c_uint),
+                ("policy", ct.c_int)]
+
+mn_cache = mn_handle
+mn_miss_array = np.ctypeslib.ndpointer(dtype=np.uint8, ndim=1,
+                                       flags=('C_CONTIGUOUS', 'WRITEABLE'))
+libmn_cache_init = _mn_get_function("mnemo_cache_init",
+                                    [ct.POINTER(mn_cache_config), mn_size],
+                                    mn_cache)
+libmn_cache_add_batch = _mn_get_function("mnemo_cache_add_batch",
+                                         [mn_cache, mn_key_array, mn_size,
+                                          mn_miss_array], None)
+libmn_cache_count_batch = _mn_get_function("mnemo_cache_add_batch",
+                                           [mn_cache, mn_key_array, mn_size,
+                                            ct.c_void_p], None)
+libmn_cache_from_trace = _mn_get_function("mnemo_cache_from_trace",
+                                          [mn_cache, mn_trace])
+libmn_cache_accesses = _mn_get_function("mnemo_cache_accesses", [mn_cache],
+                                        ct.c_ulonglong)
+libmn_cache_misses = _mn_get_function("mnemo_cache_misses",
+                                      [mn_cache, mn_size], ct.c_ulonglong)
+libmn_cache_reset = _mn_get_function("mnemo_cache_reset", [mn_cache], None)
+libmn_cache_fini = _mn_get_function("mnemo_cache_fini", [mn_cache], None)
+
+class mn_hierarchy_level(ct.Structure):
+    _fields_ = [("cache", mn_cache_config),
+                ("inclusion", ct.c_int),
+                ("above", mn_size)]
+
+class mn_range(ct.Structure):
+    _fields_ = [("start", ct.c_ulonglong),
+                ("end", ct.c_ulonglong)]
+
+class mn_cache_stats(ct.Structure):
+    _fields_ = [("hits", ct.c_ulonglong),
+                ("misses", ct.c_ulonglong)]
+
+mn_hierarchy = mn_handle
+libmn_hierarchy_init = _mn_get_function("mnemo_hierarchy_init",
+                                        [ct.POINTER(mn_hierarchy_level),
+                                         mn_size, ct.POINTER(mn_range),
+                                         mn_size], mn_hierarchy)
+libmn_hierarchy_add_batch = _mn_get_function("mnemo_hierarchy_add_batch",
+                                             [mn_hierarchy, mn_key_array,
+                                              mn_size], None)
+libmn_hierarchy_from_trace = _mn_get_function("mnemo_hierarchy_from_trace",
+                                              [mn_hierarchy, mn_trace])
+libmn_hierarchy_stats = _mn_get_function("mnemo_hierarchy_stats",
+                                         [mn_hierarchy, mn_size, mn_size],
+                                         mn_cache_stats)
+libmn_hierarchy_reset = _mn_get_function("mnemo_hierarchy_reset",
+                                         [mn_hierarchy], None)
+libmn_hierarchy_fini = _mn_get_function("mnemo_hierarchy_fini",
+                                        [mn_hierarchy], None)
+
+class mn_region_stats(ct.Structure):
+    _fields_ = [("accesses", ct.c_double),
+                ("cold", ct.c_double),
+                ("mean", ct.c_double),
+                ("max", ct.c_int64)]
+
+mn_regions = mn_handle
+libmn_regions_init = _mn_get_function("mnemo_regions_init",
+                                      [ct.POINTER(mn_range), mn_size, mn_size],
+                                      mn_regions)
+libmn_reusedm_attach_regions = _mn_get_function("mnemo_reusedm_attach_regions",
+                                                [mn_reusedm, mn_regions], None)
+libmn_regions_nregions = _mn_get_function("mnemo_regions_nregions",
+                                          [mn_regions], mn_size)
+libmn_regions_stats = _mn_get_function("mnemo_regions_stats",
+                                       [mn_regions, mn_size,
+                                        ct.POINTER(mn_region_stats)], None)
+libmn_regions_histogram = _mn_get_function("mnemo_regions_histogram",
+                                           [mn_regions, mn_size], mn_histogram)
+libmn_regions_reset = _mn_get_function("mnemo_regions_reset", [mn_regions],
+                                       None)
+libmn_regions_fini = _mn_get_function("mnemo_regions_fini", [mn_regions], None)
+
+mn_series = mn_handle
+libmn_series_init = _mn_get_function("mnemo_series_init", [], mn_series)
+libmn_reusedm_intervals = _mn_get_function("mnemo_reusedm_intervals",
+                                           [mn_reusedm, mn_series,
+                                            ct.c_ulonglong], None)
+libmn_reusedm_mark = _mn_get_function("mnemo_reusedm_mark", [mn_reusedm], None)
+libmn_series_count = _mn_get_function("mnemo_series_count", [mn_series],
+                                      mn_size)
+libmn_series_nbins = _mn_get_function("mnemo_series_nbins", [mn_series],
+                                      mn_size)
+libmn_series_bins = _mn_get_function("mnemo_series_bins", [mn_series, mn_size],
+                                     ct.POINTER(ct.c_double))
+libmn_series_cold = _mn_get_function("mnemo_series_cold", [mn_series, mn_size],
+                                     ct.c_double)
+libmn_series_start = _mn_get_function("mnemo_series_start",
+                                      [mn_series, mn_size], ct.c_ulonglong)
+libmn_series_length = _mn_get_function("mnemo_series_length",
+                                       [mn_series, mn_size], ct.c_ulonglong)
+libmn_series_reset = _mn_get_function("mnemo_series_reset", [mn_series], None)
+libmn_series_fini = _mn_get_function("mnemo_series_fini", [mn_series], None)
+
+class mn_phase(ct.Structure):
+    _fields_ = [("id", mn_size),
+                ("first", mn_size),
+                ("count", mn_size),
+                ("start", ct.c_ulonglong),
+                ("length", ct.c_ulonglong)]
+
+mn_phases = mn_handle
+libmn_phases_init = _mn_get_function("mnemo_phases_init", [ct.c_double],
+                                     mn_phases)
+libmn_series_attach_phases = _mn_get_function("mnemo_series_attach_phases",
+                                              [mn_series, mn_phases], None)
+libmn_phases_count = _mn_get_function("mnemo_phases_count", [mn_phases],
+                                      mn_size)
+libmn_phases_nruns = _mn_get_function("mnemo_phases_nruns", [mn_phases],
+                                      mn_size)
+libmn_phases_run = _mn_get_function("mnemo_phases_run", [mn_phases, mn_size],
+                                    mn_phase)
+libmn_phases_representative = _mn_get_function("mnemo_phases_representative",
+                                               [mn_phases, mn_series, mn_size],
+                                               mn_size)
+libmn_phases_reset = _mn_get_function("mnemo_phases_reset", [mn_phases], None)
+libmn_phases_fini = _mn_get_function("mnemo_phases_fini", [mn_phases], None)
+
+mn_locality = mn_handle
+libmn_locality_init = _mn_get_function("mnemo_locality_init", [mn_size],
+                                       mn_locality)
+libmn_locality_add = _mn_get_function("mnemo_locality_add",
+                                      [mn_locality, mn_key], ct.c_int64)
+libmn_locality_add_batch = _mn_get_function("mnemo_locality_add_batch",
+                                            [mn_locality, mn_key_array,
+                                             mn_size, mn_distance_array],
+                                            None)
+libmn_locality_count_batch = _mn_get_function("mnemo_locality_add_batch",
+                                              [mn_locality, mn_key_array,
+                                               mn_size, ct.c_void_p], None)
+libmn_locality_attach = _mn_get_function("mnemo_locality_attach",
+                                         [mn_locality, mn_histogram], None)
+libmn_locality_accesses = _mn_get_function("mnemo_locality_accesses",
+                                           [mn_locality], ct.c_ulonglong)
+libmn_locality_keys = _mn_get_function("mnemo_locality_keys", [mn_locality],
+                                       mn_size)
+libmn_locality_footprint = _mn_get_function("mnemo_locality_footprint",
+                                            [mn_locality, ct.c_ulonglong],
+                                            ct.c_double)
+libmn_locality_mrc = _mn_get_function("mnemo_locality_mrc",
+                                      [mn_locality, mn_key_array, mn_size,
+                                       mn_ratio_array], None)
+libmn_locality_reset = _mn_get_function("mnemo_locality_reset",
+                                        [mn_locality], None)
+libmn_locality_fini = _mn_get_function("mnemo_locality_fini", [mn_locality],
+                                       None)
+
+mn_segment = mn_handle
+libmn_segment_init = _mn_get_function("mnemo_segment_init",
+                                      [mn_size, ct.c_int, mn_size,
+                                       ct.c_ulonglong], mn_segment)
+libmn_segment_add_batch = _mn_get_function("mnemo_segment_add_batch",
+                                           [mn_segment, mn_key_array,
+                                            mn_size], None)
+libmn_segment_from_trace = _mn_get_function("mnemo_segment_from_trace",
+                                            [mn_segment, mn_trace, mn_size,
+                                             mn_size], ct.c_int)
+libmn_segment_histogram = _mn_get_function("mnemo_segment_histogram",
+                                           [mn_segment], mn_histogram)
+libmn_segment_accesses = _mn_get_function("mnemo_segment_accesses",
+                                          [mn_segment], ct.c_ulonglong)
+libmn_segment_nkeys = _mn_get_function("mnemo_segment_nkeys", [mn_segment],
+                                       mn_size)
+libmn_segment_merge = _mn_get_function("mnemo_segment_merge",
+                                       [mn_segment, mn_segment], None)
+libmn_segment_save = _mn_get_function("mnemo_segment_save",
+                                      [mn_segment, ct.c_char_p], ct.c_int)
+libmn_segment_load = _mn_get_function("mnemo_segment_load", [ct.c_char_p],
+                                      mn_segment)
+libmn_segment_reset = _mn_get_function("mnemo_segment_reset", [mn_segment],
+                                       None)
+libmn_segment_fini = _mn_get_function("mnemo_segment_fini", [mn_segment],
+                                      None)
+
+class Histogram():
+
+    def __init__(self, nbins=65, scale=HISTOGRAM_LOG2, width=1):
+        self.handle = libmn_histogram_init(scale, nbins, width)
+
+    @property
+    def bins(self):
+        """Counts of each bin, as a float64 array."""
+        n = libmn_histogram_nbins(self.handle)
+        bins = libmn_histogram_bins(self.handle)
+        return np.ctypeslib.as_array(bins, shape=(n,)).copy()
+
+    @property
+    def starts(self):
+        """Smallest distance of each bin, as a uint64 array."""
+        n = libmn_histogram_nbins(self.handle)
+        return np.array([libmn_histogram_bin_start(self.handle, i)
+                         for i in range(n)], dtype=np.uint64)
+
+    @property
+    def cold(self):
+        return libmn_histogram_cold(self.handle)
+
+    def mrc(self, sizes=None):
+        """Miss ratio curve of a fully associative LRU cache at each of the
+        given cache sizes, or at the start of each bin by default, as a
+        float64 array."""
+        if sizes is None:
+            n = libmn_histogram_nbins(self.handle)
+            out = np.empty(n, dtype=np.float64)
+            libmn_histogram_mrc_bins(self.handle, None, n, out)
+            return out
+        sizes = np.ascontiguousarray(sizes, dtype=np.uint64).reshape(-1)
+        out = np.empty(sizes.shape[0], dtype=np.float64)
+        libmn_histogram_mrc(self.handle, sizes, sizes.shape[0], out)
+        return out
+
+    def reset(self):
+        libmn_histogram_reset(self.handle)
+
+    def __del__(self):
+        libmn_histogram_fini(self.handle)
+
+class Regions():
+
+    def __init__(self, ranges, nbins=32):
+        """Per-region reuse statistics, for a list of sorted, disjoint
+        (start, end) key ranges, with a log2 histogram of nbins bins per
+        region."""
+        self.ranges = [tuple(r) for r in ranges]
+        arr = (mn_range * max(len(self.ranges), 1))(
+            *[mn_range(*r) for r in self.ranges])
+        self.handle = libmn_regions_init(arr, len(self.ranges), nbins)
+
+    def __len__(self):
+        return len(self.ranges)
+
+    def stats(self, region):
+        """Dictionary of the accesses, cold misses, mean and max distance of
+        a region, len(self) for the keys in no region."""
+        s = mn_region_stats()
+        libmn_regions_stats(self.handle, region, ct.byref(s))
+        return {"accesses": s.accesses, "cold": s.cold, "mean": s.mean,
+                "max": s.max}
+
+    def bins(self, region):
+        """Histogram counts of a region, as a float64 array."""
+        h = libmn_regions_histogram(self.handle, region)
+        n = libmn_histogram_nbins(h)
+        return np.ctypeslib.as_array(libmn_histogram_bins(h),
+                                     shape=(n,)).copy()
+
+    def reset(self):
+        libmn_regions_reset(self.handle)
+
+    def __del__(self):
+        libmn_regions_fini(self.handle)
+
+class Series():
+
+    def __init__(self):
+        """Snapshots of the histogram of a ReuseDM, one per interval, see
+        ReuseDM.intervals."""
+        self.phases = None
+        self.handle = libmn_series_init()
+
+    def __len__(self):
+        return libmn_series_count(self.handle)
+
+    @property
+    def bins(self):
+        """Counts of all the snapshots, as a float64 array of shape
+        (len(self), nbins)."""
+        n = len(self)
+        nbins = libmn_series_nbins(self.handle)
+        if n == 0:
+            return np.zeros((0, nbins))
+        return np.ctypeslib.as_array(libmn_series_bins(self.handle, 0),
+                                     shape=(n, nbins)).copy()
+
+    @property
+    def cold(self):
+        return np.array([libmn_series_cold(self.handle, i)
+                         for i in range(len(self))])
+
+    @property
+    def starts(self):
+        return np.array([libmn_series_start(self.handle, i)
+                         for i in range(len(self))], dtype=np.uint64)
+
+    @property
+    def lengths(self):
+        return np.array([libmn_series_length(self.handle, i)
+                         for i in range(len(self))], dtype=np.uint64)
+
+    def attach_phases(self, phases):
+        """Classify every new snapshot with a Phases detector, None to detach
+        the current one."""
+        self.phases = phases
+        libmn_series_attach_phases(self.handle,
+                                   phases.handle if phases is not None
+                                   else None)
+
+    def reset(self):
+        libmn_series_reset(self.handle)
+
+    def __del__(self):
+        libmn_series_fini(self.handle)
+
+class Phases():
+
+    def __init__(self, threshold=0.5):
+        """Online phase detection over the snapshots of a Series, see
+        mnemo_phases_init."""
+        self.handle = libmn_phases_init(threshold)
+
+    def __len__(self):
+        return libmn_phases_count(self.handle)
+
+    @property
+    def runs(self):
+        """List of the runs of phases, as dictionaries of the phase id, the
+        first snapshot and count of snapshots, and the first access and
+        length of the run."""
+        ret = []
+        for i in range(libmn_phases_nruns(self.handle)):
+            r = libmn_phases_run(self.handle, i)
+            ret.append({"id": r.id, "first": r.first, "count": r.count,
+                        "start": r.start, "length": r.length})
+        return ret
+
+    def representative(self, series, phase):
+        """Index of the snapshot of series closest to the mean of a phase."""
+        return libmn_phases_representative(self.handle, series.handle, phase)
+
+    def reset(self):
+        libmn_phases_reset(self.handle)
+
+    def __del__(self):
+        libmn_phases_fini(self.handle)
 
 class ReuseDM():
 
-    def __init__(self, maxsize=0):
-        self.handle = libmn_reusedm_init(maxsize)
+    def __init__(self, maxsize=0, engine=REUSE_SPLAY, error=None, rate=1.0,
+                 sample_max=0):
+        """error sets the relative error bound of the REUSE_APPROX engine,
+        and implies it. rate and sample_max only track a sample of the keys,
+        see mnemo_reusedm_init_sampled."""
+        self.histogram = None
+        self.regions = None
+        self.series = None
+        if error is not None:
+            self.handle = libmn_reusedm_init_approx(maxsize, error)
+        elif rate < 1.0 or sample_max:
+            self.handle = libmn_reusedm_init_sampled(maxsize, engine, rate,
+                                                     sample_max)
+        else:
+            self.handle = libmn_reusedm_init_engine(maxsize, engine)
 
     def add(self, key):
         return libmn_reusedm_add(self.handle, key)
 
+    def add_array(self, keys):
+        """Add all the keys of an array, in order, and return an array of
+        their reuse distances. A contiguous uint64 array is passed to the
+        library without copy."""
+        keys = np.ascontiguousarray(keys, dtype=np.uint64).reshape(-1)
+        out = np.empty(keys.shape[0], dtype=np.int64)
+        libmn_reusedm_add_batch(self.handle, keys, keys.shape[0], out)
+        return out
+
+    def count_array(self, keys):
+        """Add all the keys of an array, in order, only updating the
+        attached histogram."""
+        keys = np.ascontiguousarray(keys, dtype=np.uint64).reshape(-1)
+        libmn_reusedm_count_batch(self.handle, keys, keys.shape[0], None)
+
+    def add_trace(self, path, output=None):
+        """Add all the keys of a trace file, either raw little-endian uint64
+        read natively from a memory mapping, or compressed by write_trace.
+        Distances are written to the output
+        file, if any, in the same format."""
+        trace = libmn_trace_open(os.fsencode(path))
+        if not trace:
+            err = ct.get_errno()
+            raise OSError(err, os.strerror(err), path)
+        try:
+            err = libmn_reuse_from_trace(self.handle, trace,
+                                         os.fsencode(output)
+                                         if output is not None else None)
+        finally:
+            libmn_trace_close(trace)
+        if err < 0:
+            raise OSError(-err, os.strerror(-err), output)
+
+    def save(self, path):
+        """Save the state of the manager to a checkpoint file, see
+        mnemo_reusedm_save. Attached objects are not saved."""
+        err = libmn_reusedm_save(self.handle, os.fsencode(path))
+        if err < 0:
+            raise OSError(-err, os.strerror(-err), path)
+
+    @classmethod
+    def load(cls, path):
+        """New manager restored from a checkpoint file written by save."""
+        handle = libmn_reusedm_load(os.fsencode(path))
+        if not handle:
+            err = ct.get_errno()
+            raise OSError(err, os.strerror(err), path)
+        ret = cls.__new__(cls)
+        ret.histogram = None
+        ret.regions = None
+        ret.series = None
+        ret.handle = handle
+        return ret
+
+    def attach(self, histogram):
+        """Count every access in a Histogram, None to detach it."""
+        self.histogram = histogram
+        libmn_reusedm_attach(self.handle,
+                             histogram.handle if histogram else None)
+
+    def attach_regions(self, regions):
+        """Count every access in the region of its key, None to detach the
+        current Regions."""
+        self.regions = regions
+        libmn_reusedm_attach_regions(self.handle,
+                                     regions.handle if regions else None)
+
+    def intervals(self, series, length=0):
+        """Snapshot the attached Histogram into a Series every length
+        accesses, or on mark() only if length is 0. None stops snapshots."""
+        self.series = series
+        libmn_reusedm_intervals(self.handle,
+                                series.handle if series is not None else None,
+                                length)
+
+    def mark(self):
+        """End the current interval."""
+        libmn_reusedm_mark(self.handle)
+
+    @property
+    def rate(self):
+        """Current sampling rate, 1.0 if all keys are tracked."""
+        return libmn_reusedm_rate(self.handle)
+
     def reset(self):
         libmn_reusedm_reset(self.handle)
 
     def __del__(self):
         libmn_reusedm_fini(self.handle)
 
+class MultiReuseDM():
+
+    def __init__(self, shifts, maxsize=0, engine=REUSE_SPLAY):
+        """Reuse distances of raw addresses at several granularities in one
+        pass: level i keys addresses by address >> shifts[i], with shifts
+        strictly increasing, e.g. (6, 12, 21) for cache lines, pages and
+        huge pages."""
+        self.shifts = tuple(shifts)
+        self.histograms = [None] * len(self.shifts)
+        arr = (ct.c_uint * len(self.shifts))(*self.shifts)
+        self.handle = libmn_reuse_gran_init(maxsize, engine, arr,
+                                            len(self.shifts))
+
+    def add_array(self, addrs):
+        """Add all the addresses of an array, in order, and return an array of
+        shape (levels, n) of their reuse distances at each level."""
+        addrs = np.ascontiguousarray(addrs, dtype=np.uint64).reshape(-1)
+        n = addrs.shape[0]
+        out = np.empty(len(self.shifts) * n, dtype=np.int64)
+        libmn_reuse_gran_add_batch(self.handle, addrs, n, out)
+        return out.reshape(len(self.shifts), n)
+
+    def count_array(self, addrs):
+        """Add all the addresses of an array, in order, only updating the
+        attached histograms."""
+        addrs = np.ascontiguousarray(addrs, dtype=np.uint64).reshape(-1)
+        libmn_reuse_gran_count_batch(self.handle, addrs, addrs.shape[0], None)
+
+    def add_trace(self, path):
+        """Add all the addresses of a trace file, raw or compressed, only
+        updating the attached histograms."""
+        trace = libmn_trace_open(os.fsencode(path))
+        if not trace:
+            err = ct.get_errno()
+            raise OSError(err, os.strerror(err), path)
+        try:
+            err = libmn_reuse_gran_from_trace(self.handle, trace)
+        finally:
+            libmn_trace_close(trace)
+        if err < 0:
+            raise OSError(-err, os.strerror(-err), path)
+
+    def attach(self, level, histogram):
+        """Count every access of a level in a Histogram, None to detach it."""
+        self.histograms[level] = histogram
+        libmn_reuse_gran_attach(self.handle, level,
+                                histogram.handle if histogram else None)
+
+    def reset(self):
+        libmn_reuse_gran_reset(self.handle)
+
+    def __del__(self):
+        libmn_reuse_gran_fini(self.handle)
+
+class Cache():
+
+    def __init__(self, configs):
+        """Simulate several set-associative caches in one pass. configs is a
+        list of (size, assoc, line, policy) tuples, sizes in bytes, assoc 0
+        for a fully associative cache."""
+        self.configs = [tuple(c) for c in configs]
+        arr = (mn_cache_config * len(self.configs))(
+            *[mn_cache_config(*c) for c in self.configs])
+        self.handle = libmn_cache_init(arr, len(self.configs))
+
+    def add_array(self, addrs):
+        """Add all the byte addresses of an array, in order, and return a
+        uint8 array of shape (configs, n), 1 where an access missed."""
+        addrs = np.ascontiguousarray(addrs, dtype=np.uint64).reshape(-1)
+        n = addrs.shape[0]
+        out = np.empty(len(self.configs) * n, dtype=np.uint8)
+        libmn_cache_add_batch(self.handle, addrs, n, out)
+        return out.reshape(len(self.configs), n)
+
+    def count_array(self, addrs):
+        """Add all the byte addresses of an array, in order, only updating the
+        counts of misses."""
+        addrs = np.ascontiguousarray(addrs, dtype=np.uint64).reshape(-1)
+        libmn_cache_count_batch(self.handle, addrs, addrs.shape[0], None)
+
+    def add_trace(self, path):
+        """Add all the addresses of a trace file, raw or compressed."""
+        trace = libmn_trace_open(os.fsencode(path))
+        if not trace:
+            err = ct.get_errno()
+            raise OSError(err, os.strerror(err), path)
+        try:
+            err = libmn_cache_from_trace(self.handle, trace)
+        finally:
+            libmn_trace_close(trace)
+        if err < 0:
+            raise OSError(-err, os.strerror(-err), path)
+
+    @property
+    def accesses(self):
+        return libmn_cache_accesses(self.handle)
+
+    @property
+    def misses(self):
+        """Number of misses of each cache, as a uint64 array."""
+        return np.array([libmn_cache_misses(self.handle, i)
+                         for i in range(len(self.configs))], dtype=np.uint64)
+
+    def reset(self):
+        libmn_cache_reset(self.handle)
+
+    def __del__(self):
+        libmn_cache_fini(self.handle)
+
+class Hierarchy():
+
+    def __init__(self, levels, ranges=()):
+        """Simulate a hierarchy of caches. levels is a list of ((size, assoc,
+        line, policy), inclusion, above) tuples, where above is the index of
+        the level whose misses a level receives, or HIERARCHY_TOP. ranges is
+        a list of sorted, disjoint (start, end) address ranges with their own
+        counters."""
+        self.levels = [(tuple(c), i, a) for c, i, a in levels]
+        self.ranges = [tuple(r) for r in ranges]
+        larr = (mn_hierarchy_level * len(self.levels))(
+            *[mn_hierarchy_level(mn_cache_config(*c), i, a)
+              for c, i, a in self.levels])
+        rarr = (mn_range * max(len(self.ranges), 1))(
+            *[mn_range(*r) for r in self.ranges])
+        self.handle = libmn_hierarchy_init(larr, len(self.levels), rarr,
+                                           len(self.ranges))
+
+    def add_array(self, addrs):
+        """Add all the byte addresses of an array, in order."""
+        addrs = np.ascontiguousarray(addrs, dtype=np.uint64).reshape(-1)
+        libmn_hierarchy_add_batch(self.handle, addrs, addrs.shape[0])
+
+    def add_trace(self, path):
+        """Add all the addresses of a trace file, raw or compressed."""
+        trace = libmn_trace_open(os.fsencode(path))
+        if not trace:
+            err = ct.get_errno()
+            raise OSError(err, os.strerror(err), path)
+        try:
+            err = libmn_hierarchy_from_trace(self.handle, trace)
+        finally:
+            libmn_trace_close(trace)
+        if err < 0:
+            raise OSError(-err, os.strerror(-err), path)
+
+    def stats(self, level, range=HIERARCHY_ALL):
+        """(hits, misses) of a level, for all accesses or a single range,
+        len(self.ranges) for the addresses in no range."""
+        s = libmn_hierarchy_stats(self.handle, level, range)
+        return (s.hits, s.misses)
+
+    def reset(self):
+        libmn_hierarchy_reset(self.handle)
+
+    def __del__(self):
+        libmn_hierarchy_fini(self.handle)
+
+class Locality():
+
+    def __init__(self, maxsize=0):
+        """Reuse times and average footprint of a trace, see
+        mnemo_locality_init."""
+        self.histogram = None
+        self.handle = libmn_locality_init(maxsize)
+
+    def add(self, key):
+        return libmn_locality_add(self.handle, key)
+
+    def add_array(self, keys):
+        """Add all the keys of an array, in order, and return an array of
+        their reuse times, -1 for first accesses."""
+        keys = np.ascontiguousarray(keys, dtype=np.uint64).reshape(-1)
+        out = np.empty(keys.shape[0], dtype=np.int64)
+        libmn_locality_add_batch(self.handle, keys, keys.shape[0], out)
+        return out
+
+    def count_array(self, keys):
+        """Add all the keys of an array, in order, without returning their
+        reuse times."""
+        keys = np.ascontiguousarray(keys, dtype=np.uint64).reshape(-1)
+        libmn_locality_count_batch(self.handle, keys, keys.shape[0], None)
+
+    def attach(self, histogram):
+        """Count the reuse time of every access in a Histogram, None to
+        detach it."""
+        self.histogram = histogram
+        libmn_locality_attach(self.handle,
+                              histogram.handle if histogram else None)
+
+    @property
+    def accesses(self):
+        return libmn_locality_accesses(self.handle)
+
+    @property
+    def keys(self):
+        return libmn_locality_keys(self.handle)
+
+    def footprint(self, w):
+        """Average number of distinct keys in windows of w accesses."""
+        return libmn_locality_footprint(self.handle, w)
+
+    def mrc(self, sizes):
+        """Miss ratio of a fully associative LRU cache at each of the given
+        sizes, predicted from the footprint, as a float64 array."""
+        sizes = np.ascontiguousarray(sizes, dtype=np.uint64).reshape(-1)
+        out = np.empty(sizes.shape[0], dtype=np.float64)
+        libmn_locality_mrc(self.handle, sizes, sizes.shape[0], out)
+        return out
+
+    def reset(self):
+        libmn_locality_reset(self.handle)
+
+    def __del__(self):
+        libmn_locality_fini(self.handle)
+
+class Segment():
+
+    def __init__(self, nbins=65, scale=HISTOGRAM_LOG2, width=1, maxsize=0):
+        """Mergeable summary of a segment of a trace, with the histogram of
+        its distances, see mnemo_segment_init."""
+        self.handle = libmn_segment_init(maxsize, scale, nbins, width)
+
+    def add_array(self, keys):
+        """Add all the keys of an array at the end of the segment."""
+        keys = np.ascontiguousarray(keys, dtype=np.uint64).reshape(-1)
+        libmn_segment_add_batch(self.handle, keys, keys.shape[0])
+
+    def add_trace(self, path, block=0, nblocks=None):
+        """Add nblocks blocks of a trace file, from block, all the remaining
+        ones if nblocks is None."""
+        trace = libmn_trace_open(os.fsencode(path))
+        if not trace:
+            err = ct.get_errno()
+            raise OSError(err, os.strerror(err), path)
+        try:
+            if nblocks is None:
+                nblocks = libmn_trace_nblocks(trace)
+            err = libmn_segment_from_trace(self.handle, trace, block,
+                                           nblocks)
+        finally:
+            libmn_trace_close(trace)
+        if err < 0:
+            raise OSError(-err, os.strerror(-err), path)
+
+    @property
+    def bins(self):
+        """Counts of each bin of the histogram, as a float64 array."""
+        h = libmn_segment_histogram(self.handle)
+        n = libmn_histogram_nbins(h)
+        return np.ctypeslib.as_array(libmn_histogram_bins(h),
+                                     shape=(n,)).copy()
+
+    @property
+    def cold(self):
+        return libmn_histogram_cold(libmn_segment_histogram(self.handle))
+
+    @property
+    def accesses(self):
+        return libmn_segment_accesses(self.handle)
+
+    @property
+    def keys(self):
+        return libmn_segment_nkeys(self.handle)
+
+    def merge(self, later):
+        """Merge the Segment that follows this one in the trace into it."""
+        libmn_segment_merge(self.handle, later.handle)
+
+    def save(self, path):
+        err = libmn_segment_save(self.handle, os.fsencode(path))
+        if err < 0:
+            raise OSError(-err, os.strerror(-err), path)
+
+    @classmethod
+    def load(cls, path):
+        """Segment read from a file written by save, possibly by another
+        process."""
+        handle = libmn_segment_load(os.fsencode(path))
+        if not handle:
+            err = ct.get_errno()
+            raise OSError(err, os.strerror(err), path)
+        ret = cls.__new__(cls)
+        ret.handle = handle
+        return ret
+
+    def reset(self):
+        libmn_segment_reset(self.handle)
+
+    def __del__(self):
+        libmn_segment_fini(self.handle)
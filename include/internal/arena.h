@@ -0,0 +1,115 @@
+/*
+ * Chunked arena for fixed-size objects.
+ *
+ * Objects are carved out of large zeroed chunks, so that allocating a new
+ * object is a pointer bump and objects allocated together stay close in
+ * memory. Freed objects are kept on a list for reuse by later allocations, the
+ * memory itself is only released with the whole arena.
+ */
+
+#ifndef MNEMO_INTERNAL_ARENA_H
+#define MNEMO_INTERNAL_ARENA_H 1
+
+#include <assert.h>
+#include <stddef.h>
+#include <stdlib.h>
+#include <string.h>
+
+/* number of objects in the first chunk of an arena, chunks then double in size
+ * up to MNEMO_ARENA_MAX_CHUNK objects.
+ */
+#define MNEMO_ARENA_MIN_CHUNK 1024
+#define MNEMO_ARENA_MAX_CHUNK (1024 * 1024)
+
+struct mnemo_arena_chunk {
+	struct mnemo_arena_chunk *next;
+	/* objects start here, with the strictest alignment of a scalar */
+	long double objects[];
+};
+
+struct mnemo_arena {
+	size_t objsize;
+	/* number of objects in the next chunk to allocate */
+	size_t chunksize;
+	struct mnemo_arena_chunk *chunks;
+	char *next, *end;
+	/* freed objects, chained through their first bytes */
+	void *freelist;
+};
+
+static inline void mnemo_arena_init(struct mnemo_arena *a, size_t objsize)
+{
+	assert(objsize >= sizeof(void *));
+	a->objsize = objsize;
+	a->chunksize = MNEMO_ARENA_MIN_CHUNK;
+	a->chunks = NULL;
+	a->next = NULL;
+	a->end = NULL;
+	a->freelist = NULL;
+}
+
+/* allocate a new chunk able to hold at least nobj objects. */
+static inline void mnemo_arena_grow(struct mnemo_arena *a, size_t nobj)
+{
+	struct mnemo_arena_chunk *c;
+
+	c = calloc(1, sizeof(*c) + nobj * a->objsize);
+	assert(c != NULL);
+	c->next = a->chunks;
+	a->chunks = c;
+	a->next = (char *)c->objects;
+	a->end = a->next + nobj * a->objsize;
+	if (a->chunksize < MNEMO_ARENA_MAX_CHUNK)
+		a->chunksize *= 2;
+}
+
+/* preallocate room for nobj objects in a single chunk. */
+static inline void mnemo_arena_reserve(struct mnemo_arena *a, size_t nobj)
+{
+	size_t chunksize = a->chunksize;
+
+	if (nobj == 0 || (a->next != NULL &&
+			  nobj <= (size_t)(a->end - a->next) / a->objsize))
+		return;
+	mnemo_arena_grow(a, nobj);
+	a->chunksize = chunksize;
+}
+
+/* return a new zeroed object. */
+static inline void *mnemo_arena_alloc(struct mnemo_arena *a)
+{
+	void *ret;
+
+	if (a->freelist != NULL) {
+		ret = a->freelist;
+		a->freelist = *(void **)ret;
+		memset(ret, 0, a->objsize);
+		return ret;
+	}
+	if (a->next == a->end)
+		mnemo_arena_grow(a, a->chunksize);
+	ret = a->next;
+	a->next += a->objsize;
+	return ret;
+}
+
+/* give an object back to the arena, for a later allocation. */
+static inline void mnemo_arena_free(struct mnemo_arena *a, void *obj)
+{
+	*(void **)obj = a->freelist;
+	a->freelist = obj;
+}
+
+/* release all the objects of the arena at once. */
+static inline void mnemo_arena_clear(struct mnemo_arena *a)
+{
+	struct mnemo_arena_chunk *c, *tmp;
+
+	for (c = a->chunks; c != NULL; c = tmp) {
+		tmp = c->next;
+		free(c);
+	}
+	mnemo_arena_init(a, a->objsize);
+}
+
+#endif /* MNEMO_INTERNAL_ARENA_H */
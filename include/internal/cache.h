@@ -0,0 +1,243 @@
+/*
+ * Set-associative cache, in terms of line numbers.
+ *
+ * The lines of a set are stored in a compact array of ways, all the sets of
+ * the cache in a single flat array. Each set also keeps a word of metadata:
+ * - LRU: the number of valid ways. Ways are kept in recency order, the most
+ *   recently used first, and the victim is the last valid way.
+ * - tree-PLRU and random: a mask of the valid ways, at most 64. Tree-PLRU also
+ *   keeps a word of tree bits per set: node n has children 2n and 2n+1, the
+ *   leaves below node ways-1 are the ways, and each bit points to the half
+ *   that was least recently used.
+ *
+ * A cache supports a lookup that updates the replacement state on a hit, the
+ * insertion of a missing line, which might evict another one, and the removal
+ * of a line, for hierarchies of caches.
+ */
+
+#ifndef MNEMO_INTERNAL_CACHE_H
+#define MNEMO_INTERNAL_CACHE_H 1
+
+#include <mnemo.h>
+
+struct mnemo_cache_sim {
+	enum mnemo_cache_policy policy;
+	/* log2 of the line size, the number of sets and of ways */
+	unsigned int lineshift;
+	size_t setmask;
+	size_t ways;
+	unsigned long long *lines;
+	uint64_t *meta;
+	uint64_t *plru;
+	/* xorshift state of the random policy */
+	uint64_t seed;
+};
+
+static inline int mnemo_cache_is_pow2(unsigned long long x)
+{
+	return x != 0 && (x & (x - 1)) == 0;
+}
+
+/* index of the lowest set bit of a non-zero word */
+static inline unsigned int mnemo_cache_ctz(uint64_t x)
+{
+#if defined(__GNUC__)
+	return __builtin_ctzll(x);
+#else
+	unsigned int ret;
+
+	for (ret = 0; !(x & 1); x >>= 1)
+		ret++;
+	return ret;
+#endif
+}
+
+/* validate a configuration, and fill the geometry of a cache. */
+static inline void mnemo_cache_sim_init(struct mnemo_cache_sim *s,
+					const struct mnemo_cache_config *c)
+{
+	size_t nsets;
+
+	assert(mnemo_cache_is_pow2(c->line));
+	assert(c->size >= c->line && c->size % c->line == 0);
+	s->policy = c->policy;
+	s->lineshift = mnemo_cache_ctz(c->line);
+	s->ways = c->assoc != 0 ? c->assoc : c->size / c->line;
+	assert(c->size / c->line % s->ways == 0);
+	nsets = c->size / c->line / s->ways;
+	assert(mnemo_cache_is_pow2(nsets));
+	assert(c->policy == MNEMO_CACHE_LRU || s->ways <= 64);
+	assert(c->policy != MNEMO_CACHE_PLRU || mnemo_cache_is_pow2(s->ways));
+	s->setmask = nsets - 1;
+	s->lines = malloc(nsets * s->ways * sizeof(*s->lines));
+	s->meta = calloc(nsets, sizeof(*s->meta));
+	s->plru = calloc(nsets, sizeof(*s->plru));
+	assert(s->lines != NULL && s->meta != NULL && s->plru != NULL);
+	s->seed = 0x9E3779B97F4A7C15ULL;
+}
+
+static inline void mnemo_cache_sim_clear(struct mnemo_cache_sim *s)
+{
+	memset(s->meta, 0, (s->setmask + 1) * sizeof(*s->meta));
+	memset(s->plru, 0, (s->setmask + 1) * sizeof(*s->plru));
+	s->seed = 0x9E3779B97F4A7C15ULL;
+}
+
+static inline void mnemo_cache_sim_fini(struct mnemo_cache_sim *s)
+{
+	free(s->lines);
+	free(s->meta);
+	free(s->plru);
+}
+
+static inline unsigned long long *mnemo_cache_set(struct mnemo_cache_sim *s,
+						  unsigned long long line,
+						  size_t *set)
+{
+	*set = line & s->setmask;
+	return &s->lines[*set * s->ways];
+}
+
+/* point the tree bits of a set away from a way. */
+static inline void mnemo_cache_plru_touch(struct mnemo_cache_sim *s,
+					  size_t set, size_t way)
+{
+	size_t node = way + s->ways;
+
+	for (; node > 1; node /= 2) {
+		uint64_t bit = 1ULL << (node / 2);
+
+		/* a right child was used, the left half is now the LRU one */
+		if (node & 1)
+			s->plru[set] &= ~bit;
+		else
+			s->plru[set] |= bit;
+	}
+}
+
+static inline size_t mnemo_cache_plru_victim(const struct mnemo_cache_sim *s,
+					     size_t set)
+{
+	size_t node = 1;
+
+	while (node < s->ways)
+		node = 2 * node + ((s->plru[set] >> node) & 1);
+	return node - s->ways;
+}
+
+/* way of a line in a set, or s->ways if it is not cached. */
+static inline size_t mnemo_cache_find(const struct mnemo_cache_sim *s,
+				      const unsigned long long *lines,
+				      size_t set, unsigned long long line)
+{
+	if (s->policy == MNEMO_CACHE_LRU) {
+		for (size_t w = 0; w < s->meta[set]; w++)
+			if (lines[w] == line)
+				return w;
+	} else {
+		for (uint64_t v = s->meta[set]; v != 0; v &= v - 1) {
+			size_t w = mnemo_cache_ctz(v);
+
+			if (lines[w] == line)
+				return w;
+		}
+	}
+	return s->ways;
+}
+
+/* look a line up, return 1 and update the replacement state on a hit. */
+static inline int mnemo_cache_sim_lookup(struct mnemo_cache_sim *s,
+					 unsigned long long line)
+{
+	size_t set, w;
+	unsigned long long *lines = mnemo_cache_set(s, line, &set);
+
+	w = mnemo_cache_find(s, lines, set, line);
+	if (w == s->ways)
+		return 0;
+	if (s->policy == MNEMO_CACHE_LRU) {
+		memmove(&lines[1], &lines[0], w * sizeof(*lines));
+		lines[0] = line;
+	} else if (s->policy == MNEMO_CACHE_PLRU) {
+		mnemo_cache_plru_touch(s, set, w);
+	}
+	return 1;
+}
+
+/* insert a line that is not cached, return 1 if another line was evicted to
+ * make room for it, and store it in victim.
+ */
+static inline int mnemo_cache_sim_insert(struct mnemo_cache_sim *s,
+					 unsigned long long line,
+					 unsigned long long *victim)
+{
+	size_t set, w;
+	unsigned long long *lines = mnemo_cache_set(s, line, &set);
+	int evicted;
+
+	if (s->policy == MNEMO_CACHE_LRU) {
+		size_t fill = s->meta[set];
+
+		evicted = fill == s->ways;
+		if (evicted)
+			*victim = lines[--fill];
+		else
+			s->meta[set]++;
+		memmove(&lines[1], &lines[0], fill * sizeof(*lines));
+		lines[0] = line;
+		return evicted;
+	}
+	evicted = s->meta[set] == (s->ways == 64 ? UINT64_MAX :
+				   (1ULL << s->ways) - 1);
+	if (!evicted) {
+		w = mnemo_cache_ctz(~s->meta[set]);
+		s->meta[set] |= 1ULL << w;
+	} else if (s->policy == MNEMO_CACHE_PLRU) {
+		w = mnemo_cache_plru_victim(s, set);
+	} else {
+		s->seed ^= s->seed >> 12;
+		s->seed ^= s->seed << 25;
+		s->seed ^= s->seed >> 27;
+		w = (s->seed * 0x2545F4914F6CDD1DULL >> 32) % s->ways;
+	}
+	if (evicted)
+		*victim = lines[w];
+	lines[w] = line;
+	if (s->policy == MNEMO_CACHE_PLRU)
+		mnemo_cache_plru_touch(s, set, w);
+	return evicted;
+}
+
+/* remove a line, return 1 if it was cached. */
+static inline int mnemo_cache_sim_remove(struct mnemo_cache_sim *s,
+					 unsigned long long line)
+{
+	size_t set, w;
+	unsigned long long *lines = mnemo_cache_set(s, line, &set);
+
+	w = mnemo_cache_find(s, lines, set, line);
+	if (w == s->ways)
+		return 0;
+	if (s->policy == MNEMO_CACHE_LRU) {
+		s->meta[set]--;
+		memmove(&lines[w], &lines[w + 1],
+			(s->meta[set] - w) * sizeof(*lines));
+	} else {
+		s->meta[set] &= ~(1ULL << w);
+	}
+	return 1;
+}
+
+/* access a line, inserting it on a miss. Return 1 on a hit. */
+static inline int mnemo_cache_sim_access(struct mnemo_cache_sim *s,
+					 unsigned long long line)
+{
+	unsigned long long victim;
+
+	if (mnemo_cache_sim_lookup(s, line))
+		return 1;
+	mnemo_cache_sim_insert(s, line, &victim);
+	return 0;
+}
+
+#endif /* MNEMO_INTERNAL_CACHE_H */
@@ -0,0 +1,115 @@
+/*
+ * Block codec of the compressed trace format.
+ *
+ * Keys are shifted right by the number of trailing zero bits they all share
+ * in the block, then each key is delta-encoded against the closest of the last
+ * MNEMO_CODEC_HISTORY keys, each slot of the history keeping the last key
+ * encoded against it. Interleaved streams of nearby addresses thus each get
+ * their own base. The zigzag encoded delta is stored as a varint whose first
+ * byte also holds the history slot:
+ *   first byte: continuation bit, 2 bits of slot, 5 low bits of the delta
+ *   next bytes: continuation bit, 7 bits of the delta
+ * A block starts with its shift, and decodes on its own.
+ */
+
+#ifndef MNEMO_INTERNAL_CODEC_H
+#define MNEMO_INTERNAL_CODEC_H 1
+
+#include <inttypes.h>
+#include <stddef.h>
+#include <string.h>
+
+/* one slot for each value of the 2 bits of the first byte */
+#define MNEMO_CODEC_HISTORY 4
+
+/* maximum size of an encoded key: 5 bits, then 7 bits per byte */
+#define MNEMO_CODEC_MAX_BYTES 10
+
+/* maximum size of an encoded block of n keys */
+#define MNEMO_CODEC_BOUND(n) (1 + (n) * MNEMO_CODEC_MAX_BYTES)
+
+/* encode n keys into buf, which must hold MNEMO_CODEC_BOUND(n) bytes, and
+ * return the number of bytes used.
+ */
+static inline size_t mnemo_codec_encode(const unsigned long long *keys,
+					size_t n, unsigned char *buf)
+{
+	uint64_t history[MNEMO_CODEC_HISTORY] = { 0 };
+	unsigned long long all = 0;
+	unsigned char *p = buf;
+	unsigned shift = 0;
+
+	for (size_t i = 0; i < n; i++)
+		all |= keys[i];
+	while (all != 0 && !(all & 1)) {
+		all >>= 1;
+		shift++;
+	}
+	*p++ = shift;
+	for (size_t i = 0; i < n; i++) {
+		uint64_t key = keys[i] >> shift, best = UINT64_MAX, zz;
+		unsigned slot = 0;
+
+		for (unsigned j = 0; j < MNEMO_CODEC_HISTORY; j++) {
+			uint64_t d = key - history[j];
+			/* zigzag: small negative deltas stay small */
+			uint64_t z = (d << 1) ^ (uint64_t)((int64_t)d >> 63);
+
+			if (z < best) {
+				best = z;
+				slot = j;
+			}
+		}
+		history[slot] = key;
+		zz = best;
+		*p = (slot << 5) | (zz & 0x1f);
+		zz >>= 5;
+		while (zz != 0) {
+			*p++ |= 0x80;
+			*p = zz & 0x7f;
+			zz >>= 7;
+		}
+		p++;
+	}
+	return p - buf;
+}
+
+/* decode the n keys of a block of size bytes, return 0 on success, -1 if the
+ * block is malformed.
+ */
+static inline int mnemo_codec_decode(const unsigned char *buf, size_t size,
+				     unsigned long long *keys, size_t n)
+{
+	uint64_t history[MNEMO_CODEC_HISTORY] = { 0 };
+	const unsigned char *p = buf, *end = buf + size;
+	unsigned shift;
+
+	if (size == 0)
+		return n == 0 ? 0 : -1;
+	shift = *p++;
+	if (shift > 63)
+		return -1;
+	for (size_t i = 0; i < n; i++) {
+		uint64_t zz, d;
+		unsigned b, slot, bits = 5;
+
+		if (p >= end)
+			return -1;
+		b = *p++;
+		slot = (b >> 5) & 3;
+		zz = b & 0x1f;
+		while (b & 0x80) {
+			if (p >= end || bits > 63)
+				return -1;
+			b = *p++;
+			zz |= (uint64_t)(b & 0x7f) << bits;
+			bits += 7;
+		}
+		d = (zz >> 1) ^ -(zz & 1);
+		history[slot] += d;
+		keys[i] = history[slot] << shift;
+	}
+	return p == end ? 0 : -1;
+}
+
+#endif /* MNEMO_INTERNAL_CODEC_H */
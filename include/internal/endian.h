@@ -0,0 +1,36 @@
+/*
+ * Little-endian 64-bit words of the file formats.
+ *
+ * Headers are read and written a byte at a time, whatever the alignment.
+ * Arrays of words are used in place from the mapping of a file, and only
+ * swapped on big-endian hosts.
+ */
+
+#ifndef MNEMO_INTERNAL_ENDIAN_H
+#define MNEMO_INTERNAL_ENDIAN_H 1
+
+#include <inttypes.h>
+
+#if defined(__BYTE_ORDER__) && __BYTE_ORDER__ == __ORDER_BIG_ENDIAN__
+#define MNEMO_BIG_ENDIAN 1
+#define mnemo_le64(x) __builtin_bswap64(x)
+#else
+#define mnemo_le64(x) (x)
+#endif
+
+static inline uint64_t mnemo_get64(const unsigned char *p)
+{
+	uint64_t ret = 0;
+
+	for (int i = 7; i >= 0; i--)
+		ret = ret << 8 | p[i];
+	return ret;
+}
+
+static inline void mnemo_put64(unsigned char *p, uint64_t v)
+{
+	for (int i = 0; i < 8; i++, v >>= 8)
+		p[i] = v & 0xff;
+}
+
+#endif /* MNEMO_INTERNAL_ENDIAN_H */
@@ -0,0 +1,90 @@
+/*
+ * Fenwick tree (binary indexed tree) over a fixed number of positions.
+ *
+ * Maintains counts at positions [0, size) with O(log size) point updates and
+ * prefix sums, in a single flat array.
+ */
+
+#ifndef MNEMO_INTERNAL_FENWICK_H
+#define MNEMO_INTERNAL_FENWICK_H 1
+
+#include <assert.h>
+#include <inttypes.h>
+#include <stddef.h>
+#include <stdlib.h>
+#include <string.h>
+
+struct mnemo_fenwick {
+	size_t size;
+	/* 1-based: tree[i] holds the sum of positions [i - lowbit(i), i) */
+	int64_t *tree;
+};
+
+static inline void mnemo_fenwick_init(struct mnemo_fenwick *f, size_t size)
+{
+	f->size = size;
+	f->tree = calloc(size + 1, sizeof(*f->tree));
+	assert(f->tree != NULL);
+}
+
+static inline void mnemo_fenwick_fini(struct mnemo_fenwick *f)
+{
+	free(f->tree);
+	f->tree = NULL;
+	f->size = 0;
+}
+
+/* change the number of positions of the tree, discarding all counts. */
+static inline void mnemo_fenwick_resize(struct mnemo_fenwick *f, size_t size)
+{
+	mnemo_fenwick_fini(f);
+	mnemo_fenwick_init(f, size);
+}
+
+/* add v to the count at position pos. */
+static inline void mnemo_fenwick_add(struct mnemo_fenwick *f, size_t pos,
+				     int64_t v)
+{
+	for (size_t i = pos + 1; i <= f->size; i += i & -i)
+		f->tree[i] += v;
+}
+
+/* sum of the counts at positions [0, pos). */
+static inline int64_t mnemo_fenwick_prefix(const struct mnemo_fenwick *f,
+					   size_t pos)
+{
+	int64_t ret = 0;
+
+	for (size_t i = pos; i > 0; i -= i & -i)
+		ret += f->tree[i];
+	return ret;
+}
+
+/* reset the tree to a count of one at positions [0, n) and zero elsewhere, in
+ * O(size).
+ */
+static inline void mnemo_fenwick_fill(struct mnemo_fenwick *f, size_t n)
+{
+	for (size_t i = 1; i <= f->size; i++) {
+		size_t lo = i - (i & -i);
+		size_t hi = i < n ? i : n;
+
+		f->tree[i] = hi > lo ? (int64_t)(hi - lo) : 0;
+	}
+}
+
+/* reset the tree to the counts of an array of n <= size values, in O(size). */
+static inline void mnemo_fenwick_build(struct mnemo_fenwick *f,
+				       const int64_t *values, size_t n)
+{
+	for (size_t i = 1; i <= f->size; i++)
+		f->tree[i] = i <= n ? values[i - 1] : 0;
+	for (size_t i = 1; i <= f->size; i++) {
+		size_t j = i + (i & -i);
+
+		if (j <= f->size)
+			f->tree[j] += f->tree[i];
+	}
+}
+
+#endif /* MNEMO_INTERNAL_FENWICK_H */
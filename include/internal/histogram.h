@@ -0,0 +1,71 @@
+/*
+ * Histogram of reuse distances, updated from the reuse distance manager.
+ *
+ * Bins are either powers of two or fixed-width ranges of distances, the last
+ * bin collecting all the distances beyond the others. Counts are weighted, so
+ * that sampled accesses can stand for the accesses they represent.
+ */
+
+#ifndef MNEMO_INTERNAL_HISTOGRAM_H
+#define MNEMO_INTERNAL_HISTOGRAM_H 1
+
+#include <mnemo.h>
+
+struct mnemo_histogram {
+	enum mnemo_histogram_scale scale;
+	/* width of a bin on a linear scale */
+	unsigned long long width;
+	size_t nbins;
+	double cold;
+	double *bins;
+};
+
+/* number of significant bits of a value, 0 for 0 */
+static inline size_t mnemo_histogram_bits(unsigned long long x)
+{
+	size_t ret;
+
+	if (x == 0)
+		return 0;
+#if defined(__GNUC__)
+	ret = 64 - __builtin_clzll(x);
+#else
+	for (ret = 0; x != 0; x >>= 1)
+		ret++;
+#endif
+	return ret;
+}
+
+/* index of the bin of a distance */
+static inline size_t mnemo_histogram_bin(const struct mnemo_histogram *h,
+					 unsigned long long distance)
+{
+	size_t bin;
+
+	if (h->scale == MNEMO_HISTOGRAM_LINEAR)
+		bin = distance / h->width;
+	else
+		bin = mnemo_histogram_bits(distance);
+	return bin < h->nbins ? bin : h->nbins - 1;
+}
+
+/* smallest distance of a bin */
+static inline unsigned long long
+mnemo_histogram_start(const struct mnemo_histogram *h, size_t bin)
+{
+	if (h->scale == MNEMO_HISTOGRAM_LINEAR)
+		return bin * h->width;
+	return bin == 0 ? 0 : 1ULL << (bin - 1);
+}
+
+/* count an access, weighted by count. Negative distances are cold misses. */
+static inline void mnemo_histogram_count(struct mnemo_histogram *h,
+					 int64_t distance, double count)
+{
+	if (distance < 0)
+		h->cold += count;
+	else
+		h->bins[mnemo_histogram_bin(h, distance)] += count;
+}
+
+#endif /* MNEMO_INTERNAL_HISTOGRAM_H */
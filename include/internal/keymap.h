@@ -0,0 +1,194 @@
+/*
+ * Open addressing hashmap from 64-bit keys to 64-bit values.
+ *
+ * Keys and values are stored inline in a flat array of slots, 4 slots per
+ * cache line, and collisions are resolved by linear probing. A lookup touches
+ * a single cache line in the common case, and the slot of an upcoming key can
+ * be prefetched from its hash alone.
+ *
+ * The value MNEMO_KEYMAP_EMPTY marks free slots and cannot be stored.
+ */
+
+#ifndef MNEMO_INTERNAL_KEYMAP_H
+#define MNEMO_INTERNAL_KEYMAP_H 1
+
+#include <assert.h>
+#include <inttypes.h>
+#include <stddef.h>
+#include <stdlib.h>
+
+#define MNEMO_KEYMAP_EMPTY UINT64_MAX
+
+/* smallest number of slots of a map */
+#define MNEMO_KEYMAP_MIN_SLOTS 64
+
+struct mnemo_keymap_slot {
+	uint64_t key;
+	uint64_t value;
+};
+
+struct mnemo_keymap {
+	struct mnemo_keymap_slot *slots;
+	/* number of slots minus one, slots are a power of two */
+	size_t mask;
+	size_t count;
+};
+
+/* finalizer of murmurhash3, enough to spread integer keys over the slots. */
+static inline uint64_t mnemo_keymap_hash(uint64_t key)
+{
+	key ^= key >> 33;
+	key *= 0xff51afd7ed558ccdULL;
+	key ^= key >> 33;
+	key *= 0xc4ceb9fe1a85ec53ULL;
+	key ^= key >> 33;
+	return key;
+}
+
+/* the map is kept at most 3/4 full. */
+static inline int mnemo_keymap_full(const struct mnemo_keymap *m, size_t count)
+{
+	return count > (m->mask + 1) / 4 * 3;
+}
+
+static inline void mnemo_keymap_alloc(struct mnemo_keymap *m, size_t nslots)
+{
+	m->slots = malloc(nslots * sizeof(*m->slots));
+	assert(m->slots != NULL);
+	for (size_t i = 0; i < nslots; i++)
+		m->slots[i].value = MNEMO_KEYMAP_EMPTY;
+	m->mask = nslots - 1;
+	m->count = 0;
+}
+
+/* initialize a map sized to hold nkeys without growing. */
+static inline void mnemo_keymap_init(struct mnemo_keymap *m, size_t nkeys)
+{
+	size_t nslots = MNEMO_KEYMAP_MIN_SLOTS;
+
+	while (nslots < nkeys + nkeys / 3 + 1)
+		nslots *= 2;
+	mnemo_keymap_alloc(m, nslots);
+}
+
+static inline void mnemo_keymap_fini(struct mnemo_keymap *m)
+{
+	free(m->slots);
+	m->slots = NULL;
+	m->mask = 0;
+	m->count = 0;
+}
+
+/* remove all keys, keeping the current size. */
+static inline void mnemo_keymap_clear(struct mnemo_keymap *m)
+{
+	for (size_t i = 0; i <= m->mask; i++)
+		m->slots[i].value = MNEMO_KEYMAP_EMPTY;
+	m->count = 0;
+}
+
+static inline void mnemo_keymap_prefetch(const struct mnemo_keymap *m,
+					 uint64_t hash)
+{
+#if defined(__GNUC__)
+	__builtin_prefetch(&m->slots[hash & m->mask]);
+#else
+	(void)m;
+	(void)hash;
+#endif
+}
+
+/* return the slot of a key, NULL if the key is absent. */
+static inline struct mnemo_keymap_slot *
+mnemo_keymap_find(const struct mnemo_keymap *m, uint64_t key, uint64_t hash)
+{
+	for (size_t i = hash & m->mask;; i = (i + 1) & m->mask) {
+		struct mnemo_keymap_slot *s = &m->slots[i];
+
+		if (s->value == MNEMO_KEYMAP_EMPTY)
+			return NULL;
+		if (s->key == key)
+			return s;
+	}
+}
+
+/* double the number of slots, rehashing all keys. */
+static inline void mnemo_keymap_grow(struct mnemo_keymap *m)
+{
+	struct mnemo_keymap_slot *old = m->slots;
+	size_t nslots = m->mask + 1, count = m->count;
+
+	mnemo_keymap_alloc(m, 2 * nslots);
+	for (size_t i = 0; i < nslots; i++) {
+		size_t j;
+
+		if (old[i].value == MNEMO_KEYMAP_EMPTY)
+			continue;
+		j = mnemo_keymap_hash(old[i].key) & m->mask;
+		while (m->slots[j].value != MNEMO_KEYMAP_EMPTY)
+			j = (j + 1) & m->mask;
+		m->slots[j] = old[i];
+	}
+	m->count = count;
+	free(old);
+}
+
+/* return the slot of a key, inserting it if absent. A new slot has an
+ * MNEMO_KEYMAP_EMPTY value, which the caller must replace right away.
+ * Inserting a key invalidates the slots previously returned.
+ * @param[out] found whether the key was already present.
+ */
+static inline struct mnemo_keymap_slot *
+mnemo_keymap_lookup(struct mnemo_keymap *m, uint64_t key, uint64_t hash,
+		    int *found)
+{
+	size_t i;
+
+	for (i = hash & m->mask;; i = (i + 1) & m->mask) {
+		struct mnemo_keymap_slot *s = &m->slots[i];
+
+		if (s->value == MNEMO_KEYMAP_EMPTY)
+			break;
+		if (s->key == key) {
+			*found = 1;
+			return s;
+		}
+	}
+	*found = 0;
+	if (mnemo_keymap_full(m, m->count + 1)) {
+		mnemo_keymap_grow(m);
+		for (i = hash & m->mask; m->slots[i].value != MNEMO_KEYMAP_EMPTY;
+		     i = (i + 1) & m->mask)
+			;
+	}
+	m->count++;
+	m->slots[i].key = key;
+	return &m->slots[i];
+}
+
+/* remove the key of a slot. Keys probed after it are shifted back to keep
+ * their probe sequences free of holes, which invalidates the slots previously
+ * returned.
+ */
+static inline void mnemo_keymap_remove(struct mnemo_keymap *m,
+				       struct mnemo_keymap_slot *s)
+{
+	size_t hole = s - m->slots;
+
+	for (size_t i = (hole + 1) & m->mask;
+	     m->slots[i].value != MNEMO_KEYMAP_EMPTY; i = (i + 1) & m->mask) {
+		size_t home = mnemo_keymap_hash(m->slots[i].key) & m->mask;
+
+		/* a key can fill the hole if its home slot isn't between
+		 * the hole and its current slot.
+		 */
+		if (((i - home) & m->mask) >= ((i - hole) & m->mask)) {
+			m->slots[hole] = m->slots[i];
+			hole = i;
+		}
+	}
+	m->slots[hole].value = MNEMO_KEYMAP_EMPTY;
+	m->count--;
+}
+
+#endif /* MNEMO_INTERNAL_KEYMAP_H */
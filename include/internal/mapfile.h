@@ -0,0 +1,59 @@
+/*
+ * Read-only mapping of the files saved by the library.
+ *
+ * A file is mapped whole, once it is known to hold at least the header of its
+ * format and to start with the magic string of that format. Loaders then
+ * validate the rest of the header against the size of the mapping, and unmap
+ * it with munmap once done.
+ */
+
+#ifndef MNEMO_INTERNAL_MAPFILE_H
+#define MNEMO_INTERNAL_MAPFILE_H 1
+
+#include <mnemo.h>
+
+#include <fcntl.h>
+#include <sys/stat.h>
+
+/* map a file of at least header bytes starting with magic, or return NULL
+ * with errno set, to EINVAL if the file is not of the expected format.
+ */
+static inline const unsigned char *mnemo_mapfile(const char *path,
+						 const char *magic,
+						 size_t header, size_t *size)
+{
+	const unsigned char *map;
+	struct stat st;
+	int fd, err;
+
+	fd = open(path, O_RDONLY);
+	if (fd == -1)
+		return NULL;
+	if (fstat(fd, &st) == -1)
+		goto err_close;
+	if (st.st_size < 0 || (uint64_t)st.st_size < header) {
+		close(fd);
+		errno = EINVAL;
+		return NULL;
+	}
+	*size = st.st_size;
+	map = mmap(NULL, *size, PROT_READ, MAP_PRIVATE, fd, 0);
+	if (map == MAP_FAILED)
+		goto err_close;
+	madvise((void *)map, *size, MADV_SEQUENTIAL);
+	/* the mapping keeps the file open */
+	close(fd);
+	if (memcmp(map, magic, strlen(magic))) {
+		munmap((void *)map, *size);
+		errno = EINVAL;
+		return NULL;
+	}
+	return map;
+err_close:
+	err = errno;
+	close(fd);
+	errno = err;
+	return NULL;
+}
+
+#endif /* MNEMO_INTERNAL_MAPFILE_H */
@@ -0,0 +1,159 @@
+/*
+ * Online phase detection over the snapshots of a series.
+ *
+ * The signature of an interval is its histogram, cold misses in an extra bin,
+ * normalized to a sum of 1, so that intervals of different lengths compare.
+ * Each snapshot is compared to the previous one with a Manhattan distance, in
+ * [0, 2]: within the threshold, the interval extends the current run of the
+ * current phase. Otherwise a new run starts, in the known phase whose
+ * centroid is the closest within the threshold, or in a new phase.
+ *
+ * Phases keep the sum of the signatures of their intervals, in a single flat
+ * array, one row per phase, and runs are appended to a growable array.
+ */
+
+#ifndef MNEMO_INTERNAL_PHASES_H
+#define MNEMO_INTERNAL_PHASES_H 1
+
+#include <mnemo.h>
+
+struct mnemo_phases {
+	double threshold;
+	/* length of the signatures, the number of bins plus one */
+	size_t nsig;
+	/* signatures of the previous and of the current interval */
+	double *prev, *cur;
+	size_t nphases, maxphases;
+	double *sums;
+	size_t *counts;
+	size_t nruns, maxruns;
+	struct mnemo_phase *runs;
+};
+
+/* normalized signature of a row of bins and its cold misses */
+static inline void mnemo_phases_signature(size_t nsig, const double *bins,
+					  double cold, double *sig)
+{
+	double total = cold;
+
+	for (size_t i = 0; i + 1 < nsig; i++)
+		total += bins[i];
+	if (total <= 0.0)
+		total = 1.0;
+	for (size_t i = 0; i + 1 < nsig; i++)
+		sig[i] = bins[i] / total;
+	sig[nsig - 1] = cold / total;
+}
+
+static inline double mnemo_phases_manhattan(size_t nsig, const double *a,
+					    const double *b)
+{
+	double ret = 0.0;
+
+	for (size_t i = 0; i < nsig; i++)
+		ret += a[i] > b[i] ? a[i] - b[i] : b[i] - a[i];
+	return ret;
+}
+
+/* Manhattan distance between a signature and the centroid of a phase */
+static inline double mnemo_phases_centroid_dist(const struct mnemo_phases *p,
+						size_t id, const double *sig)
+{
+	const double *sum = &p->sums[id * p->nsig];
+	double ret = 0.0;
+
+	for (size_t i = 0; i < p->nsig; i++) {
+		double d = sum[i] / p->counts[id] - sig[i];
+
+		ret += d > 0.0 ? d : -d;
+	}
+	return ret;
+}
+
+/* known phase closest to a signature within the threshold, or a new one */
+static inline size_t mnemo_phases_match(struct mnemo_phases *p,
+					const double *sig)
+{
+	size_t best = p->nphases;
+	double bestd = p->threshold;
+
+	for (size_t id = 0; id < p->nphases; id++) {
+		double d = mnemo_phases_centroid_dist(p, id, sig);
+
+		if (d <= bestd) {
+			best = id;
+			bestd = d;
+		}
+	}
+	if (best < p->nphases)
+		return best;
+	if (p->nphases == p->maxphases) {
+		p->maxphases = p->maxphases ? 2 * p->maxphases : 16;
+		p->sums = realloc(p->sums,
+				  p->maxphases * p->nsig * sizeof(*p->sums));
+		p->counts = realloc(p->counts,
+				    p->maxphases * sizeof(*p->counts));
+		assert(p->sums != NULL && p->counts != NULL);
+	}
+	memset(&p->sums[best * p->nsig], 0, p->nsig * sizeof(*p->sums));
+	p->counts[best] = 0;
+	p->nphases++;
+	return best;
+}
+
+static inline void mnemo_phases_start_run(struct mnemo_phases *p, size_t id,
+					  size_t interval,
+					  unsigned long long start)
+{
+	struct mnemo_phase *r;
+
+	if (p->nruns == p->maxruns) {
+		p->maxruns = p->maxruns ? 2 * p->maxruns : 64;
+		p->runs = realloc(p->runs, p->maxruns * sizeof(*p->runs));
+		assert(p->runs != NULL);
+	}
+	r = &p->runs[p->nruns++];
+	r->id = id;
+	r->first = interval;
+	r->count = 0;
+	r->start = start;
+	r->length = 0;
+}
+
+/* classify the interval of a new snapshot, at index interval of its series */
+static inline void mnemo_phases_classify(struct mnemo_phases *p,
+					 const double *bins, double cold,
+					 size_t nbins, size_t interval,
+					 unsigned long long start,
+					 unsigned long long length)
+{
+	struct mnemo_phase *r;
+	double *tmp, *sum;
+
+	/* the first interval sets the size of the signatures */
+	if (p->nruns == 0 && p->nsig != nbins + 1) {
+		p->nsig = nbins + 1;
+		p->prev = realloc(p->prev, p->nsig * sizeof(*p->prev));
+		p->cur = realloc(p->cur, p->nsig * sizeof(*p->cur));
+		assert(p->prev != NULL && p->cur != NULL);
+		p->nphases = p->maxphases = 0;
+	}
+	assert(p->nsig == nbins + 1);
+	mnemo_phases_signature(p->nsig, bins, cold, p->cur);
+	if (p->nruns == 0 ||
+	    mnemo_phases_manhattan(p->nsig, p->prev, p->cur) > p->threshold)
+		mnemo_phases_start_run(p, mnemo_phases_match(p, p->cur),
+				       interval, start);
+	r = &p->runs[p->nruns - 1];
+	r->count++;
+	r->length += length;
+	sum = &p->sums[r->id * p->nsig];
+	for (size_t i = 0; i < p->nsig; i++)
+		sum[i] += p->cur[i];
+	p->counts[r->id]++;
+	tmp = p->prev;
+	p->prev = p->cur;
+	p->cur = tmp;
+}
+
+#endif /* MNEMO_INTERNAL_PHASES_H */
@@ -0,0 +1,72 @@
+/*
+ * Table of disjoint key ranges, to aggregate statistics per region of the
+ * address space.
+ *
+ * Ranges are kept sorted by start in two flat arrays, and a key is located by
+ * binary search on the starts. Accesses tend to stay in the same range for a
+ * while, so the last range found is checked first.
+ */
+
+#ifndef MNEMO_INTERNAL_RANGES_H
+#define MNEMO_INTERNAL_RANGES_H 1
+
+#include <mnemo.h>
+
+struct mnemo_ranges {
+	size_t n;
+	unsigned long long *starts;
+	unsigned long long *ends;
+	/* last range found */
+	size_t last;
+};
+
+/* copy a table of n ranges, sorted and disjoint. */
+static inline void mnemo_ranges_init(struct mnemo_ranges *r,
+				     const struct mnemo_range *ranges, size_t n)
+{
+	assert(n == 0 || ranges != NULL);
+	r->n = n;
+	r->starts = malloc(n * sizeof(*r->starts));
+	r->ends = malloc(n * sizeof(*r->ends));
+	assert(n == 0 || (r->starts != NULL && r->ends != NULL));
+	for (size_t i = 0; i < n; i++) {
+		assert(ranges[i].start < ranges[i].end);
+		assert(i == 0 || ranges[i].start >= ranges[i - 1].end);
+		r->starts[i] = ranges[i].start;
+		r->ends[i] = ranges[i].end;
+	}
+	r->last = 0;
+}
+
+static inline void mnemo_ranges_fini(struct mnemo_ranges *r)
+{
+	free(r->starts);
+	free(r->ends);
+}
+
+/* index of the range of a key, r->n if it is in none. */
+static inline size_t mnemo_ranges_find(struct mnemo_ranges *r,
+				       unsigned long long key)
+{
+	size_t lo = 0, hi = r->n;
+
+	if (r->n == 0)
+		return 0;
+	if (key >= r->starts[r->last] && key < r->ends[r->last])
+		return r->last;
+	/* first range starting after the key */
+	while (lo < hi) {
+		size_t mid = lo + (hi - lo) / 2;
+
+		if (r->starts[mid] <= key)
+			lo = mid + 1;
+		else
+			hi = mid;
+	}
+	if (lo == 0 || key >= r->ends[lo - 1])
+		return r->n;
+	r->last = lo - 1;
+	return r->last;
+}
+
+#endif /* MNEMO_INTERNAL_RANGES_H */
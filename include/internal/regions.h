@@ -0,0 +1,54 @@
+/*
+ * Reuse statistics aggregated per region of keys, updated from the reuse
+ * distance manager.
+ *
+ * Each region keeps its counts and a small log2 histogram of its distances,
+ * the histograms of all regions sharing a single flat array of bins. Keys in
+ * no region are counted in an extra region after the others.
+ */
+
+#ifndef MNEMO_INTERNAL_REGIONS_H
+#define MNEMO_INTERNAL_REGIONS_H 1
+
+#include <mnemo.h>
+
+#include <internal/histogram.h>
+#include <internal/ranges.h>
+
+struct mnemo_region {
+	struct mnemo_histogram hist;
+	double accesses;
+	/* sum of the distances, weighted as the accesses */
+	double sum;
+	int64_t max;
+};
+
+struct mnemo_regions {
+	struct mnemo_ranges ranges;
+	size_t nbins;
+	struct mnemo_region *regions;
+	double *bins;
+};
+
+/* count an access to a key, weighted by count. Skipped accesses are not
+ * counted.
+ */
+static inline void mnemo_regions_count(struct mnemo_regions *g,
+				       unsigned long long key,
+				       int64_t distance, double count)
+{
+	struct mnemo_region *r;
+
+	if (distance == MNEMO_REUSE_SKIPPED)
+		return;
+	r = &g->regions[mnemo_ranges_find(&g->ranges, key)];
+	r->accesses += count;
+	mnemo_histogram_count(&r->hist, distance, count);
+	if (distance >= 0) {
+		r->sum += distance * count;
+		if (distance > r->max)
+			r->max = distance;
+	}
+}
+
+#endif /* MNEMO_INTERNAL_REGIONS_H */
@@ -0,0 +1,108 @@
+/*
+ * Lock-free single producer, single consumer ring of keys.
+ *
+ * The producer and the consumer each own one index, on its own cache line,
+ * and only read the other one when they run out of room or of keys. The
+ * producer can also batch the publication of its index, so that pushing a key
+ * is a single store in the common case.
+ */
+
+#ifndef MNEMO_INTERNAL_RING_H
+#define MNEMO_INTERNAL_RING_H 1
+
+#include <assert.h>
+#include <inttypes.h>
+#include <stddef.h>
+#include <stdlib.h>
+
+#define MNEMO_CACHELINE 64
+
+struct mnemo_ring {
+	unsigned long long *slots;
+	/* number of slots minus one, slots are a power of two */
+	uint64_t mask;
+	char pad0[MNEMO_CACHELINE - sizeof(void *) - sizeof(uint64_t)];
+	/* producer: next slot to fill, and last known consumer index */
+	uint64_t head;
+	uint64_t tail_cache;
+	char pad1[MNEMO_CACHELINE - 2 * sizeof(uint64_t)];
+	/* shared: the keys before published can be consumed */
+	uint64_t published;
+	char pad2[MNEMO_CACHELINE - sizeof(uint64_t)];
+	/* consumer: the keys before tail have been consumed */
+	uint64_t tail;
+	char pad3[MNEMO_CACHELINE - sizeof(uint64_t)];
+};
+
+/* initialize a ring of at least capacity keys. */
+static inline void mnemo_ring_init(struct mnemo_ring *r, size_t capacity)
+{
+	size_t nslots = 2;
+
+	while (nslots < capacity)
+		nslots *= 2;
+	r->slots = malloc(nslots * sizeof(*r->slots));
+	assert(r->slots != NULL);
+	r->mask = nslots - 1;
+	r->head = r->tail_cache = 0;
+	r->published = 0;
+	r->tail = 0;
+}
+
+static inline void mnemo_ring_fini(struct mnemo_ring *r)
+{
+	free(r->slots);
+	r->slots = NULL;
+}
+
+/* producer: make all the pushed keys visible to the consumer. */
+static inline void mnemo_ring_publish(struct mnemo_ring *r)
+{
+	__atomic_store_n(&r->published, r->head, __ATOMIC_RELEASE);
+}
+
+/* producer: whether there is no room for another key. */
+static inline int mnemo_ring_full(struct mnemo_ring *r)
+{
+	if (r->head - r->tail_cache <= r->mask)
+		return 0;
+	r->tail_cache = __atomic_load_n(&r->tail, __ATOMIC_ACQUIRE);
+	return r->head - r->tail_cache > r->mask;
+}
+
+/* producer: append a key, the ring must not be full. */
+static inline void mnemo_ring_push(struct mnemo_ring *r,
+				   unsigned long long key)
+{
+	r->slots[r->head & r->mask] = key;
+	r->head++;
+}
+
+/* producer: whether the consumer has consumed all the pushed keys. */
+static inline int mnemo_ring_drained(struct mnemo_ring *r)
+{
+	return __atomic_load_n(&r->tail, __ATOMIC_ACQUIRE) == r->head;
+}
+
+/* consumer: return the next published keys, contiguous in memory.
+ * @param[out] n the number of keys available.
+ */
+static inline const unsigned long long *mnemo_ring_peek(struct mnemo_ring *r,
+							size_t *n)
+{
+	uint64_t published = __atomic_load_n(&r->published, __ATOMIC_ACQUIRE);
+	uint64_t start = r->tail & r->mask;
+
+	*n = published - r->tail;
+	if (*n > r->mask + 1 - start)
+		*n = r->mask + 1 - start;
+	return &r->slots[start];
+}
+
+/* consumer: give n keys back to the producer. */
+static inline void mnemo_ring_consume(struct mnemo_ring *r, size_t n)
+{
+	__atomic_store_n(&r->tail, r->tail + n, __ATOMIC_RELEASE);
+}
+
+#endif /* MNEMO_INTERNAL_RING_H */
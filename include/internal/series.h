@@ -0,0 +1,71 @@
+/*
+ * Time series of histogram snapshots, one per interval of a trace.
+ *
+ * The bins of all the snapshots are stored in a single flat array, one row per
+ * interval, along with the cold misses, first access and length of each
+ * interval. Taking a snapshot copies the bins of the histogram to the next row
+ * and clears them, without looking at the reuse distance manager. An attached
+ * phase detector then classifies the new snapshot.
+ */
+
+#ifndef MNEMO_INTERNAL_SERIES_H
+#define MNEMO_INTERNAL_SERIES_H 1
+
+#include <mnemo.h>
+
+#include <internal/histogram.h>
+#include <internal/phases.h>
+
+struct mnemo_series {
+	/* number of bins of the histograms, the rows are sized for it */
+	size_t nbins;
+	size_t n, max;
+	double *bins;
+	double *cold;
+	unsigned long long *starts;
+	unsigned long long *lengths;
+	/* phase detector classifying each snapshot, if any */
+	struct mnemo_phases *phases;
+};
+
+static inline void mnemo_series_grow(struct mnemo_series *s)
+{
+	s->max = s->max ? 2 * s->max : 64;
+	s->bins = realloc(s->bins, s->max * s->nbins * sizeof(*s->bins));
+	s->cold = realloc(s->cold, s->max * sizeof(*s->cold));
+	s->starts = realloc(s->starts, s->max * sizeof(*s->starts));
+	s->lengths = realloc(s->lengths, s->max * sizeof(*s->lengths));
+	assert(s->bins != NULL && s->cold != NULL && s->starts != NULL &&
+	       s->lengths != NULL);
+}
+
+/* close the current interval of a histogram, of length accesses starting at
+ * access start: append its counts to the series, and reset the histogram.
+ */
+static inline void mnemo_series_snapshot(struct mnemo_series *s,
+					 struct mnemo_histogram *h,
+					 unsigned long long start,
+					 unsigned long long length)
+{
+	/* an empty series takes the size of the first histogram */
+	if (s->n == 0 && s->nbins != h->nbins) {
+		s->nbins = h->nbins;
+		s->max = 0;
+	}
+	assert(s->nbins == h->nbins);
+	if (s->n == s->max)
+		mnemo_series_grow(s);
+	memcpy(&s->bins[s->n * s->nbins], h->bins, s->nbins * sizeof(*h->bins));
+	memset(h->bins, 0, s->nbins * sizeof(*h->bins));
+	s->cold[s->n] = h->cold;
+	h->cold = 0.0;
+	s->starts[s->n] = start;
+	s->lengths[s->n] = length;
+	if (s->phases != NULL)
+		mnemo_phases_classify(s->phases, &s->bins[s->n * s->nbins],
+				      s->cold[s->n], s->nbins, s->n, start,
+				      length);
+	s->n++;
+}
+
+#endif /* MNEMO_INTERNAL_SERIES_H */
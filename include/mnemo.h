@@ -31,19 +31,147 @@ struct mnemo_reusedm;
 /*
  * Allocate and initialize a new reuse distance manager.
  * @param[in] max the maximum number of keys the trace will contain, 0 if
- * unknown.
+ * unknown. When known, all internal structures are sized for that many keys
+ * upfront, and adding up to max distinct keys never allocates memory.
  * @return a new opaque handle.
  */
 struct mnemo_reusedm *mnemo_reusedm_init(size_t max);
 
+/*
+ * Data structures available to count the unique keys accessed between two
+ * accesses to the same key. All engines compute the exact same distances.
+ * - MNEMO_REUSE_SPLAY: a splay tree of the last access of each key, memory
+ *   only depends on the number of keys.
+ * - MNEMO_REUSE_FENWICK: a fenwick tree over access timestamps, in flat
+ *   arrays that are more cache friendly. Uses an extra 8 bytes per timestamp,
+ *   with at least twice as many timestamps as keys.
+ * Or approximate distances:
+ * - MNEMO_REUSE_APPROX: timestamps are merged into ranges whose size grows
+ *   with their distance to the present, so that the engine only needs
+ *   O(log(keys)/error) memory on top of the key map. Distances are within a
+ *   relative error bound, see mnemo_reusedm_init_approx.
+ */
+enum mnemo_reuse_engine {
+	MNEMO_REUSE_SPLAY = 0,
+	MNEMO_REUSE_FENWICK,
+	MNEMO_REUSE_APPROX,
+};
+
+/*
+ * Default relative error of the approximate engine, when created with
+ * mnemo_reusedm_init_engine.
+ */
+#define MNEMO_REUSE_APPROX_ERROR 0.01
+
+/*
+ * Allocate and initialize a new reuse distance manager using a specific
+ * engine.
+ * @param[in] max the maximum number of keys the trace will contain, 0 if
+ * unknown.
+ * @param[in] engine the data structure used to compute distances.
+ * @return a new opaque handle.
+ */
+struct mnemo_reusedm *mnemo_reusedm_init_engine(size_t max,
+						enum mnemo_reuse_engine engine);
+
+/*
+ * Allocate and initialize a new reuse distance manager computing approximate
+ * distances. Any reported distance d' of an access with exact distance d
+ * verifies |d' - d| <= error * d. Cold misses are always reported as such, and
+ * distances below 1/(2 * error) are exact.
+ * @param[in] max the maximum number of keys the trace will contain, 0 if
+ * unknown.
+ * @param[in] error the relative error bound, strictly between 0 and 1.
+ * @return a new opaque handle.
+ */
+struct mnemo_reusedm *mnemo_reusedm_init_approx(size_t max, double error);
+
+/*
+ * Distance reported for the accesses that a sampling reuse distance manager
+ * does not track.
+ */
+#define MNEMO_REUSE_SKIPPED (-2)
+
+/*
+ * Allocate and initialize a new reuse distance manager that only tracks a
+ * spatial sample of the keys: keys are hashed, and only the ones hashing below
+ * a threshold are tracked. Accesses to the other keys are rejected after a
+ * single hash computation, and reported as MNEMO_REUSE_SKIPPED. The distances
+ * of tracked accesses are scaled by the inverse of the sampling rate, to
+ * estimate the distances of the full trace.
+ * @param[in] max the maximum number of sampled keys, 0 if unknown.
+ * @param[in] engine the data structure used to compute distances.
+ * @param[in] rate the fraction of the keys to track, in (0, 1].
+ * @param[in] smax the maximum number of keys tracked at once, 0 for a fixed
+ * rate. When a new key would go over this budget, the sampling rate is lowered
+ * and the keys above the new threshold are forgotten.
+ * @return a new opaque handle.
+ */
+struct mnemo_reusedm *mnemo_reusedm_init_sampled(size_t max,
+						 enum mnemo_reuse_engine engine,
+						 double rate, size_t smax);
+
+/*
+ * Current sampling rate of a reuse distance manager, 1 if it tracks all keys.
+ */
+double mnemo_reusedm_rate(const struct mnemo_reusedm *r);
+
 /*
  * Add an access to a given key as part of the trace being analyzed.
  * @param[in] key a unique identifier for an element of a trace
  * @param[inout] r an handle to an initialized reuse distance manager.
- * @return the reuse distance of this access
+ * @return the reuse distance of this access, -1 for the first access to a key,
+ * MNEMO_REUSE_SKIPPED if the key is not sampled.
  */
 int mnemo_reusedm_add(struct mnemo_reusedm *r, unsigned long long key);
 
+/*
+ * Same as mnemo_reusedm_add, with a 64-bit distance. mnemo_reusedm_add
+ * truncates distances to an int, this variant must be used on traces with
+ * more than INT_MAX keys.
+ * @param[in] key a unique identifier for an element of a trace
+ * @param[inout] r an handle to an initialized reuse distance manager.
+ * @return the reuse distance of this access, -1 for the first access to a key,
+ * MNEMO_REUSE_SKIPPED if the key is not sampled.
+ */
+int64_t mnemo_reusedm_add64(struct mnemo_reusedm *r, unsigned long long key);
+
+/*
+ * Add a batch of accesses as part of the trace being analyzed. Equivalent to
+ * calling mnemo_reusedm_add on each key in order, but amortizes the per-call
+ * overhead and prefetches the state of upcoming keys.
+ * @param[inout] r an handle to an initialized reuse distance manager.
+ * @param[in] keys an array of n keys, in trace order.
+ * @param[in] n the number of keys in the batch.
+ * @param[out] out an array of n elements, filled with the reuse distance of
+ * each access. Can be NULL when only the attached histogram is of interest.
+ */
+void mnemo_reusedm_add_batch(struct mnemo_reusedm *r,
+			     const unsigned long long *keys, size_t n,
+			     int64_t *out);
+
+/*
+ * Add a batch of accesses, computing their distances with several threads.
+ * The batch is split into one chunk per thread, and the distances within each
+ * chunk are computed independently. Reuses that cross chunks are then
+ * resolved in trace order, from the first and last accesses to each key of
+ * each chunk. Distances are the same as with mnemo_reusedm_add_batch.
+ * The sequential part costs about two accesses per distinct key of each
+ * chunk, so that the speedup depends on how often keys are reused within a
+ * chunk. Approximate and sampling managers, and small batches, fall back to
+ * mnemo_reusedm_add_batch.
+ * @param[inout] r an handle to an initialized reuse distance manager.
+ * @param[in] keys an array of n keys, in trace order.
+ * @param[in] n the number of keys in the batch.
+ * @param[out] out an array of n elements, filled with the reuse distance of
+ * each access. Can be NULL when only the attached histogram is of interest.
+ * @param[in] nthreads the number of threads to use, 0 for one per online
+ * processor.
+ */
+void mnemo_reusedm_add_parallel(struct mnemo_reusedm *r,
+				const unsigned long long *keys, size_t n,
+				int64_t *out, unsigned int nthreads);
+
 /*
  * Reinitialize a reuse distance manager.
  */
@@ -54,4 +182,1182 @@ void mnemo_reusedm_reset(struct mnemo_reusedm *r);
  */
 void mnemo_reusedm_fini(struct mnemo_reusedm *r);
 
+/*
+ * Number of keys tracked by a reuse distance manager.
+ */
+size_t mnemo_reusedm_nkeys(const struct mnemo_reusedm *r);
+
+/*
+ * LRU stack of a reuse distance manager: the keys it tracks, by order of their
+ * last access, the least recently accessed first. The distance of the next
+ * access to a key is the number of keys after it.
+ * @param[out] keys an array of mnemo_reusedm_nkeys elements.
+ */
+void mnemo_reusedm_stack(struct mnemo_reusedm *r, unsigned long long *keys);
+
+/*
+ * Save the state of a reuse distance manager to a checkpoint file, so that a
+ * long analysis can be resumed later, in another process. The checkpoint holds
+ * the engine, the sampling parameters, and each key with its last access time,
+ * sorted by time. Attached histograms, regions and series are not saved.
+ * @param[in] r an handle to an initialized reuse distance manager.
+ * @param[in] path the file to write, truncated if it exists.
+ * @return 0 on success, a negative errno value on error.
+ */
+int mnemo_reusedm_save(struct mnemo_reusedm *r, const char *path);
+
+/*
+ * Create a reuse distance manager from a checkpoint file. The file is mapped
+ * in memory and the engine is rebuilt in linear time from the sorted keys,
+ * without replaying the trace. Accesses added to it then get the distances
+ * they would have had in the original manager.
+ * @param[in] path the checkpoint written by mnemo_reusedm_save.
+ * @return a new opaque handle, NULL on error, with errno set, to EINVAL if the
+ * file is not a valid checkpoint.
+ */
+struct mnemo_reusedm *mnemo_reusedm_load(const char *path);
+
+////////////////////////////////////////////////////////////////////////////////
+
+/*
+ * Trace files, in one of two formats:
+ * - raw arrays of little-endian 64-bit keys, mapped in memory and streamed to
+ *   the reuse distance manager without copies.
+ * - compressed traces, written by mnemo_trace_writer: keys are delta-encoded
+ *   against recent keys and stored as zigzag varints, in blocks that can be
+ *   decoded independently of each other through an index.
+ * Both are read as a sequence of blocks, the unit of work of parallel decoding.
+ */
+
+/*
+ * Opaque handle to a trace file.
+ */
+struct mnemo_trace;
+
+/*
+ * Map a trace file in memory, for sequential access.
+ * @param[in] path the path of the file.
+ * @return a new opaque handle, NULL on error, with errno set. The format is
+ * detected from the file header. A compressed trace with an invalid header, or
+ * a raw trace whose size is not a multiple of 8 bytes is invalid (EINVAL).
+ */
+struct mnemo_trace *mnemo_trace_open(const char *path);
+
+/*
+ * Number of keys in a trace.
+ */
+size_t mnemo_trace_length(const struct mnemo_trace *t);
+
+/*
+ * Number of blocks in a trace.
+ */
+size_t mnemo_trace_nblocks(const struct mnemo_trace *t);
+
+/*
+ * Number of keys in a block of a trace. All blocks have the same length but
+ * the last one.
+ * @param[in] block the index of a block, less than mnemo_trace_nblocks.
+ */
+size_t mnemo_trace_block_length(const struct mnemo_trace *t, size_t block);
+
+/*
+ * Decode a block of a trace. Blocks are independent of each other, and several
+ * threads can decode distinct blocks of the same trace at the same time.
+ * @param[in] t an handle to an opened trace.
+ * @param[in] block the index of a block, less than mnemo_trace_nblocks.
+ * @param[out] keys an array of mnemo_trace_block_length keys.
+ * @return 0 on success, -EINVAL if the block is corrupted.
+ */
+int mnemo_trace_decode(const struct mnemo_trace *t, size_t block,
+		       unsigned long long *keys);
+
+/*
+ * Unmap a trace file.
+ */
+void mnemo_trace_close(struct mnemo_trace *t);
+
+/*
+ * Add all the keys of a trace to a reuse distance manager, as with
+ * mnemo_reusedm_add_batch. Keys of a raw trace are read straight from the
+ * mapping, and pages are dropped once processed. Compressed blocks are decoded
+ * one at a time in a small buffer.
+ * @param[inout] r an handle to an initialized reuse distance manager.
+ * @param[in] t an handle to an opened trace.
+ * @param[in] output the path of a file to write the distances to, as
+ * little-endian 64-bit integers, NULL for none. The file is created or
+ * truncated, and mapped as well.
+ * @return 0 on success, a negative errno value on error, -EINVAL if a block is
+ * corrupted. Keys of the blocks before the corrupted one are already added.
+ */
+int mnemo_reuse_from_trace(struct mnemo_reusedm *r, struct mnemo_trace *t,
+			   const char *output);
+
+/*
+ * Opaque handle to a compressed trace being written.
+ */
+struct mnemo_trace_writer;
+
+/*
+ * Create a compressed trace file.
+ * @param[in] path the path of the file, created or truncated.
+ * @param[in] blocksize the number of keys per block, 0 for the default of
+ * 65536, at most 2^32 - 1. Smaller blocks allow finer grained parallel
+ * decoding, at the cost of a lower compression ratio.
+ * @return a new opaque handle, NULL on error, with errno set, to EINVAL for a
+ * block size that does not fit in the header.
+ */
+struct mnemo_trace_writer *mnemo_trace_writer_open(const char *path,
+						   size_t blocksize);
+
+/*
+ * Append keys to a compressed trace.
+ * @param[in] keys an array of n keys, in trace order.
+ * @return 0 on success, a negative errno value on error.
+ */
+int mnemo_trace_writer_add(struct mnemo_trace_writer *w,
+			   const unsigned long long *keys, size_t n);
+
+/*
+ * Write the last block and the index of a compressed trace, close the file
+ * and release the handle, even on error.
+ * @return 0 on success, a negative errno value on error.
+ */
+int mnemo_trace_writer_close(struct mnemo_trace_writer *w);
+
+////////////////////////////////////////////////////////////////////////////////
+
+/*
+ * Asynchronous front end: accesses are pushed into a lock-free ring by a
+ * single producer thread, and added to a reuse distance manager by a
+ * dedicated analysis thread. Distances are only available through the
+ * histogram attached to the manager.
+ */
+
+/*
+ * Opaque handle to an asynchronous front end.
+ */
+struct mnemo_reuse_async;
+
+/*
+ * What to do with a new access when the ring is full:
+ * - MNEMO_ASYNC_BLOCK: wait for the analysis thread to make room.
+ * - MNEMO_ASYNC_DROP: drop the access and count it. Distances of the later
+ *   accesses ignore it.
+ */
+enum mnemo_async_policy {
+	MNEMO_ASYNC_BLOCK = 0,
+	MNEMO_ASYNC_DROP,
+};
+
+/*
+ * Allocate an asynchronous front end and start its analysis thread. The reuse
+ * distance manager must not be used by anyone else until the front end is
+ * freed.
+ * @param[inout] r an handle to an initialized reuse distance manager.
+ * @param[in] capacity the minimum number of accesses the ring can hold.
+ * @param[in] policy what to do when the ring is full.
+ * @return a new opaque handle.
+ */
+struct mnemo_reuse_async *mnemo_reuse_async_init(struct mnemo_reusedm *r,
+						 size_t capacity,
+						 enum mnemo_async_policy policy);
+
+/*
+ * Push an access into the ring. Only one thread can push into a given front
+ * end. Accesses are handed to the analysis thread in small groups, so that a
+ * push is a single store in the common case.
+ * @param[inout] a an handle to an initialized asynchronous front end.
+ * @param[in] key a unique identifier for an element of a trace
+ * @return 0 on success, -EAGAIN if the access was dropped.
+ */
+int mnemo_reuse_async_push(struct mnemo_reuse_async *a,
+			   unsigned long long key);
+
+/*
+ * Wait until the analysis thread has added all the accesses pushed so far to
+ * the reuse distance manager. Must be called from the producer thread.
+ */
+void mnemo_reuse_async_flush(struct mnemo_reuse_async *a);
+
+/*
+ * Number of accesses dropped so far.
+ */
+unsigned long long mnemo_reuse_async_dropped(const struct mnemo_reuse_async *a);
+
+/*
+ * Add the remaining accesses, stop the analysis thread and free the front end.
+ * The reuse distance manager is left as is.
+ */
+void mnemo_reuse_async_fini(struct mnemo_reuse_async *a);
+
+////////////////////////////////////////////////////////////////////////////////
+
+/*
+ * Multi-producer front end: accesses from several threads are merged into a
+ * single stream, in timestamp order, for the distances of a shared cache, while
+ * the accesses of each thread are also fed to a private reuse distance manager
+ * in the same pass. Each producer thread pushes into its own buffer, without
+ * any lock, and a dedicated thread does the merging. Distances are only
+ * available through the histograms attached to the managers.
+ *
+ * An access is only merged once every other producer either pushed a newer
+ * one, or left. A producer that stays idle for long delays the merge, and the
+ * others' buffers grow in the meantime. The merge order relies on two
+ * preconditions, that are not checked:
+ * - the timestamps of a producer strictly increase. Once one of its accesses
+ *   is merged, the accesses of others with the same timestamp are merged
+ *   without waiting for it, whatever the ranks of the producers.
+ * - a producer that stops pushing publishes its accesses, and eventually
+ *   leaves, before the front end is freed. Until then, the merge waits for its
+ *   unpublished accesses, forever if it never publishes them, and accesses
+ *   that are still unpublished when the front end is freed are lost.
+ */
+
+/*
+ * Opaque handles to a multi-producer front end, and to one of its producers.
+ */
+struct mnemo_reuse_mp;
+struct mnemo_reuse_producer;
+
+/*
+ * Allocate a multi-producer front end and start its merging thread. The
+ * shared reuse distance manager must not be used by anyone else until the
+ * front end is freed.
+ * @param[inout] shared an handle to the manager of the merged stream.
+ * @return a new opaque handle.
+ */
+struct mnemo_reuse_mp *mnemo_reuse_mp_init(struct mnemo_reusedm *shared);
+
+/*
+ * Register a new producer, from the thread that will push its accesses. The
+ * merging thread cannot wait for producers it doesn't know of yet: producers
+ * should join before the others push accesses newer than their own, for
+ * example before the threads start working.
+ * @param[inout] mp an handle to an initialized multi-producer front end.
+ * @param[inout] private the manager of the accesses of this producer alone,
+ * NULL if not needed. It must not be used by anyone else until the front end is
+ * freed.
+ * @return a new opaque handle, valid until the front end is freed.
+ */
+struct mnemo_reuse_producer *mnemo_reuse_mp_join(struct mnemo_reuse_mp *mp,
+						 struct mnemo_reusedm *private);
+
+/*
+ * Push an access of a producer. Accesses are published to the merging thread
+ * in small groups, see mnemo_reuse_mp_publish.
+ * @param[inout] p an handle to a producer, only used by its own thread.
+ * @param[in] key a unique identifier for an element of a trace
+ * @param[in] time the timestamp of the access, from a clock shared by all
+ * producers, and strictly increasing for a given producer. Accesses of
+ * distinct producers with the same timestamp are ordered by producer
+ * registration.
+ */
+void mnemo_reuse_mp_push(struct mnemo_reuse_producer *p,
+			 unsigned long long key, uint64_t time);
+
+/*
+ * Make all the accesses pushed by a producer visible to the merging thread.
+ * Must be called before going idle: the others cannot be merged past the
+ * accesses that are not published yet.
+ */
+void mnemo_reuse_mp_publish(struct mnemo_reuse_producer *p);
+
+/*
+ * Publish the last accesses of a producer, that will not push anymore.
+ */
+void mnemo_reuse_mp_leave(struct mnemo_reuse_producer *p);
+
+/*
+ * Merge the remaining accesses, stop the merging thread and free the front end
+ * and its producers. All producers must have left, with mnemo_reuse_mp_leave,
+ * or their unpublished accesses are lost. The managers are left as is.
+ */
+void mnemo_reuse_mp_fini(struct mnemo_reuse_mp *mp);
+
+////////////////////////////////////////////////////////////////////////////////
+
+/*
+ * Histograms: reuse distances accumulated into bins, directly from the add
+ * loop of a reuse distance manager.
+ */
+
+/*
+ * Opaque handle to a histogram of reuse distances.
+ */
+struct mnemo_histogram;
+
+/*
+ * Binning of the distances:
+ * - MNEMO_HISTOGRAM_LOG2: bin 0 holds distance 0, and bin i > 0 the distances
+ *   in [2^(i-1), 2^i).
+ * - MNEMO_HISTOGRAM_LINEAR: bin i holds the distances in
+ *   [i * width, (i + 1) * width).
+ * In both cases, the last bin also holds all the larger distances.
+ */
+enum mnemo_histogram_scale {
+	MNEMO_HISTOGRAM_LOG2 = 0,
+	MNEMO_HISTOGRAM_LINEAR,
+};
+
+/*
+ * Allocate and initialize a new, empty histogram.
+ * @param[in] scale the binning of distances.
+ * @param[in] nbins the number of bins, at most 65 on a log2 scale.
+ * @param[in] width the width of a bin on a linear scale, ignored otherwise.
+ * @return a new opaque handle.
+ */
+struct mnemo_histogram *mnemo_histogram_init(enum mnemo_histogram_scale scale,
+					     size_t nbins,
+					     unsigned long long width);
+
+/*
+ * Attach a histogram to a reuse distance manager: every access added to the
+ * manager is then counted in the histogram, cold misses separately. The
+ * accesses of a sampling manager are counted with a weight of the inverse of
+ * the sampling rate, and skipped accesses are not counted. A histogram can be
+ * attached to several managers, but a manager only updates one histogram.
+ * @param[inout] r an handle to an initialized reuse distance manager.
+ * @param[in] h the histogram to update, NULL to detach the current one.
+ */
+void mnemo_reusedm_attach(struct mnemo_reusedm *r, struct mnemo_histogram *h);
+
+/*
+ * Count a distance in a histogram.
+ * @param[inout] h an handle to an initialized histogram.
+ * @param[in] distance a reuse distance, -1 for a cold miss. Skipped accesses
+ * are ignored.
+ * @param[in] count the weight of this distance.
+ */
+void mnemo_histogram_add(struct mnemo_histogram *h, int64_t distance,
+			 double count);
+
+/*
+ * Number of bins of a histogram.
+ */
+size_t mnemo_histogram_nbins(const struct mnemo_histogram *h);
+
+/*
+ * Counts of a histogram, as a contiguous array of nbins elements, valid until
+ * the histogram is freed or snapshot into a series.
+ */
+const double *mnemo_histogram_bins(const struct mnemo_histogram *h);
+
+/*
+ * Number of cold misses counted by a histogram.
+ */
+double mnemo_histogram_cold(const struct mnemo_histogram *h);
+
+/*
+ * Smallest distance counted in a bin of a histogram.
+ */
+unsigned long long mnemo_histogram_bin_start(const struct mnemo_histogram *h,
+					     size_t bin);
+
+/*
+ * Miss ratio curve of a fully associative LRU cache, from a histogram of the
+ * reuse distances of a trace. An access hits in a cache of size C if its
+ * distance is below C, and cold misses always miss. Ratios are exact at the
+ * start of each bin, and interpolated in between, with all the accesses of the
+ * last bin counted as misses.
+ * @param[in] h an handle to an initialized histogram.
+ * @param[in] sizes an array of n cache sizes, in keys, or NULL for the start
+ * of each bin, in which case n must be the number of bins.
+ * @param[in] n the number of cache sizes.
+ * @param[out] out an array of n elements, filled with the miss ratio at each
+ * size.
+ */
+void mnemo_histogram_mrc(const struct mnemo_histogram *h,
+			 const unsigned long long *sizes, size_t n,
+			 double *out);
+
+/*
+ * Reset all the counts of a histogram to zero.
+ */
+void mnemo_histogram_reset(struct mnemo_histogram *h);
+
+/*
+ * Frees a histogram. It must not be attached to a reuse distance manager
+ * anymore.
+ */
+void mnemo_histogram_fini(struct mnemo_histogram *h);
+
+////////////////////////////////////////////////////////////////////////////////
+
+/*
+ * Multi-granularity reuse distances: a single pass over raw addresses
+ * computes reuse distances at several granularities at once, for example cache
+ * lines, pages and huge pages. Each level is a reuse distance manager over the
+ * addresses shifted right by a given amount. Levels are processed from the
+ * finest to the coarsest, and only the accesses that change the key of a level
+ * are passed on to the next one: consecutive accesses to the same key have a
+ * distance of 0, and removing them does not change any other distance.
+ */
+
+/*
+ * Opaque handle to a multi-granularity reuse distance manager.
+ */
+struct mnemo_reuse_gran;
+
+/*
+ * Create a multi-granularity reuse distance manager.
+ * @param[in] max the maximum number of keys of the finest level, 0 if unknown.
+ * @param[in] engine the engine of the managers of all levels.
+ * @param[in] shifts an array of nlevels shift amounts, strictly increasing and
+ * less than 64. The key of an address at a level is the address shifted right
+ * by the shift of that level: 6 for 64-byte cache lines, 12 for 4 KiB pages.
+ * @param[in] nlevels the number of levels, at least 1.
+ * @return a new opaque handle.
+ */
+struct mnemo_reuse_gran *mnemo_reuse_gran_init(size_t max,
+					       enum mnemo_reuse_engine engine,
+					       const unsigned int *shifts,
+					       size_t nlevels);
+
+/*
+ * Number of levels of a multi-granularity manager.
+ */
+size_t mnemo_reuse_gran_nlevels(const struct mnemo_reuse_gran *g);
+
+/*
+ * Attach a histogram to a level of a multi-granularity manager, as with
+ * mnemo_reusedm_attach.
+ * @param[in] level the index of a level, in the order of the shifts.
+ * @param[in] h the histogram to update, NULL to detach the current one.
+ */
+void mnemo_reuse_gran_attach(struct mnemo_reuse_gran *g, size_t level,
+			     struct mnemo_histogram *h);
+
+/*
+ * Add a batch of accesses to all the levels of a multi-granularity manager.
+ * @param[inout] g an handle to an initialized multi-granularity manager.
+ * @param[in] addrs an array of n addresses, in trace order.
+ * @param[in] n the number of accesses.
+ * @param[out] out an array of nlevels * n elements, filled with the reuse
+ * distances of the accesses at each level: out[level * n + i] is the distance
+ * of access i at a level. Can be NULL when only the attached histograms are of
+ * interest.
+ */
+void mnemo_reuse_gran_add_batch(struct mnemo_reuse_gran *g,
+				const unsigned long long *addrs, size_t n,
+				int64_t *out);
+
+/*
+ * Add all the addresses of a trace to a multi-granularity manager, decoding
+ * the trace once for all levels. Distances are only counted in the attached
+ * histograms.
+ * @return 0 on success, -EINVAL if a block of the trace is corrupted.
+ */
+int mnemo_reuse_gran_from_trace(struct mnemo_reuse_gran *g,
+				struct mnemo_trace *t);
+
+/*
+ * Reinitialize all the levels of a multi-granularity manager.
+ */
+void mnemo_reuse_gran_reset(struct mnemo_reuse_gran *g);
+
+/*
+ * Frees a multi-granularity manager. Attached histograms are not freed.
+ */
+void mnemo_reuse_gran_fini(struct mnemo_reuse_gran *g);
+
+////////////////////////////////////////////////////////////////////////////////
+
+/*
+ * Set-associative cache simulator: unlike reuse distances, which model a fully
+ * associative LRU cache of any size, it counts the misses of caches of a given
+ * geometry, conflict misses included. Several configurations are simulated in
+ * a single pass over the accesses, fed as byte addresses through the same
+ * key/batch interface as the reuse distance manager.
+ */
+
+/*
+ * Replacement policy of a cache:
+ * - MNEMO_CACHE_LRU: the least recently used line of a set is evicted.
+ * - MNEMO_CACHE_PLRU: tree pseudo-LRU, as found in most hardware caches. A
+ *   binary tree of bits per set points to the half of the ways that was not
+ *   used last. Requires a power of two ways, at most 64.
+ * - MNEMO_CACHE_RANDOM: a random line of a set is evicted, from a fixed seed.
+ *   At most 64 ways.
+ */
+enum mnemo_cache_policy {
+	MNEMO_CACHE_LRU = 0,
+	MNEMO_CACHE_PLRU,
+	MNEMO_CACHE_RANDOM,
+};
+
+/*
+ * Geometry and policy of a simulated cache:
+ * - size: the capacity of the cache, in bytes
+ * - assoc: the number of ways of a set, 0 for a fully associative cache
+ * - line: the size of a line, in bytes, a power of two
+ * - policy: the replacement policy.
+ * The number of sets, size / (line * ways), must be a power of two.
+ */
+struct mnemo_cache_config {
+	unsigned long long size;
+	unsigned int assoc;
+	unsigned int line;
+	enum mnemo_cache_policy policy;
+};
+
+/*
+ * Opaque handle to a set of simulated caches.
+ */
+struct mnemo_cache;
+
+/*
+ * Create a set of independent caches, each seeing all the accesses.
+ * @param[in] configs an array of n cache configurations.
+ * @param[in] n the number of caches, at least 1.
+ * @return a new opaque handle.
+ */
+struct mnemo_cache *mnemo_cache_init(const struct mnemo_cache_config *configs,
+				     size_t n);
+
+/*
+ * Number of caches of a simulator.
+ */
+size_t mnemo_cache_nconfigs(const struct mnemo_cache *c);
+
+/*
+ * Add an access to all the caches of a simulator.
+ * @param[in] addr the byte address of the access.
+ * @param[out] out an array of one element per cache, set to 1 if the access
+ * missed in that cache, 0 if it hit. Can be NULL.
+ */
+void mnemo_cache_add(struct mnemo_cache *c, unsigned long long addr,
+		     unsigned char *out);
+
+/*
+ * Add a batch of accesses to all the caches of a simulator. Each cache goes
+ * through the whole batch on its own, so that its sets stay in cache.
+ * @param[inout] c an handle to an initialized simulator.
+ * @param[in] addrs an array of n byte addresses, in trace order.
+ * @param[in] n the number of accesses.
+ * @param[out] out an array of nconfigs * n elements: out[config * n + i] is 1
+ * if access i missed in a cache, 0 if it hit. Can be NULL when only the counts
+ * of misses are of interest.
+ */
+void mnemo_cache_add_batch(struct mnemo_cache *c,
+			   const unsigned long long *addrs, size_t n,
+			   unsigned char *out);
+
+/*
+ * Add all the addresses of a trace to a simulator, decoding the trace once for
+ * all caches.
+ * @return 0 on success, -EINVAL if a block of the trace is corrupted.
+ */
+int mnemo_cache_from_trace(struct mnemo_cache *c, struct mnemo_trace *t);
+
+/*
+ * Number of accesses added to a simulator.
+ */
+unsigned long long mnemo_cache_accesses(const struct mnemo_cache *c);
+
+/*
+ * Number of misses of a cache of a simulator.
+ * @param[in] config the index of a cache, in the order of the configurations.
+ */
+unsigned long long mnemo_cache_misses(const struct mnemo_cache *c,
+				      size_t config);
+
+/*
+ * Empty all the caches of a simulator, and reset the counts.
+ */
+void mnemo_cache_reset(struct mnemo_cache *c);
+
+/*
+ * Frees a simulator.
+ */
+void mnemo_cache_fini(struct mnemo_cache *c);
+
+////////////////////////////////////////////////////////////////////////////////
+
+/*
+ * Cache hierarchies: levels of simulated caches, where the misses of a level
+ * are looked up in the level below it. A hierarchy can hold several chains of
+ * levels, all fed by the same accesses, for example L1/L2/L3 and a two level
+ * TLB. Each level processes the misses of the level above by batches, except
+ * in chains with an inclusive level, whose back-invalidations must reach the
+ * levels above before their next access.
+ */
+
+/*
+ * Inclusion policy of a level with respect to the levels above it:
+ * - MNEMO_INCLUSION_NINE: neither inclusive nor exclusive, lines missing in the
+ *   level are filled in it, and its evictions have no effect on other levels.
+ * - MNEMO_INCLUSION_INCLUSIVE: as above, but lines evicted from the level are
+ *   also invalidated in all the levels above it. The line size of the level
+ *   must be at least the one of the levels above.
+ * - MNEMO_INCLUSION_EXCLUSIVE: the level is a victim cache of the level above:
+ *   it is only filled with the lines evicted from it, and lines that hit in the
+ *   level move up, out of it. Its line size must be the one of the level above,
+ *   which must exist.
+ */
+enum mnemo_inclusion {
+	MNEMO_INCLUSION_NINE = 0,
+	MNEMO_INCLUSION_INCLUSIVE,
+	MNEMO_INCLUSION_EXCLUSIVE,
+};
+
+/*
+ * A range of keys, from start included to end excluded.
+ */
+struct mnemo_range {
+	unsigned long long start;
+	unsigned long long end;
+};
+
+/*
+ * Level of a hierarchy without a level above it, fed with all the accesses.
+ */
+#define MNEMO_HIERARCHY_TOP SIZE_MAX
+
+/*
+ * Range of the counters of all the accesses of a level, see
+ * mnemo_hierarchy_stats.
+ */
+#define MNEMO_HIERARCHY_ALL SIZE_MAX
+
+/*
+ * A level of a hierarchy:
+ * - cache: its geometry and replacement policy
+ * - inclusion: its inclusion policy
+ * - above: the index of the level whose misses it receives, lower than the
+ *   index of this level, or MNEMO_HIERARCHY_TOP. A level has at most one level
+ *   below it.
+ */
+struct mnemo_hierarchy_level {
+	struct mnemo_cache_config cache;
+	enum mnemo_inclusion inclusion;
+	size_t above;
+};
+
+/*
+ * Hit and miss counters of a level.
+ */
+struct mnemo_cache_stats {
+	unsigned long long hits;
+	unsigned long long misses;
+};
+
+/*
+ * Opaque handle to a simulated cache hierarchy.
+ */
+struct mnemo_hierarchy;
+
+/*
+ * Create a cache hierarchy.
+ * @param[in] levels an array of nlevels levels.
+ * @param[in] nlevels the number of levels, at least 1.
+ * @param[in] ranges an array of nranges ranges of addresses, sorted and
+ * disjoint, to count hits and misses per range on top of the totals. Can be
+ * NULL if nranges is 0.
+ * @param[in] nranges the number of ranges.
+ * @return a new opaque handle.
+ */
+struct mnemo_hierarchy *
+mnemo_hierarchy_init(const struct mnemo_hierarchy_level *levels,
+		     size_t nlevels, const struct mnemo_range *ranges,
+		     size_t nranges);
+
+/*
+ * Add an access to a cache hierarchy.
+ * @param[in] addr the byte address of the access.
+ */
+void mnemo_hierarchy_add(struct mnemo_hierarchy *h, unsigned long long addr);
+
+/*
+ * Add a batch of accesses to a cache hierarchy.
+ * @param[in] addrs an array of n byte addresses, in trace order.
+ */
+void mnemo_hierarchy_add_batch(struct mnemo_hierarchy *h,
+			       const unsigned long long *addrs, size_t n);
+
+/*
+ * Add all the addresses of a trace to a cache hierarchy.
+ * @return 0 on success, -EINVAL if a block of the trace is corrupted.
+ */
+int mnemo_hierarchy_from_trace(struct mnemo_hierarchy *h,
+			       struct mnemo_trace *t);
+
+/*
+ * Hit and miss counters of a level of a hierarchy. A level counts the lookups
+ * of the accesses that reach it, the insertion of victims from the level above
+ * is not counted.
+ * @param[in] level the index of a level.
+ * @param[in] range the index of a range of addresses, the number of ranges for
+ * the accesses to addresses in no range, or MNEMO_HIERARCHY_ALL for all the
+ * accesses.
+ */
+struct mnemo_cache_stats mnemo_hierarchy_stats(const struct mnemo_hierarchy *h,
+					       size_t level, size_t range);
+
+/*
+ * Empty all the levels of a hierarchy, and reset the counters.
+ */
+void mnemo_hierarchy_reset(struct mnemo_hierarchy *h);
+
+/*
+ * Frees a cache hierarchy.
+ */
+void mnemo_hierarchy_fini(struct mnemo_hierarchy *h);
+
+////////////////////////////////////////////////////////////////////////////////
+
+/*
+ * Reuse statistics per region: a table of key ranges, one per array or
+ * allocation for example, attached to a reuse distance manager, aggregates
+ * the distances of the accesses to each region as they are computed. Regions
+ * with poor locality can then be found without joining distances back to
+ * keys.
+ */
+
+/*
+ * Opaque handle to a table of regions.
+ */
+struct mnemo_regions;
+
+/*
+ * Statistics of a region, with the weights of sampled accesses:
+ * - accesses: the number of accesses to the region
+ * - cold: the number of cold misses among them
+ * - mean: the mean distance of the other accesses, 0 if there are none
+ * - max: the largest distance, -1 if there are none.
+ */
+struct mnemo_region_stats {
+	double accesses;
+	double cold;
+	double mean;
+	int64_t max;
+};
+
+/*
+ * Create a table of regions.
+ * @param[in] ranges an array of n ranges of keys, sorted and disjoint.
+ * @param[in] n the number of regions.
+ * @param[in] nbins the number of bins of the log2 histogram of each region, at
+ * most 65. The last bin collects all the larger distances.
+ * @return a new opaque handle.
+ */
+struct mnemo_regions *mnemo_regions_init(const struct mnemo_range *ranges,
+					 size_t n, size_t nbins);
+
+/*
+ * Attach a table of regions to a reuse distance manager: every access added
+ * to the manager is then counted in the region of its key, with the same
+ * weights as in a histogram. A manager updates at most one table, and a table
+ * must not be updated by several managers at the same time.
+ * @param[inout] r an handle to an initialized reuse distance manager.
+ * @param[in] g the table to update, NULL to detach the current one.
+ */
+void mnemo_reusedm_attach_regions(struct mnemo_reusedm *r,
+				  struct mnemo_regions *g);
+
+/*
+ * Number of regions of a table.
+ */
+size_t mnemo_regions_nregions(const struct mnemo_regions *g);
+
+/*
+ * Statistics of a region.
+ * @param[in] region the index of a region, or the number of regions for the
+ * accesses to keys in no region.
+ * @param[out] out the statistics of the region.
+ */
+void mnemo_regions_stats(const struct mnemo_regions *g, size_t region,
+			 struct mnemo_region_stats *out);
+
+/*
+ * Histogram of the distances of a region, owned by the table. It can be read
+ * with the histogram functions, mnemo_histogram_mrc included, but must not be
+ * attached, reset or freed.
+ * @param[in] region the index of a region, or the number of regions for the
+ * accesses to keys in no region.
+ */
+const struct mnemo_histogram *
+mnemo_regions_histogram(const struct mnemo_regions *g, size_t region);
+
+/*
+ * Reset the statistics of all the regions to zero.
+ */
+void mnemo_regions_reset(struct mnemo_regions *g);
+
+/*
+ * Frees a table of regions. It must not be attached to a reuse distance
+ * manager anymore.
+ */
+void mnemo_regions_fini(struct mnemo_regions *g);
+
+////////////////////////////////////////////////////////////////////////////////
+
+/*
+ * Locality engine: a lighter alternative to the reuse distance manager, that
+ * only tracks the reuse time of each access, the number of accesses since the
+ * last access to the same key, with a single lookup in the same key map. From
+ * the histograms of reuse times and of first and last access times, the
+ * higher order theory of locality (HOTL, Xiang et al.) derives the average
+ * footprint of the windows of any length and predicts the miss ratio curve of
+ * a fully associative LRU cache.
+ */
+
+/*
+ * Opaque handle to a locality engine.
+ */
+struct mnemo_locality;
+
+/*
+ * Allocate and initialize a new locality engine.
+ * @param[in] max the maximum number of keys the trace will contain, 0 if
+ * unknown.
+ * @return a new opaque handle.
+ */
+struct mnemo_locality *mnemo_locality_init(size_t max);
+
+/*
+ * Add an access to a given key.
+ * @param[in] key a unique identifier for an element of a trace
+ * @return the reuse time of the access, at least 1, or -1 for the first access
+ * to the key.
+ */
+int64_t mnemo_locality_add(struct mnemo_locality *l, unsigned long long key);
+
+/*
+ * Add a batch of accesses. Equivalent to calling mnemo_locality_add on each
+ * key in order, with the map slots of upcoming keys prefetched.
+ * @param[in] keys an array of n keys, in trace order.
+ * @param[in] n the number of accesses.
+ * @param[out] out an array of n elements, filled with the reuse time of each
+ * access. Can be NULL.
+ */
+void mnemo_locality_add_batch(struct mnemo_locality *l,
+			      const unsigned long long *keys, size_t n,
+			      int64_t *out);
+
+/*
+ * Attach a histogram to a locality engine: the reuse time of every access is
+ * then counted in it, first accesses as cold misses.
+ * @param[in] h the histogram to update, NULL to detach the current one.
+ */
+void mnemo_locality_attach(struct mnemo_locality *l,
+			   struct mnemo_histogram *h);
+
+/*
+ * Number of accesses added to a locality engine.
+ */
+unsigned long long mnemo_locality_accesses(const struct mnemo_locality *l);
+
+/*
+ * Number of distinct keys accessed.
+ */
+size_t mnemo_locality_keys(const struct mnemo_locality *l);
+
+/*
+ * Average footprint of the windows of a given length: the mean number of
+ * distinct keys accessed by all the windows of w consecutive accesses of the
+ * trace so far. Times are binned within 1/32 of each other, which bounds the
+ * error of large windows.
+ * @param[in] w the length of the windows.
+ * @return the average footprint, the number of keys for windows at least as
+ * long as the trace.
+ */
+double mnemo_locality_footprint(struct mnemo_locality *l,
+				unsigned long long w);
+
+/*
+ * Miss ratio curve of a fully associative LRU cache, predicted from the
+ * average footprint: the miss ratio of a cache of size c is the growth of the
+ * footprint at the window length whose footprint is c. Caches able to hold all
+ * the keys only take cold misses.
+ * @param[in] sizes an array of n cache sizes, in keys.
+ * @param[in] n the number of cache sizes.
+ * @param[out] out an array of n elements, filled with the miss ratio at each
+ * size.
+ */
+void mnemo_locality_mrc(struct mnemo_locality *l,
+			const unsigned long long *sizes, size_t n,
+			double *out);
+
+/*
+ * Reinitialize a locality engine.
+ */
+void mnemo_locality_reset(struct mnemo_locality *l);
+
+/*
+ * Frees a locality engine. The attached histogram is not freed.
+ */
+void mnemo_locality_fini(struct mnemo_locality *l);
+
+////////////////////////////////////////////////////////////////////////////////
+
+/*
+ * Time series of histograms: the histogram attached to a reuse distance
+ * manager is snapshot at the end of each interval of the trace, and restarts
+ * from zero for the next one, while the distances keep accounting for the
+ * whole trace. Intervals end every fixed number of accesses, or on explicit
+ * marks at phase or iteration boundaries.
+ */
+
+/*
+ * Opaque handle to a series of snapshots.
+ */
+struct mnemo_series;
+
+/*
+ * Create an empty series. Its snapshots take the number of bins of the first
+ * histogram snapshot in it.
+ * @return a new opaque handle.
+ */
+struct mnemo_series *mnemo_series_init(void);
+
+/*
+ * Take snapshots of the histogram attached to a reuse distance manager. A
+ * histogram must be attached, and stay attached while snapshots are taken.
+ * Accesses skipped by sampling count in the length of intervals, and sampled
+ * managers and series force add_parallel to a sequential replay.
+ * @param[in] s the series to append snapshots to, NULL to stop taking them.
+ * @param[in] length the number of accesses of each interval, 0 to only end
+ * intervals with mnemo_reusedm_mark.
+ */
+void mnemo_reusedm_intervals(struct mnemo_reusedm *r, struct mnemo_series *s,
+			     unsigned long long length);
+
+/*
+ * End the current interval of a reuse distance manager taking snapshots.
+ * Intervals without any access are not recorded.
+ */
+void mnemo_reusedm_mark(struct mnemo_reusedm *r);
+
+/*
+ * Number of snapshots of a series.
+ */
+size_t mnemo_series_count(const struct mnemo_series *s);
+
+/*
+ * Number of bins of each snapshot, 0 for an empty series.
+ */
+size_t mnemo_series_nbins(const struct mnemo_series *s);
+
+/*
+ * Bins of a snapshot. The snapshots are stored one after the other, so the
+ * pointer to the first one is a matrix of count rows of nbins doubles, valid
+ * until the next snapshot.
+ * @param[in] i the index of a snapshot.
+ */
+const double *mnemo_series_bins(const struct mnemo_series *s, size_t i);
+
+/*
+ * Cold misses of a snapshot.
+ */
+double mnemo_series_cold(const struct mnemo_series *s, size_t i);
+
+/*
+ * Index, in the trace, of the first access of the interval of a snapshot.
+ */
+unsigned long long mnemo_series_start(const struct mnemo_series *s, size_t i);
+
+/*
+ * Number of accesses of the interval of a snapshot.
+ */
+unsigned long long mnemo_series_length(const struct mnemo_series *s, size_t i);
+
+/*
+ * Remove all the snapshots of a series.
+ */
+void mnemo_series_reset(struct mnemo_series *s);
+
+/*
+ * Frees a series. It must not be in use by a reuse distance manager.
+ */
+void mnemo_series_fini(struct mnemo_series *s);
+
+////////////////////////////////////////////////////////////////////////////////
+
+/*
+ * Phase detection: a phase detector attached to a series classifies each
+ * snapshot as it is taken. Successive intervals whose normalized histograms
+ * are within a Manhattan distance threshold belong to the same run, and a new
+ * run goes back to a known phase when its first interval is close enough to
+ * the mean histogram of that phase. One representative interval per phase can
+ * then stand for the whole phase in detailed simulations.
+ */
+
+/*
+ * Opaque handle to a phase detector.
+ */
+struct mnemo_phases;
+
+/*
+ * A run of successive intervals in the same phase:
+ * - id: the phase of the run, phases are numbered from 0 in order of
+ *   appearance
+ * - first, count: the index of the first snapshot of the run in its series,
+ *   and the number of snapshots
+ * - start, length: the index of the first access of the run in the trace,
+ *   and the number of accesses.
+ */
+struct mnemo_phase {
+	size_t id;
+	size_t first, count;
+	unsigned long long start, length;
+};
+
+/*
+ * Create a phase detector.
+ * @param[in] threshold the largest Manhattan distance between the histograms
+ * of two intervals of the same phase, normalized with cold misses to a sum of
+ * 1, in [0, 2].
+ * @return a new opaque handle.
+ */
+struct mnemo_phases *mnemo_phases_init(double threshold);
+
+/*
+ * Attach a phase detector to a series: every snapshot taken after is
+ * classified. All the snapshots must have the same number of bins, log2
+ * histograms make the best signatures.
+ * @param[in] p the phase detector, NULL to detach the current one.
+ */
+void mnemo_series_attach_phases(struct mnemo_series *s,
+				struct mnemo_phases *p);
+
+/*
+ * Number of distinct phases detected.
+ */
+size_t mnemo_phases_count(const struct mnemo_phases *p);
+
+/*
+ * Number of runs detected, the last one being the current phase.
+ */
+size_t mnemo_phases_nruns(const struct mnemo_phases *p);
+
+/*
+ * A run of a phase detector.
+ * @param[in] i the index of a run, in trace order.
+ */
+struct mnemo_phase mnemo_phases_run(const struct mnemo_phases *p, size_t i);
+
+/*
+ * Representative interval of a phase: the one whose histogram is the closest
+ * to the mean histogram of the phase.
+ * @param[in] s the series the phase detector is attached to.
+ * @param[in] id a phase.
+ * @return the index of a snapshot of the series.
+ */
+size_t mnemo_phases_representative(const struct mnemo_phases *p,
+				   const struct mnemo_series *s, size_t id);
+
+/*
+ * Forget all the phases and runs. Snapshot indices of new runs keep following
+ * the series, which is usually reset along.
+ */
+void mnemo_phases_reset(struct mnemo_phases *p);
+
+/*
+ * Frees a phase detector. It must not be attached to a series.
+ */
+void mnemo_phases_fini(struct mnemo_phases *p);
+
+////////////////////////////////////////////////////////////////////////////////
+
+/*
+ * Mergeable segments: a long trace can be split by time range into segments
+ * processed independently, on different nodes for example, and their
+ * summaries merged in trace order into the exact histogram of the whole trace.
+ * A segment summary keeps the histogram of the distances within the segment,
+ * its keys by order of first access and by order of last access. Merging a
+ * later segment into an earlier one resolves the first accesses of the later
+ * segment, cold misses on their own, against the last accesses of the earlier
+ * one. Merges cost O(k log k) for k keys in the segments, whatever their
+ * number of accesses.
+ */
+
+/*
+ * Opaque handle to a segment summary.
+ */
+struct mnemo_segment;
+
+/*
+ * Create an empty segment, with the histogram of its distances.
+ * @param[in] max the maximum number of keys of the segment, 0 if unknown.
+ * @param[in] scale the binning of the distances.
+ * @param[in] nbins the number of bins, at most 65 on a log2 scale.
+ * @param[in] width the width of a bin on a linear scale, ignored otherwise.
+ * @return a new opaque handle.
+ */
+struct mnemo_segment *mnemo_segment_init(size_t max,
+					 enum mnemo_histogram_scale scale,
+					 size_t nbins,
+					 unsigned long long width);
+
+/*
+ * Add a batch of accesses at the end of a segment, with exact distances.
+ * @param[in] keys an array of n keys, in trace order.
+ * @param[in] n the number of keys in the batch.
+ */
+void mnemo_segment_add_batch(struct mnemo_segment *s,
+			     const unsigned long long *keys, size_t n);
+
+/*
+ * Add a range of blocks of a trace file to a segment, to split a trace among
+ * several processes.
+ * @param[in] block the first block to add.
+ * @param[in] nblocks the number of blocks, the ones past the end of the trace
+ * are ignored.
+ * @return 0 on success, -EINVAL if a block is corrupted.
+ */
+int mnemo_segment_from_trace(struct mnemo_segment *s, struct mnemo_trace *t,
+			     size_t block, size_t nblocks);
+
+/*
+ * Histogram of the distances of a segment, cold misses included. Can be used
+ * with the histogram functions, mnemo_histogram_mrc included, but must not be
+ * modified or freed.
+ */
+const struct mnemo_histogram *
+mnemo_segment_histogram(const struct mnemo_segment *s);
+
+/*
+ * Number of accesses of a segment.
+ */
+unsigned long long mnemo_segment_accesses(const struct mnemo_segment *s);
+
+/*
+ * Number of distinct keys of a segment.
+ */
+size_t mnemo_segment_nkeys(const struct mnemo_segment *s);
+
+/*
+ * Merge a segment into the one right before it in the trace: a then summarizes
+ * both segments, and further accesses can be added to it. Both histograms must
+ * have the same binning.
+ * @param[inout] a the earlier segment.
+ * @param[in] b the later segment, left unchanged.
+ */
+void mnemo_segment_merge(struct mnemo_segment *a, struct mnemo_segment *b);
+
+/*
+ * Save a segment summary to a file, to merge it in another process.
+ * @param[in] path the file to write, truncated if it exists.
+ * @return 0 on success, a negative errno value on error.
+ */
+int mnemo_segment_save(struct mnemo_segment *s, const char *path);
+
+/*
+ * Create a segment from a file written by mnemo_segment_save. Its LRU stack is
+ * rebuilt from its keys by order of last access.
+ * @return a new opaque handle, NULL on error, with errno set, to EINVAL if the
+ * file is not a valid segment.
+ */
+struct mnemo_segment *mnemo_segment_load(const char *path);
+
+/*
+ * Reinitialize a segment.
+ */
+void mnemo_segment_reset(struct mnemo_segment *s);
+
+/*
+ * Frees a segment.
+ */
+void mnemo_segment_fini(struct mnemo_segment *s);
+
 #endif
@@ -8,6 +8,7 @@ pkgs.mkShell {
 	nativeBuildInputs = [ autoreconfHook pkgconfig ];
         buildInputs = [
           python3
+          python3Packages.numpy
         ];
         CFLAGS = "-std=c99 -pedantic -Wall -Wextra";
 }
@@ -0,0 +1,141 @@
+#include "config.h"
+
+#include <mnemo.h>
+
+#include <internal/ring.h>
+
+#include <pthread.h>
+#include <sched.h>
+#include <time.h>
+
+/* the producer publishes its keys every that many pushes, a power of two */
+#define MNEMO_ASYNC_PUBLISH 64
+
+/* the consumer hands keys back to the producer every that many keys at most */
+#define MNEMO_ASYNC_BATCH 4096
+
+/* time the consumer sleeps when the ring is empty, in nanoseconds */
+#define MNEMO_ASYNC_IDLE 50000
+
+/* an asynchronous front end to a reuse distance manager:
+ * - the ring the producer pushes keys into
+ * - the policy when the ring is full, and the number of keys dropped
+ * - the manager the keys are added to, by a dedicated thread, which runs until
+ *   stop is set.
+ * It is allocated on a cache line boundary, for the padding of the ring to keep
+ * the producer and the consumer apart.
+ */
+struct mnemo_reuse_async {
+	struct mnemo_ring ring;
+	enum mnemo_async_policy policy;
+	unsigned long long dropped;
+	struct mnemo_reusedm *reuse;
+	pthread_t thread;
+	int stop;
+};
+
+static void *reuse_async_run(void *arg)
+{
+	struct mnemo_reuse_async *a = arg;
+
+	for (;;) {
+		const unsigned long long *keys;
+		size_t n;
+
+		keys = mnemo_ring_peek(&a->ring, &n);
+		if (n == 0) {
+			struct timespec idle = { 0, MNEMO_ASYNC_IDLE };
+
+			/* stop is only set once all keys are published */
+			if (__atomic_load_n(&a->stop, __ATOMIC_ACQUIRE)) {
+				keys = mnemo_ring_peek(&a->ring, &n);
+				if (n == 0)
+					break;
+			} else {
+				nanosleep(&idle, NULL);
+				continue;
+			}
+		}
+		if (n > MNEMO_ASYNC_BATCH)
+			n = MNEMO_ASYNC_BATCH;
+		mnemo_reusedm_add_batch(a->reuse, keys, n, NULL);
+		mnemo_ring_consume(&a->ring, n);
+	}
+	return NULL;
+}
+
+struct mnemo_reuse_async *mnemo_reuse_async_init(struct mnemo_reusedm *r,
+						 size_t capacity,
+						 enum mnemo_async_policy policy)
+{
+	struct mnemo_reuse_async *ret;
+	void *mem;
+	int err;
+
+	assert(r != NULL);
+	assert(policy == MNEMO_ASYNC_BLOCK || policy == MNEMO_ASYNC_DROP);
+	if (capacity < MNEMO_ASYNC_PUBLISH)
+		capacity = MNEMO_ASYNC_PUBLISH;
+	err = posix_memalign(&mem, MNEMO_CACHELINE,
+			     sizeof(struct mnemo_reuse_async));
+	assert(err == 0);
+	ret = memset(mem, 0, sizeof(struct mnemo_reuse_async));
+	mnemo_ring_init(&ret->ring, capacity);
+	ret->policy = policy;
+	ret->dropped = 0;
+	ret->reuse = r;
+	ret->stop = 0;
+	err = pthread_create(&ret->thread, NULL, reuse_async_run, ret);
+	assert(err == 0);
+	(void)err;
+	return ret;
+}
+
+int mnemo_reuse_async_push(struct mnemo_reuse_async *a,
+			   unsigned long long key)
+{
+	struct mnemo_ring *ring = &a->ring;
+
+	if (mnemo_ring_full(ring)) {
+		/* the consumer might be waiting on keys not published yet */
+		mnemo_ring_publish(ring);
+		if (a->policy == MNEMO_ASYNC_DROP) {
+			a->dropped++;
+			return -EAGAIN;
+		}
+		while (mnemo_ring_full(ring))
+			sched_yield();
+	}
+	mnemo_ring_push(ring, key);
+	if ((ring->head & (MNEMO_ASYNC_PUBLISH - 1)) == 0)
+		mnemo_ring_publish(ring);
+	return 0;
+}
+
+void mnemo_reuse_async_flush(struct mnemo_reuse_async *a)
+{
+	assert(a != NULL);
+	mnemo_ring_publish(&a->ring);
+	while (!mnemo_ring_drained(&a->ring))
+		sched_yield();
+}
+
+unsigned long long mnemo_reuse_async_dropped(const struct mnemo_reuse_async *a)
+{
+	assert(a != NULL);
+	return a->dropped;
+}
+
+void mnemo_reuse_async_fini(struct mnemo_reuse_async *a)
+{
+	int err;
+
+	assert(a != NULL);
+	mnemo_ring_publish(&a->ring);
+	__atomic_store_n(&a->stop, 1, __ATOMIC_RELEASE);
+	err = pthread_join(a->thread, NULL);
+	assert(err == 0);
+	(void)err;
+	mnemo_ring_fini(&a->ring);
+	free(a);
+}
@@ -0,0 +1,128 @@
+#include "config.h"
+
+#include <mnemo.h>
+
+#include <internal/cache.h>
+
+/* a set of simulated caches:
+ * - the caches, and their number of misses
+ * - the number of accesses, common to all caches.
+ */
+struct mnemo_cache {
+	size_t n;
+	struct mnemo_cache_sim *sims;
+	unsigned long long *misses;
+	unsigned long long accesses;
+};
+
+struct mnemo_cache *mnemo_cache_init(const struct mnemo_cache_config *configs,
+				     size_t n)
+{
+	struct mnemo_cache *ret;
+
+	assert(configs != NULL && n > 0);
+	ret = malloc(sizeof(struct mnemo_cache));
+	assert(ret != NULL);
+	ret->n = n;
+	ret->sims = malloc(n * sizeof(*ret->sims));
+	ret->misses = calloc(n, sizeof(*ret->misses));
+	assert(ret->sims != NULL && ret->misses != NULL);
+	for (size_t i = 0; i < n; i++)
+		mnemo_cache_sim_init(&ret->sims[i], &configs[i]);
+	ret->accesses = 0;
+	return ret;
+}
+
+size_t mnemo_cache_nconfigs(const struct mnemo_cache *c)
+{
+	assert(c != NULL);
+	return c->n;
+}
+
+void mnemo_cache_add(struct mnemo_cache *c, unsigned long long addr,
+		     unsigned char *out)
+{
+	mnemo_cache_add_batch(c, &addr, 1, out);
+}
+
+void mnemo_cache_add_batch(struct mnemo_cache *c,
+			   const unsigned long long *addrs, size_t n,
+			   unsigned char *out)
+{
+	assert(c != NULL);
+	assert(n == 0 || addrs != NULL);
+	for (size_t k = 0; k < c->n; k++) {
+		struct mnemo_cache_sim *s = &c->sims[k];
+		unsigned long long misses = 0;
+
+		for (size_t i = 0; i < n; i++) {
+			int miss;
+
+			miss = !mnemo_cache_sim_access(s,
+						       addrs[i] >> s->lineshift);
+			misses += miss;
+			if (out != NULL)
+				out[k * n + i] = miss;
+		}
+		c->misses[k] += misses;
+	}
+	c->accesses += n;
+}
+
+int mnemo_cache_from_trace(struct mnemo_cache *c, struct mnemo_trace *t)
+{
+	unsigned long long *buf;
+	size_t nblocks;
+	int err = 0;
+
+	assert(c != NULL && t != NULL);
+	nblocks = mnemo_trace_nblocks(t);
+	if (nblocks == 0)
+		return 0;
+	/* the first block is the longest */
+	buf = malloc(mnemo_trace_block_length(t, 0) * sizeof(*buf));
+	assert(buf != NULL);
+	for (size_t b = 0; b < nblocks; b++) {
+		err = mnemo_trace_decode(t, b, buf);
+		if (err != 0)
+			break;
+		mnemo_cache_add_batch(c, buf, mnemo_trace_block_length(t, b),
+				      NULL);
+	}
+	free(buf);
+	return err;
+}
+
+unsigned long long mnemo_cache_accesses(const struct mnemo_cache *c)
+{
+	assert(c != NULL);
+	return c->accesses;
+}
+
+unsigned long long mnemo_cache_misses(const struct mnemo_cache *c,
+				      size_t config)
+{
+	assert(c != NULL);
+	assert(config < c->n);
+	return c->misses[config];
+}
+
+void mnemo_cache_reset(struct mnemo_cache *c)
+{
+	assert(c != NULL);
+	for (size_t k = 0; k < c->n; k++) {
+		mnemo_cache_sim_clear(&c->sims[k]);
+		c->misses[k] = 0;
+	}
+	c->accesses = 0;
+}
+
+void mnemo_cache_fini(struct mnemo_cache *c)
+{
+	assert(c != NULL);
+	for (size_t k = 0; k < c->n; k++)
+		mnemo_cache_sim_fini(&c->sims[k]);
+	free(c->sims);
+	free(c->misses);
+	free(c);
+}
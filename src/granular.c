@@ -0,0 +1,184 @@
+#include "config.h"
+
+#include <mnemo.h>
+
+/* number of addresses processed by all the levels before moving on to the
+ * next ones. Switching between levels evicts the state of one manager for the
+ * other, chunks must be large enough for that to be amortized.
+ */
+#define MNEMO_GRAN_CHUNK (1 << 18)
+
+/* a level:
+ * - the reuse distance manager of its keys, and the histogram attached to it
+ * - its shift, relative to the previous level
+ * - the key of the last access, if any, to drop consecutive accesses to it.
+ */
+struct reuse_gran_level {
+	struct mnemo_reusedm *reuse;
+	struct mnemo_histogram *hist;
+	unsigned int shift;
+	unsigned long long last;
+	int started;
+};
+
+/* a multi-granularity manager:
+ * - its levels, from the finest to the coarsest
+ * - the buffers of a chunk of addresses: the keys passed on to a level, the
+ *   position of their access in the chunk, and their distances.
+ */
+struct mnemo_reuse_gran {
+	size_t nlevels;
+	struct reuse_gran_level *levels;
+	unsigned long long *keys;
+	size_t *pos;
+	int64_t *dist;
+};
+
+struct mnemo_reuse_gran *mnemo_reuse_gran_init(size_t max,
+					       enum mnemo_reuse_engine engine,
+					       const unsigned int *shifts,
+					       size_t nlevels)
+{
+	struct mnemo_reuse_gran *ret;
+
+	assert(shifts != NULL && nlevels > 0);
+	ret = malloc(sizeof(struct mnemo_reuse_gran));
+	assert(ret != NULL);
+	ret->nlevels = nlevels;
+	ret->levels = calloc(nlevels, sizeof(struct reuse_gran_level));
+	ret->keys = malloc(MNEMO_GRAN_CHUNK * sizeof(*ret->keys));
+	ret->pos = malloc(MNEMO_GRAN_CHUNK * sizeof(*ret->pos));
+	ret->dist = malloc(MNEMO_GRAN_CHUNK * sizeof(*ret->dist));
+	assert(ret->levels != NULL && ret->keys != NULL && ret->pos != NULL &&
+	       ret->dist != NULL);
+	for (size_t l = 0; l < nlevels; l++) {
+		struct reuse_gran_level *level = &ret->levels[l];
+
+		assert(shifts[l] < 64);
+		assert(l == 0 || shifts[l] > shifts[l - 1]);
+		level->reuse = mnemo_reusedm_init_engine(max, engine);
+		level->hist = NULL;
+		level->shift = l == 0 ? shifts[l] : shifts[l] - shifts[l - 1];
+		level->started = 0;
+	}
+	return ret;
+}
+
+size_t mnemo_reuse_gran_nlevels(const struct mnemo_reuse_gran *g)
+{
+	assert(g != NULL);
+	return g->nlevels;
+}
+
+void mnemo_reuse_gran_attach(struct mnemo_reuse_gran *g, size_t level,
+			     struct mnemo_histogram *h)
+{
+	assert(g != NULL);
+	assert(level < g->nlevels);
+	g->levels[level].hist = h;
+	mnemo_reusedm_attach(g->levels[level].reuse, h);
+}
+
+/* add a chunk of at most MNEMO_GRAN_CHUNK addresses to all levels. The
+ * distances of the chunk at a level start at out[level * stride].
+ */
+static void reuse_gran_chunk(struct mnemo_reuse_gran *g,
+			     const unsigned long long *addrs, size_t n,
+			     int64_t *out, size_t stride)
+{
+	size_t count = n;
+
+	for (size_t l = 0; l < g->nlevels; l++) {
+		struct reuse_gran_level *level = &g->levels[l];
+		size_t next = 0;
+
+		/* the finest level reads the addresses, the others the keys
+		 * left by the previous level, in place.
+		 */
+		for (size_t i = 0; i < count; i++) {
+			unsigned long long key;
+
+			key = (l == 0 ? addrs[i] : g->keys[i]) >> level->shift;
+			if (level->started && key == level->last)
+				continue;
+			level->last = key;
+			level->started = 1;
+			g->keys[next] = key;
+			g->pos[next] = l == 0 ? i : g->pos[i];
+			next++;
+		}
+		count = next;
+		mnemo_reusedm_add_batch(level->reuse, g->keys, count,
+					out != NULL ? g->dist : NULL);
+		if (level->hist != NULL && count < n)
+			mnemo_histogram_add(level->hist, 0, n - count);
+		if (out != NULL) {
+			int64_t *o = &out[l * stride];
+
+			memset(o, 0, n * sizeof(*o));
+			for (size_t i = 0; i < count; i++)
+				o[g->pos[i]] = g->dist[i];
+		}
+	}
+}
+
+void mnemo_reuse_gran_add_batch(struct mnemo_reuse_gran *g,
+				const unsigned long long *addrs, size_t n,
+				int64_t *out)
+{
+	assert(g != NULL);
+	assert(n == 0 || addrs != NULL);
+	for (size_t i = 0; i < n; i += MNEMO_GRAN_CHUNK) {
+		size_t len = n - i < MNEMO_GRAN_CHUNK ? n - i : MNEMO_GRAN_CHUNK;
+
+		reuse_gran_chunk(g, &addrs[i], len,
+				 out != NULL ? &out[i] : NULL, n);
+	}
+}
+
+int mnemo_reuse_gran_from_trace(struct mnemo_reuse_gran *g,
+				struct mnemo_trace *t)
+{
+	unsigned long long *buf;
+	size_t nblocks;
+	int err = 0;
+
+	assert(g != NULL && t != NULL);
+	nblocks = mnemo_trace_nblocks(t);
+	if (nblocks == 0)
+		return 0;
+	/* the first block is the longest */
+	buf = malloc(mnemo_trace_block_length(t, 0) * sizeof(*buf));
+	assert(buf != NULL);
+	for (size_t b = 0; b < nblocks; b++) {
+		err = mnemo_trace_decode(t, b, buf);
+		if (err != 0)
+			break;
+		mnemo_reuse_gran_add_batch(g, buf,
+					   mnemo_trace_block_length(t, b),
+					   NULL);
+	}
+	free(buf);
+	return err;
+}
+
+void mnemo_reuse_gran_reset(struct mnemo_reuse_gran *g)
+{
+	assert(g != NULL);
+	for (size_t l = 0; l < g->nlevels; l++) {
+		mnemo_reusedm_reset(g->levels[l].reuse);
+		g->levels[l].started = 0;
+	}
+}
+
+void mnemo_reuse_gran_fini(struct mnemo_reuse_gran *g)
+{
+	assert(g != NULL);
+	for (size_t l = 0; l < g->nlevels; l++)
+		mnemo_reusedm_fini(g->levels[l].reuse);
+	free(g->levels);
+	free(g->keys);
+	free(g->pos);
+	free(g->dist);
+	free(g);
+}
@@ -0,0 +1,329 @@
+#include "config.h"
+
+#include <mnemo.h>
+
+#include <internal/cache.h>
+#include <internal/ranges.h>
+
+/* number of accesses going through a chain of levels at once */
+#define MNEMO_HIERARCHY_CHUNK 4096
+
+/* no level below */
+#define MNEMO_HIERARCHY_BOTTOM SIZE_MAX
+
+/* an event reaching a level: the lookup of an access that missed in the level
+ * above, or the insertion of a line evicted from it.
+ */
+enum hierarchy_event_type {
+	HIERARCHY_LOOKUP,
+	HIERARCHY_INSERT,
+};
+
+struct hierarchy_event {
+	unsigned long long addr;
+	uint32_t range;
+	uint32_t type;
+};
+
+/* a growable array of events */
+struct hierarchy_events {
+	struct hierarchy_event *events;
+	size_t n, max;
+};
+
+/* a level:
+ * - its cache, and its inclusion policy
+ * - the levels above and below it
+ * - its counters, per range, the last one for the accesses in no range.
+ */
+struct hierarchy_level {
+	struct mnemo_cache_sim sim;
+	enum mnemo_inclusion inclusion;
+	size_t above, below;
+	struct mnemo_cache_stats *stats;
+};
+
+/* a hierarchy:
+ * - its levels
+ * - the ranges of addresses
+ * - the range of each access of the current chunk
+ * - the events between two levels, read from one and written to the other.
+ */
+struct mnemo_hierarchy {
+	size_t nlevels;
+	struct hierarchy_level *levels;
+	struct mnemo_ranges ranges;
+	uint32_t range[MNEMO_HIERARCHY_CHUNK];
+	struct hierarchy_events in, out;
+};
+
+static void hierarchy_emit(struct hierarchy_events *e, unsigned long long addr,
+			   uint32_t range, uint32_t type)
+{
+	if (e->n == e->max) {
+		e->max = e->max ? 2 * e->max : MNEMO_HIERARCHY_CHUNK;
+		e->events = realloc(e->events, e->max * sizeof(*e->events));
+		assert(e->events != NULL);
+	}
+	e->events[e->n].addr = addr;
+	e->events[e->n].range = range;
+	e->events[e->n].type = type;
+	e->n++;
+}
+
+struct mnemo_hierarchy *
+mnemo_hierarchy_init(const struct mnemo_hierarchy_level *levels,
+		     size_t nlevels, const struct mnemo_range *ranges,
+		     size_t nranges)
+{
+	struct mnemo_hierarchy *ret;
+
+	assert(levels != NULL && nlevels > 0);
+	assert(nranges < UINT32_MAX);
+	ret = calloc(1, sizeof(struct mnemo_hierarchy));
+	assert(ret != NULL);
+	ret->nlevels = nlevels;
+	ret->levels = calloc(nlevels, sizeof(struct hierarchy_level));
+	assert(ret->levels != NULL);
+	mnemo_ranges_init(&ret->ranges, ranges, nranges);
+	for (size_t l = 0; l < nlevels; l++) {
+		struct hierarchy_level *level = &ret->levels[l];
+		size_t above = levels[l].above;
+
+		mnemo_cache_sim_init(&level->sim, &levels[l].cache);
+		level->inclusion = levels[l].inclusion;
+		level->above = above;
+		level->below = MNEMO_HIERARCHY_BOTTOM;
+		level->stats = calloc(nranges + 1, sizeof(*level->stats));
+		assert(level->stats != NULL);
+		if (above == MNEMO_HIERARCHY_TOP) {
+			assert(level->inclusion != MNEMO_INCLUSION_EXCLUSIVE);
+			continue;
+		}
+		assert(above < l);
+		assert(ret->levels[above].below == MNEMO_HIERARCHY_BOTTOM);
+		ret->levels[above].below = l;
+		if (level->inclusion == MNEMO_INCLUSION_EXCLUSIVE)
+			assert(level->sim.lineshift ==
+			       ret->levels[above].sim.lineshift);
+		for (size_t u = above; level->inclusion ==
+		     MNEMO_INCLUSION_INCLUSIVE && u != MNEMO_HIERARCHY_TOP;
+		     u = ret->levels[u].above)
+			assert(level->sim.lineshift >=
+			       ret->levels[u].sim.lineshift);
+	}
+	return ret;
+}
+
+/* remove the lines of a line evicted from an inclusive level from all the
+ * levels above it.
+ */
+static void hierarchy_invalidate(struct mnemo_hierarchy *h, size_t l,
+				 unsigned long long line)
+{
+	struct hierarchy_level *level = &h->levels[l];
+	unsigned long long start = line << level->sim.lineshift;
+	unsigned long long end = start + (1ULL << level->sim.lineshift);
+
+	for (size_t u = level->above; u != MNEMO_HIERARCHY_TOP;
+	     u = h->levels[u].above) {
+		struct mnemo_cache_sim *s = &h->levels[u].sim;
+		unsigned long long step = 1ULL << s->lineshift;
+
+		for (unsigned long long a = start; a < end; a += step)
+			mnemo_cache_sim_remove(s, a >> s->lineshift);
+	}
+}
+
+/* fill a missing line in a level, and pass its victim on. */
+static void hierarchy_fill(struct mnemo_hierarchy *h, size_t l,
+			   unsigned long long line,
+			   struct hierarchy_events *out)
+{
+	struct hierarchy_level *level = &h->levels[l];
+	unsigned long long victim = 0;
+
+	if (!mnemo_cache_sim_insert(&level->sim, line, &victim))
+		return;
+	if (level->inclusion == MNEMO_INCLUSION_INCLUSIVE)
+		hierarchy_invalidate(h, l, victim);
+	if (level->below != MNEMO_HIERARCHY_BOTTOM &&
+	    h->levels[level->below].inclusion == MNEMO_INCLUSION_EXCLUSIVE)
+		hierarchy_emit(out, victim << level->sim.lineshift, 0,
+			       HIERARCHY_INSERT);
+}
+
+/* run the events of the level above through a level, in order, and write the
+ * events for the level below.
+ */
+static void hierarchy_level_run(struct mnemo_hierarchy *h, size_t l,
+				const struct hierarchy_events *in,
+				struct hierarchy_events *out)
+{
+	struct hierarchy_level *level = &h->levels[l];
+	struct mnemo_cache_sim *s = &level->sim;
+	int exclusive = level->inclusion == MNEMO_INCLUSION_EXCLUSIVE;
+
+	out->n = 0;
+	for (size_t i = 0; i < in->n; i++) {
+		const struct hierarchy_event *e = &in->events[i];
+		unsigned long long line = e->addr >> s->lineshift;
+
+		if (e->type == HIERARCHY_INSERT) {
+			/* a victim from above, only refreshed if already here */
+			if (!mnemo_cache_sim_lookup(s, line))
+				hierarchy_fill(h, l, line, out);
+			continue;
+		}
+		if (mnemo_cache_sim_lookup(s, line)) {
+			level->stats[e->range].hits++;
+			/* the line moves up, to the level above */
+			if (exclusive)
+				mnemo_cache_sim_remove(s, line);
+			continue;
+		}
+		level->stats[e->range].misses++;
+		if (level->below != MNEMO_HIERARCHY_BOTTOM)
+			hierarchy_emit(out, e->addr, e->range,
+				       HIERARCHY_LOOKUP);
+		if (!exclusive)
+			hierarchy_fill(h, l, line, out);
+	}
+}
+
+/* whether the chain of a top level holds an inclusive level */
+static int hierarchy_inclusive(const struct mnemo_hierarchy *h, size_t top)
+{
+	for (size_t l = top; l != MNEMO_HIERARCHY_BOTTOM;
+	     l = h->levels[l].below)
+		if (h->levels[l].inclusion == MNEMO_INCLUSION_INCLUSIVE)
+			return 1;
+	return 0;
+}
+
+/* run a chunk of at most MNEMO_HIERARCHY_CHUNK accesses through a chain. */
+static void hierarchy_chain_run(struct mnemo_hierarchy *h, size_t top,
+				const unsigned long long *addrs,
+				const uint32_t *ranges, size_t n)
+{
+	struct hierarchy_events tmp;
+
+	h->in.n = 0;
+	for (size_t i = 0; i < n; i++)
+		hierarchy_emit(&h->in, addrs[i], ranges[i], HIERARCHY_LOOKUP);
+	for (size_t l = top; l != MNEMO_HIERARCHY_BOTTOM && h->in.n > 0;
+	     l = h->levels[l].below) {
+		hierarchy_level_run(h, l, &h->in, &h->out);
+		tmp = h->in;
+		h->in = h->out;
+		h->out = tmp;
+	}
+}
+
+static void hierarchy_chunk(struct mnemo_hierarchy *h,
+			    const unsigned long long *addrs, size_t n)
+{
+	for (size_t i = 0; i < n; i++)
+		h->range[i] = mnemo_ranges_find(&h->ranges, addrs[i]);
+	for (size_t top = 0; top < h->nlevels; top++) {
+		if (h->levels[top].above != MNEMO_HIERARCHY_TOP)
+			continue;
+		/* the levels above an inclusive level must see its
+		 * invalidations before their next access.
+		 */
+		if (!hierarchy_inclusive(h, top)) {
+			hierarchy_chain_run(h, top, addrs, h->range, n);
+			continue;
+		}
+		for (size_t i = 0; i < n; i++)
+			hierarchy_chain_run(h, top, &addrs[i], &h->range[i],
+					    1);
+	}
+}
+
+void mnemo_hierarchy_add(struct mnemo_hierarchy *h, unsigned long long addr)
+{
+	mnemo_hierarchy_add_batch(h, &addr, 1);
+}
+
+void mnemo_hierarchy_add_batch(struct mnemo_hierarchy *h,
+			       const unsigned long long *addrs, size_t n)
+{
+	assert(h != NULL);
+	assert(n == 0 || addrs != NULL);
+	for (size_t i = 0; i < n; i += MNEMO_HIERARCHY_CHUNK) {
+		size_t len = n - i < MNEMO_HIERARCHY_CHUNK ?
+			n - i : MNEMO_HIERARCHY_CHUNK;
+
+		hierarchy_chunk(h, &addrs[i], len);
+	}
+}
+
+int mnemo_hierarchy_from_trace(struct mnemo_hierarchy *h,
+			       struct mnemo_trace *t)
+{
+	unsigned long long *buf;
+	size_t nblocks;
+	int err = 0;
+
+	assert(h != NULL && t != NULL);
+	nblocks = mnemo_trace_nblocks(t);
+	if (nblocks == 0)
+		return 0;
+	/* the first block is the longest */
+	buf = malloc(mnemo_trace_block_length(t, 0) * sizeof(*buf));
+	assert(buf != NULL);
+	for (size_t b = 0; b < nblocks; b++) {
+		err = mnemo_trace_decode(t, b, buf);
+		if (err != 0)
+			break;
+		mnemo_hierarchy_add_batch(h, buf,
+					  mnemo_trace_block_length(t, b));
+	}
+	free(buf);
+	return err;
+}
+
+struct mnemo_cache_stats mnemo_hierarchy_stats(const struct mnemo_hierarchy *h,
+					       size_t level, size_t range)
+{
+	struct mnemo_cache_stats ret = { 0, 0 };
+	const struct hierarchy_level *l;
+
+	assert(h != NULL);
+	assert(level < h->nlevels);
+	l = &h->levels[level];
+	if (range != MNEMO_HIERARCHY_ALL) {
+		assert(range <= h->ranges.n);
+		return l->stats[range];
+	}
+	for (size_t r = 0; r <= h->ranges.n; r++) {
+		ret.hits += l->stats[r].hits;
+		ret.misses += l->stats[r].misses;
+	}
+	return ret;
+}
+
+void mnemo_hierarchy_reset(struct mnemo_hierarchy *h)
+{
+	assert(h != NULL);
+	for (size_t l = 0; l < h->nlevels; l++) {
+		mnemo_cache_sim_clear(&h->levels[l].sim);
+		memset(h->levels[l].stats, 0,
+		       (h->ranges.n + 1) * sizeof(*h->levels[l].stats));
+	}
+}
+
+void mnemo_hierarchy_fini(struct mnemo_hierarchy *h)
+{
+	assert(h != NULL);
+	for (size_t l = 0; l < h->nlevels; l++) {
+		mnemo_cache_sim_fini(&h->levels[l].sim);
+		free(h->levels[l].stats);
+	}
+	mnemo_ranges_fini(&h->ranges);
+	free(h->levels);
+	free(h->in.events);
+	free(h->out.events);
+	free(h);
+}
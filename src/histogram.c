@@ -0,0 +1,117 @@
+#include "config.h"
+
+#include <mnemo.h>
+
+#include <internal/histogram.h>
+
+struct mnemo_histogram *mnemo_histogram_init(enum mnemo_histogram_scale scale,
+					     size_t nbins,
+					     unsigned long long width)
+{
+	struct mnemo_histogram *ret;
+
+	assert(scale == MNEMO_HISTOGRAM_LOG2 ||
+	       scale == MNEMO_HISTOGRAM_LINEAR);
+	assert(nbins > 0);
+	/* one bin for 0, then one per bit of a 64-bit distance */
+	assert(scale != MNEMO_HISTOGRAM_LOG2 || nbins <= 65);
+	assert(scale != MNEMO_HISTOGRAM_LINEAR || width > 0);
+	ret = calloc(1, sizeof(struct mnemo_histogram));
+	assert(ret != NULL);
+	ret->scale = scale;
+	ret->width = width;
+	ret->nbins = nbins;
+	ret->cold = 0.0;
+	ret->bins = calloc(nbins, sizeof(*ret->bins));
+	assert(ret->bins != NULL);
+	return ret;
+}
+
+void mnemo_histogram_add(struct mnemo_histogram *h, int64_t distance,
+			 double count)
+{
+	assert(h != NULL);
+	if (distance != MNEMO_REUSE_SKIPPED)
+		mnemo_histogram_count(h, distance, count);
+}
+
+size_t mnemo_histogram_nbins(const struct mnemo_histogram *h)
+{
+	assert(h != NULL);
+	return h->nbins;
+}
+
+const double *mnemo_histogram_bins(const struct mnemo_histogram *h)
+{
+	assert(h != NULL);
+	return h->bins;
+}
+
+double mnemo_histogram_cold(const struct mnemo_histogram *h)
+{
+	assert(h != NULL);
+	return h->cold;
+}
+
+unsigned long long mnemo_histogram_bin_start(const struct mnemo_histogram *h,
+					     size_t bin)
+{
+	assert(h != NULL);
+	assert(bin < h->nbins);
+	return mnemo_histogram_start(h, bin);
+}
+
+void mnemo_histogram_mrc(const struct mnemo_histogram *h,
+			 const unsigned long long *sizes, size_t n,
+			 double *out)
+{
+	double *above, total;
+
+	assert(h != NULL);
+	assert(sizes != NULL || n == h->nbins);
+	assert(n == 0 || out != NULL);
+
+	/* above[i] is the number of accesses in bin i and the ones after */
+	above = malloc((h->nbins + 1) * sizeof(*above));
+	assert(above != NULL);
+	above[h->nbins] = 0.0;
+	for (size_t i = h->nbins; i-- > 0;)
+		above[i] = above[i + 1] + h->bins[i];
+	total = above[0] + h->cold;
+
+	for (size_t i = 0; i < n; i++) {
+		unsigned long long size, lo, hi;
+		size_t bin;
+		double misses;
+
+		size = sizes != NULL ? sizes[i] : mnemo_histogram_start(h, i);
+		bin = mnemo_histogram_bin(h, size);
+		lo = mnemo_histogram_start(h, bin);
+		misses = h->cold + above[bin + 1];
+		/* distances are taken as evenly spread within a bin, the last
+		 * one has no end and only counts misses.
+		 */
+		if (bin + 1 < h->nbins) {
+			hi = mnemo_histogram_start(h, bin + 1);
+			misses += h->bins[bin] * (hi - size) / (hi - lo);
+		} else {
+			misses += h->bins[bin];
+		}
+		out[i] = total > 0.0 ? misses / total : 0.0;
+	}
+	free(above);
+}
+
+void mnemo_histogram_reset(struct mnemo_histogram *h)
+{
+	assert(h != NULL);
+	memset(h->bins, 0, h->nbins * sizeof(*h->bins));
+	h->cold = 0.0;
+}
+
+void mnemo_histogram_fini(struct mnemo_histogram *h)
+{
+	assert(h != NULL);
+	free(h->bins);
+	free(h);
+}
@@ -0,0 +1,290 @@
+#include "config.h"
+
+#include <mnemo.h>
+
+#include <internal/histogram.h>
+#include <internal/keymap.h>
+
+/* Times are binned log-linearly: times below 2^MNEMO_LOCALITY_SUBBITS have
+ * their own bin, larger ones share a bin with the times of the same power of
+ * two and the same MNEMO_LOCALITY_SUBBITS leading bits, within 1/32 of each
+ * other.
+ */
+#define MNEMO_LOCALITY_SUBBITS 5
+#define MNEMO_LOCALITY_SUB (1 << MNEMO_LOCALITY_SUBBITS)
+#define MNEMO_LOCALITY_NBINS ((64 - MNEMO_LOCALITY_SUBBITS + 1) * \
+			      MNEMO_LOCALITY_SUB)
+
+/* a histogram of times, with the count and the sum of the times of each bin */
+struct locality_times {
+	double counts[MNEMO_LOCALITY_NBINS];
+	double sums[MNEMO_LOCALITY_NBINS];
+};
+
+/* the locality engine:
+ * - the current time, the time of the first access being 1
+ * - the time of the last access to each key
+ * - the histograms of the reuse times, of the times of the first accesses
+ *   and of the times from the last accesses to the end of the trace. The last
+ *   one is built on demand, and valid as long as no access is added.
+ * - the histogram of reuse times attached, if any.
+ */
+struct mnemo_locality {
+	unsigned long long now;
+	struct mnemo_keymap last_seen;
+	struct locality_times reuse;
+	struct locality_times first;
+	struct locality_times last;
+	unsigned long long last_valid;
+	struct mnemo_histogram *hist;
+	size_t max;
+};
+
+static inline size_t locality_bin(unsigned long long t)
+{
+	unsigned int e;
+
+	if (t < MNEMO_LOCALITY_SUB)
+		return t;
+	e = mnemo_histogram_bits(t) - 1;
+	return (e - MNEMO_LOCALITY_SUBBITS + 1) * MNEMO_LOCALITY_SUB +
+		(t >> (e - MNEMO_LOCALITY_SUBBITS)) - MNEMO_LOCALITY_SUB;
+}
+
+/* smallest time of a bin */
+static unsigned long long locality_bin_start(size_t bin)
+{
+	size_t e;
+
+	if (bin < 2 * MNEMO_LOCALITY_SUB)
+		return bin;
+	e = bin / MNEMO_LOCALITY_SUB + MNEMO_LOCALITY_SUBBITS - 1;
+	return (unsigned long long)(bin % MNEMO_LOCALITY_SUB +
+				    MNEMO_LOCALITY_SUB) <<
+		(e - MNEMO_LOCALITY_SUBBITS);
+}
+
+static inline void locality_count(struct locality_times *h,
+				  unsigned long long t)
+{
+	size_t bin = locality_bin(t);
+
+	h->counts[bin] += 1.0;
+	h->sums[bin] += t;
+}
+
+/* sum of (t - w) over the times t above w. Within the bin of w, times are
+ * assumed to be spread evenly.
+ */
+static double locality_excess(const struct locality_times *h,
+			      unsigned long long w)
+{
+	size_t bin = locality_bin(w);
+	unsigned long long start, end;
+	double ret = 0.0;
+
+	for (size_t b = bin + 1; b < MNEMO_LOCALITY_NBINS; b++)
+		ret += h->sums[b] - (double)w * h->counts[b];
+	start = locality_bin_start(bin);
+	end = bin + 1 < MNEMO_LOCALITY_NBINS ?
+		locality_bin_start(bin + 1) : UINT64_MAX;
+	if (end - start > 1 && h->counts[bin] > 0) {
+		double above = h->counts[bin] * (end - 1 - w) / (end - start);
+
+		ret += above * (end - w) / 2.0;
+	}
+	return ret;
+}
+
+struct mnemo_locality *mnemo_locality_init(size_t max)
+{
+	struct mnemo_locality *ret;
+
+	ret = calloc(1, sizeof(struct mnemo_locality));
+	assert(ret != NULL);
+	ret->max = max;
+	mnemo_keymap_init(&ret->last_seen, max);
+	ret->now = 0;
+	ret->last_valid = UINT64_MAX;
+	ret->hist = NULL;
+	return ret;
+}
+
+static inline int64_t locality_add(struct mnemo_locality *l,
+				   unsigned long long key, uint64_t hash)
+{
+	struct mnemo_keymap_slot *s;
+	int64_t ret = -1;
+	int found;
+
+	l->now++;
+	s = mnemo_keymap_lookup(&l->last_seen, key, hash, &found);
+	if (found) {
+		ret = l->now - s->value;
+		locality_count(&l->reuse, ret);
+	} else {
+		locality_count(&l->first, l->now);
+	}
+	s->value = l->now;
+	if (l->hist != NULL)
+		mnemo_histogram_count(l->hist, ret, 1.0);
+	return ret;
+}
+
+int64_t mnemo_locality_add(struct mnemo_locality *l, unsigned long long key)
+{
+	assert(l != NULL);
+	return locality_add(l, key, mnemo_keymap_hash(key));
+}
+
+/* number of keys whose map slots are prefetched ahead of their access */
+#define MNEMO_LOCALITY_PREFETCH 16
+
+void mnemo_locality_add_batch(struct mnemo_locality *l,
+			      const unsigned long long *keys, size_t n,
+			      int64_t *out)
+{
+	uint64_t hashv[MNEMO_LOCALITY_PREFETCH];
+
+	assert(l != NULL);
+	assert(n == 0 || keys != NULL);
+	for (size_t i = 0; i < n && i < MNEMO_LOCALITY_PREFETCH; i++) {
+		hashv[i] = mnemo_keymap_hash(keys[i]);
+		mnemo_keymap_prefetch(&l->last_seen, hashv[i]);
+	}
+	for (size_t i = 0; i < n; i++) {
+		size_t slot = i % MNEMO_LOCALITY_PREFETCH;
+		uint64_t h = hashv[slot];
+		int64_t t;
+
+		if (i + MNEMO_LOCALITY_PREFETCH < n) {
+			hashv[slot] = mnemo_keymap_hash(
+				keys[i + MNEMO_LOCALITY_PREFETCH]);
+			mnemo_keymap_prefetch(&l->last_seen, hashv[slot]);
+		}
+		t = locality_add(l, keys[i], h);
+		if (out != NULL)
+			out[i] = t;
+	}
+}
+
+void mnemo_locality_attach(struct mnemo_locality *l,
+			   struct mnemo_histogram *h)
+{
+	assert(l != NULL);
+	l->hist = h;
+}
+
+unsigned long long mnemo_locality_accesses(const struct mnemo_locality *l)
+{
+	assert(l != NULL);
+	return l->now;
+}
+
+size_t mnemo_locality_keys(const struct mnemo_locality *l)
+{
+	assert(l != NULL);
+	return l->last_seen.count;
+}
+
+/* histogram of n + 1 - last access time, over all keys. */
+static void locality_last(struct mnemo_locality *l)
+{
+	const struct mnemo_keymap *m = &l->last_seen;
+
+	if (l->last_valid == l->now)
+		return;
+	memset(&l->last, 0, sizeof(l->last));
+	for (size_t i = 0; i <= m->mask; i++)
+		if (m->slots[i].value != MNEMO_KEYMAP_EMPTY)
+			locality_count(&l->last,
+				       l->now + 1 - m->slots[i].value);
+	l->last_valid = l->now;
+}
+
+/* average footprint of the windows of length w, the number of distinct keys
+ * they access, from Xiang et al., HOTL:
+ * fp(w) = m - (sum over first accesses f > w of (f - w)
+ *              + sum over last accesses n + 1 - l > w of (n + 1 - l - w)
+ *              + sum over reuse times t > w of (t - w)) / (n - w + 1)
+ */
+static double locality_fp(const struct mnemo_locality *l,
+			  unsigned long long w)
+{
+	double excess;
+
+	excess = locality_excess(&l->first, w) +
+		locality_excess(&l->last, w) +
+		locality_excess(&l->reuse, w);
+	return l->last_seen.count - excess / (l->now - w + 1);
+}
+
+double mnemo_locality_footprint(struct mnemo_locality *l,
+				unsigned long long w)
+{
+	assert(l != NULL);
+	if (w == 0 || l->now == 0)
+		return 0.0;
+	if (w >= l->now)
+		return l->last_seen.count;
+	locality_last(l);
+	return locality_fp(l, w);
+}
+
+void mnemo_locality_mrc(struct mnemo_locality *l,
+			const unsigned long long *sizes, size_t n,
+			double *out)
+{
+	unsigned long long total;
+
+	assert(l != NULL);
+	assert(n == 0 || (sizes != NULL && out != NULL));
+	total = l->now;
+	locality_last(l);
+	for (size_t i = 0; i < n; i++) {
+		unsigned long long lo = 1, hi = total;
+
+		if (total == 0) {
+			out[i] = 0.0;
+			continue;
+		}
+		/* caches as large as the data only take cold misses */
+		if (sizes[i] >= l->last_seen.count) {
+			out[i] = (double)l->last_seen.count / total;
+			continue;
+		}
+		/* the footprint grows with the window, find the first window
+		 * whose footprint fills the cache.
+		 */
+		while (lo < hi) {
+			unsigned long long mid = lo + (hi - lo) / 2;
+
+			if (locality_fp(l, mid) < sizes[i])
+				lo = mid + 1;
+			else
+				hi = mid;
+		}
+		/* the miss ratio is the growth of the footprint there */
+		out[i] = lo < total ? locality_fp(l, lo + 1) - locality_fp(l, lo)
+			: 0.0;
+		if (out[i] < 0.0)
+			out[i] = 0.0;
+	}
+}
+
+void mnemo_locality_reset(struct mnemo_locality *l)
+{
+	assert(l != NULL);
+	mnemo_keymap_clear(&l->last_seen);
+	memset(&l->reuse, 0, sizeof(l->reuse));
+	memset(&l->first, 0, sizeof(l->first));
+	l->now = 0;
+	l->last_valid = UINT64_MAX;
+}
+
+void mnemo_locality_fini(struct mnemo_locality *l)
+{
+	assert(l != NULL);
+	mnemo_keymap_fini(&l->last_seen);
+	free(l);
+}
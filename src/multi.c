@@ -0,0 +1,304 @@
+#include "config.h"
+
+#include <mnemo.h>
+
+#include <internal/ring.h>
+
+#include <pthread.h>
+#include <time.h>
+
+/* number of accesses in a chunk of a producer buffer */
+#define MNEMO_MP_CHUNK 4096
+
+/* a producer publishes its accesses every that many pushes, a power of two */
+#define MNEMO_MP_PUBLISH 64
+
+/* time the merging thread sleeps when it cannot make progress, in
+ * nanoseconds
+ */
+#define MNEMO_MP_IDLE 50000
+
+struct reuse_mp_access {
+	uint64_t time;
+	unsigned long long key;
+};
+
+/* a chunk of a producer buffer. The producer fills it and publishes the
+ * number of valid accesses, then links a new chunk once it is full.
+ */
+struct reuse_mp_chunk {
+	struct reuse_mp_chunk *next;
+	size_t count;
+	struct reuse_mp_access accesses[MNEMO_MP_CHUNK];
+};
+
+/* a producer thread:
+ * - its buffer: an unbounded list of chunks, appended to by the producer and
+ *   consumed by the merging thread, which frees the chunks it is done with.
+ *   Each side keeps its position on its own cache line.
+ * - the reuse distance manager of its private accesses, if any
+ * - its rank among producers, to order accesses with the same timestamp
+ * - whether it left, and the next producer in the list.
+ * Producers are allocated on a cache line boundary, for the padding to keep
+ * both sides apart.
+ */
+struct mnemo_reuse_producer {
+	/* producer */
+	struct reuse_mp_chunk *last;
+	size_t n;
+	char pad0[MNEMO_CACHELINE - sizeof(void *) - sizeof(size_t)];
+	/* merging thread */
+	struct reuse_mp_chunk *first;
+	size_t pos;
+	/* time of the last merged access, later accesses are newer */
+	uint64_t merged;
+	int started;
+	char pad1[MNEMO_CACHELINE - sizeof(void *) - sizeof(size_t) -
+		  sizeof(uint64_t) - sizeof(int)];
+	struct mnemo_reusedm *private;
+	size_t rank;
+	int left;
+	struct mnemo_reuse_producer *next;
+};
+
+/* a multi-producer front end:
+ * - the list of producers, pushed to under a lock that only joining takes
+ * - the manager of the shared accesses, fed with the merged stream by a
+ *   dedicated thread, which runs until stop is set.
+ */
+struct mnemo_reuse_mp {
+	struct mnemo_reuse_producer *producers;
+	size_t nproducers;
+	pthread_mutex_t lock;
+	struct mnemo_reusedm *shared;
+	pthread_t thread;
+	int stop;
+};
+
+static struct reuse_mp_chunk *reuse_mp_chunk_new(void)
+{
+	struct reuse_mp_chunk *c = malloc(sizeof(*c));
+
+	assert(c != NULL);
+	c->next = NULL;
+	c->count = 0;
+	return c;
+}
+
+/* merging thread: return the oldest unmerged access of a producer, NULL if
+ * none is published.
+ */
+static struct reuse_mp_access *reuse_mp_peek(struct mnemo_reuse_producer *p)
+{
+	for (;;) {
+		struct reuse_mp_chunk *c = p->first, *next;
+
+		if (p->pos < __atomic_load_n(&c->count, __ATOMIC_ACQUIRE))
+			return &c->accesses[p->pos];
+		if (p->pos < MNEMO_MP_CHUNK)
+			return NULL;
+		next = __atomic_load_n(&c->next, __ATOMIC_ACQUIRE);
+		if (next == NULL)
+			return NULL;
+		p->first = next;
+		p->pos = 0;
+		free(c);
+	}
+}
+
+/* whether an access of producer rank a is older than one of rank b. */
+static inline int reuse_mp_older(const struct reuse_mp_access *a, size_t arank,
+				 const struct reuse_mp_access *b, size_t brank)
+{
+	return a->time < b->time || (a->time == b->time && arank < brank);
+}
+
+/* whether a producer without published accesses can still push one older
+ * than a given time.
+ */
+static int reuse_mp_blocks(struct mnemo_reuse_producer *p, uint64_t time)
+{
+	/* leaving publishes the last accesses first */
+	if (__atomic_load_n(&p->left, __ATOMIC_ACQUIRE))
+		return 0;
+	/* timestamps increase within a producer */
+	return !p->started || p->merged < time;
+}
+
+/* merge as many accesses as possible, in timestamp order, and return how
+ * many. Unless stopping, an access is only merged once no producer can push an
+ * older one.
+ */
+static size_t reuse_mp_merge(struct mnemo_reuse_mp *mp, int stopping)
+{
+	struct mnemo_reuse_producer *head;
+	size_t merged = 0;
+
+	for (;;) {
+		struct mnemo_reuse_producer *best = NULL, *p;
+		struct reuse_mp_access *oldest = NULL;
+		int idle = 0, retry = 0;
+
+		head = __atomic_load_n(&mp->producers, __ATOMIC_ACQUIRE);
+
+		for (p = head; p != NULL; p = p->next) {
+			struct reuse_mp_access *a = reuse_mp_peek(p);
+
+			if (a == NULL)
+				idle = 1;
+			else if (oldest == NULL ||
+				 reuse_mp_older(a, p->rank, oldest, best->rank)) {
+				oldest = a;
+				best = p;
+			}
+		}
+		if (oldest == NULL)
+			return merged;
+		for (p = head; idle && !stopping && p != NULL; p = p->next) {
+			struct reuse_mp_access *a = reuse_mp_peek(p);
+
+			/* it might have published since the first scan */
+			if (a != NULL) {
+				retry |= reuse_mp_older(a, p->rank, oldest,
+							best->rank);
+				continue;
+			}
+			if (reuse_mp_blocks(p, oldest->time))
+				return merged;
+			retry |= reuse_mp_peek(p) != NULL;
+		}
+		if (retry)
+			continue;
+		mnemo_reusedm_add64(mp->shared, oldest->key);
+		if (best->private != NULL)
+			mnemo_reusedm_add64(best->private, oldest->key);
+		best->merged = oldest->time;
+		best->started = 1;
+		best->pos++;
+		merged++;
+	}
+}
+
+static void *reuse_mp_run(void *arg)
+{
+	struct mnemo_reuse_mp *mp = arg;
+
+	for (;;) {
+		struct timespec idle = { 0, MNEMO_MP_IDLE };
+
+		/* stop is only set once all producers left */
+		if (__atomic_load_n(&mp->stop, __ATOMIC_ACQUIRE)) {
+			while (reuse_mp_merge(mp, 1) != 0)
+				;
+			break;
+		}
+		if (reuse_mp_merge(mp, 0) == 0)
+			nanosleep(&idle, NULL);
+	}
+	return NULL;
+}
+
+struct mnemo_reuse_mp *mnemo_reuse_mp_init(struct mnemo_reusedm *shared)
+{
+	struct mnemo_reuse_mp *ret;
+	int err;
+
+	assert(shared != NULL);
+	ret = calloc(1, sizeof(struct mnemo_reuse_mp));
+	assert(ret != NULL);
+	ret->producers = NULL;
+	ret->nproducers = 0;
+	err = pthread_mutex_init(&ret->lock, NULL);
+	assert(err == 0);
+	ret->shared = shared;
+	ret->stop = 0;
+	err = pthread_create(&ret->thread, NULL, reuse_mp_run, ret);
+	assert(err == 0);
+	(void)err;
+	return ret;
+}
+
+struct mnemo_reuse_producer *mnemo_reuse_mp_join(struct mnemo_reuse_mp *mp,
+						 struct mnemo_reusedm *private)
+{
+	struct mnemo_reuse_producer *ret;
+	void *mem;
+	int err;
+
+	assert(mp != NULL);
+	err = posix_memalign(&mem, MNEMO_CACHELINE,
+			     sizeof(struct mnemo_reuse_producer));
+	assert(err == 0);
+	(void)err;
+	ret = memset(mem, 0, sizeof(struct mnemo_reuse_producer));
+	ret->last = ret->first = reuse_mp_chunk_new();
+	ret->n = 0;
+	ret->pos = 0;
+	ret->merged = 0;
+	ret->started = 0;
+	ret->private = private;
+	ret->left = 0;
+	pthread_mutex_lock(&mp->lock);
+	ret->rank = mp->nproducers++;
+	ret->next = mp->producers;
+	__atomic_store_n(&mp->producers, ret, __ATOMIC_RELEASE);
+	pthread_mutex_unlock(&mp->lock);
+	return ret;
+}
+
+void mnemo_reuse_mp_push(struct mnemo_reuse_producer *p,
+			 unsigned long long key, uint64_t time)
+{
+	struct reuse_mp_chunk *c = p->last;
+
+	if (p->n == MNEMO_MP_CHUNK) {
+		struct reuse_mp_chunk *next = reuse_mp_chunk_new();
+
+		__atomic_store_n(&c->count, p->n, __ATOMIC_RELEASE);
+		__atomic_store_n(&c->next, next, __ATOMIC_RELEASE);
+		p->last = c = next;
+		p->n = 0;
+	}
+	c->accesses[p->n].time = time;
+	c->accesses[p->n].key = key;
+	p->n++;
+	if ((p->n & (MNEMO_MP_PUBLISH - 1)) == 0)
+		__atomic_store_n(&c->count, p->n, __ATOMIC_RELEASE);
+}
+
+void mnemo_reuse_mp_publish(struct mnemo_reuse_producer *p)
+{
+	assert(p != NULL);
+	__atomic_store_n(&p->last->count, p->n, __ATOMIC_RELEASE);
+}
+
+void mnemo_reuse_mp_leave(struct mnemo_reuse_producer *p)
+{
+	assert(p != NULL);
+	mnemo_reuse_mp_publish(p);
+	__atomic_store_n(&p->left, 1, __ATOMIC_RELEASE);
+}
+
+void mnemo_reuse_mp_fini(struct mnemo_reuse_mp *mp)
+{
+	struct mnemo_reuse_producer *p, *next;
+	int err;
+
+	assert(mp != NULL);
+	__atomic_store_n(&mp->stop, 1, __ATOMIC_RELEASE);
+	err = pthread_join(mp->thread, NULL);
+	assert(err == 0);
+	(void)err;
+	for (p = mp->producers; p != NULL; p = next) {
+		struct reuse_mp_chunk *c, *tmp;
+
+		next = p->next;
+		for (c = p->first; c != NULL; c = tmp) {
+			tmp = c->next;
+			free(c);
+		}
+		free(p);
+	}
+	pthread_mutex_destroy(&mp->lock);
+	free(mp);
+}
@@ -0,0 +1,94 @@
+#include "config.h"
+
+#include <mnemo.h>
+
+#include <internal/series.h>
+
+struct mnemo_phases *mnemo_phases_init(double threshold)
+{
+	struct mnemo_phases *ret;
+
+	assert(threshold >= 0.0);
+	ret = calloc(1, sizeof(struct mnemo_phases));
+	assert(ret != NULL);
+	ret->threshold = threshold;
+	return ret;
+}
+
+void mnemo_series_attach_phases(struct mnemo_series *s,
+				struct mnemo_phases *p)
+{
+	assert(s != NULL);
+	s->phases = p;
+}
+
+size_t mnemo_phases_count(const struct mnemo_phases *p)
+{
+	assert(p != NULL);
+	return p->nphases;
+}
+
+size_t mnemo_phases_nruns(const struct mnemo_phases *p)
+{
+	assert(p != NULL);
+	return p->nruns;
+}
+
+struct mnemo_phase mnemo_phases_run(const struct mnemo_phases *p, size_t i)
+{
+	assert(p != NULL);
+	assert(i < p->nruns);
+	return p->runs[i];
+}
+
+size_t mnemo_phases_representative(const struct mnemo_phases *p,
+				   const struct mnemo_series *s, size_t id)
+{
+	size_t ret = SIZE_MAX;
+	double best = 0.0;
+	double *sig;
+
+	assert(p != NULL && s != NULL);
+	assert(id < p->nphases);
+	assert(s->nbins + 1 == p->nsig);
+	sig = malloc(p->nsig * sizeof(*sig));
+	assert(sig != NULL);
+	for (size_t r = 0; r < p->nruns; r++) {
+		const struct mnemo_phase *run = &p->runs[r];
+
+		if (run->id != id)
+			continue;
+		for (size_t i = run->first; i < run->first + run->count; i++) {
+			double d;
+
+			assert(i < s->n);
+			mnemo_phases_signature(p->nsig, &s->bins[i * s->nbins],
+					       s->cold[i], sig);
+			d = mnemo_phases_centroid_dist(p, id, sig);
+			if (ret == SIZE_MAX || d < best) {
+				ret = i;
+				best = d;
+			}
+		}
+	}
+	free(sig);
+	return ret;
+}
+
+void mnemo_phases_reset(struct mnemo_phases *p)
+{
+	assert(p != NULL);
+	p->nphases = 0;
+	p->nruns = 0;
+}
+
+void mnemo_phases_fini(struct mnemo_phases *p)
+{
+	assert(p != NULL);
+	free(p->prev);
+	free(p->cur);
+	free(p->sums);
+	free(p->counts);
+	free(p->runs);
+	free(p);
+}
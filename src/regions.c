@@ -0,0 +1,82 @@
+#include "config.h"
+
+#include <mnemo.h>
+
+#include <internal/regions.h>
+
+struct mnemo_regions *mnemo_regions_init(const struct mnemo_range *ranges,
+					 size_t n, size_t nbins)
+{
+	struct mnemo_regions *ret;
+
+	/* one bin for 0, then one per bit of a 64-bit distance */
+	assert(nbins > 0 && nbins <= 65);
+	ret = malloc(sizeof(struct mnemo_regions));
+	assert(ret != NULL);
+	mnemo_ranges_init(&ret->ranges, ranges, n);
+	ret->nbins = nbins;
+	ret->regions = calloc(n + 1, sizeof(*ret->regions));
+	ret->bins = calloc((n + 1) * nbins, sizeof(*ret->bins));
+	assert(ret->regions != NULL && ret->bins != NULL);
+	for (size_t i = 0; i <= n; i++) {
+		struct mnemo_histogram *h = &ret->regions[i].hist;
+
+		h->scale = MNEMO_HISTOGRAM_LOG2;
+		h->width = 1;
+		h->nbins = nbins;
+		h->bins = &ret->bins[i * nbins];
+	}
+	mnemo_regions_reset(ret);
+	return ret;
+}
+
+size_t mnemo_regions_nregions(const struct mnemo_regions *g)
+{
+	assert(g != NULL);
+	return g->ranges.n;
+}
+
+void mnemo_regions_stats(const struct mnemo_regions *g, size_t region,
+			 struct mnemo_region_stats *out)
+{
+	const struct mnemo_region *r;
+	double reuses;
+
+	assert(g != NULL && out != NULL);
+	assert(region <= g->ranges.n);
+	r = &g->regions[region];
+	reuses = r->accesses - r->hist.cold;
+	out->accesses = r->accesses;
+	out->cold = r->hist.cold;
+	out->mean = reuses > 0 ? r->sum / reuses : 0.0;
+	out->max = r->max;
+}
+
+const struct mnemo_histogram *
+mnemo_regions_histogram(const struct mnemo_regions *g, size_t region)
+{
+	assert(g != NULL);
+	assert(region <= g->ranges.n);
+	return &g->regions[region].hist;
+}
+
+void mnemo_regions_reset(struct mnemo_regions *g)
+{
+	assert(g != NULL);
+	for (size_t i = 0; i <= g->ranges.n; i++) {
+		g->regions[i].hist.cold = 0.0;
+		g->regions[i].accesses = 0.0;
+		g->regions[i].sum = 0.0;
+		g->regions[i].max = -1;
+	}
+	memset(g->bins, 0, (g->ranges.n + 1) * g->nbins * sizeof(*g->bins));
+}
+
+void mnemo_regions_fini(struct mnemo_regions *g)
+{
+	assert(g != NULL);
+	mnemo_ranges_fini(&g->ranges);
+	free(g->regions);
+	free(g->bins);
+	free(g);
+}
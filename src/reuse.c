@@ -1,20 +1,34 @@
+#include "config.h"
+
 #include <mnemo.h>
 
+#include <internal/arena.h>
+#include <internal/endian.h>
+#include <internal/fenwick.h>
+#include <internal/histogram.h>
+#include <internal/mapfile.h>
+#include <internal/regions.h>
+#include <internal/series.h>
+#ifdef MNEMO_USE_UTHASH
 #include <internal/uthash.h>
+#else
+#include <internal/keymap.h>
+#endif
 #include <internal/utsplay.h>
 
-/* a record for reuse distance purposes:
- * - a key identifying uniquely the entry being accessed
- * - a timestamp for this access
- * - a handle for an hashmap (uthash).
+#include <pthread.h>
+
+/* a node of the splay tree engine:
+ * - a timestamp for the last access to a key
+ * - the number of nodes in the subtree rooted here, 64-bit so that traces can
+ *   hold more than 2^31 keys. Along with the timestamp and the pointers, it
+ *   fills 40 bytes, the same as a 32-bit weight and its padding.
  * - fields for insertion in a tree.
  */
-struct mnemo_record {
-	unsigned long long toto;
+struct mnemo_node {
 	unsigned long long time;
-	UT_hash_handle hh;
-	struct mnemo_record *left, *right, *parent;
-	int weight;
+	int64_t weight;
+	struct mnemo_node *left, *right, *parent;
 };
 
 #undef SPLAY_INIT
@@ -35,74 +49,1331 @@ do { \
 #define SPLAY_KEYCMP(a, b, sz) \
 ((*(unsigned long long *)a < *(unsigned long long*)b) ? -1 : ((unsigned long long*)a > (unsigned long long*)b) ? 1 : 0)
 
+#ifdef MNEMO_USE_UTHASH
+/* a record of the uthash key map, kept for comparison with the default open
+ * addressing map:
+ * - a key identifying uniquely the entry being accessed
+ * - the value the engine associates to this key
+ * - a handle for an hashmap (uthash).
+ */
+struct mnemo_record {
+	unsigned long long toto;
+	uint64_t value;
+	UT_hash_handle hh;
+};
+
+/* the hashmap is created with enough buckets for the number of keys given at
+ * init time, so that it never needs to expand. Only valid where a reuse
+ * distance manager named reuse is in scope.
+ */
+#undef HASH_INITIAL_NUM_BUCKETS
+#define HASH_INITIAL_NUM_BUCKETS (1U << reuse->buckets_log2)
+#undef HASH_INITIAL_NUM_BUCKETS_LOG2
+#define HASH_INITIAL_NUM_BUCKETS_LOG2 (reuse->buckets_log2)
+
+/* default and maximum size of the hashmap at creation */
+#define MNEMO_REUSE_BUCKETS_LOG2 5U
+#define MNEMO_REUSE_MAX_BUCKETS_LOG2 31U
+#endif
+
+/* default number of timestamps in the fenwick tree */
+#define MNEMO_REUSE_FENWICK_SIZE 4096
+
+/* minimum number of blocks of the approximate engine */
+#define MNEMO_REUSE_APPROX_BLOCKS 256
+
+/* fraction of the tracked keys that a fixed-size sampler forgets when it goes
+ * over its budget, so that the cost of lowering the threshold is amortized.
+ */
+#define MNEMO_REUSE_SAMPLE_EVICT 16
+
 /* the actual info needed to build reuse distance information
+ * - the engine used to count unique accesses
  * - a current timestamp
- * - an hashmap for (entry, last_time_of_access)
+ * - the number of unique keys seen so far
+ * - an hashmap for (entry, value), the value depending on the engine
  * - a splay tree for counting the number of unique accesses in between two
- *   access to the same entry.
+ *   access to the same entry. The value of an entry is its node in the tree,
+ *   nodes are allocated from an arena.
+ * - or a fenwick tree with a bit set at the last access time of each entry,
+ *   for the same purpose. The value of an entry is its last access time.
+ *   Timestamps are compacted when the tree is full.
+ * - or a list of blocks of consecutive timestamps, each with the number of
+ *   entries last accessed in that range, and a fenwick tree over those counts.
+ *   The value of an entry is its last access time. Each access appends a block,
+ *   and blocks are merged when the list is full, as long as the size of a block
+ *   stays within the error bound relative to the number of entries accessed
+ *   after it.
+ * - a sampling threshold: only the keys whose hash is below it are tracked,
+ *   the corresponding sampling rate, and the maximum number of keys to track,
+ *   0 for a fixed rate.
+ * - the histogram and the table of regions updated with each distance, if
+ *   any.
+ * - the series of snapshots of the histogram, if any, the length of the
+ *   intervals between automatic snapshots, 0 for none, the number of accesses
+ *   in the current interval, and the index of its first access.
+ * - the maximum number of keys given at init.
  */
 struct mnemo_reusedm {
+	enum mnemo_reuse_engine engine;
 	unsigned long long now;
+	size_t nkeys;
+#ifdef MNEMO_USE_UTHASH
 	struct mnemo_record *last_seen;
-	struct mnemo_record *splay;
+	struct mnemo_arena records;
+	unsigned buckets_log2;
+#else
+	struct mnemo_keymap last_seen;
+#endif
+	struct mnemo_node *splay;
+	struct mnemo_arena nodes;
+	struct mnemo_fenwick fenwick;
+	double error;
+	size_t nblocks;
+	uint64_t *starts;
+	int64_t *counts;
+	uint64_t threshold, threshold0;
+	double rate;
+	size_t smax;
+	struct mnemo_histogram *hist;
+	struct mnemo_regions *regions;
+	struct mnemo_series *series;
+	unsigned long long interval, ticks, istart;
+	size_t max;
 };
 
+#if defined(__GNUC__)
+#define mnemo_prefetch(p) __builtin_prefetch(p)
+#else
+#define mnemo_prefetch(p) ((void)(p))
+#endif
+
+/* Key map: the functions below are the only ones that depend on the hashmap
+ * implementation.
+ */
+
+#ifdef MNEMO_USE_UTHASH
+
+static void reusedm_map_init(struct mnemo_reusedm *reuse)
+{
+	/* one bucket per key: uthash only expands when a chain reaches 10
+	 * records, which does not happen at this load.
+	 */
+	reuse->last_seen = NULL;
+	reuse->buckets_log2 = MNEMO_REUSE_BUCKETS_LOG2;
+	while (reuse->buckets_log2 < MNEMO_REUSE_MAX_BUCKETS_LOG2 &&
+	       ((size_t)1 << reuse->buckets_log2) < reuse->max)
+		reuse->buckets_log2++;
+	mnemo_arena_init(&reuse->records, sizeof(struct mnemo_record));
+	mnemo_arena_reserve(&reuse->records, reuse->max);
+}
+
+static void reusedm_map_clear(struct mnemo_reusedm *reuse)
+{
+	HASH_CLEAR(hh, reuse->last_seen);
+	mnemo_arena_clear(&reuse->records);
+	mnemo_arena_reserve(&reuse->records, reuse->max);
+}
+
+static void reusedm_map_fini(struct mnemo_reusedm *reuse)
+{
+	HASH_CLEAR(hh, reuse->last_seen);
+	mnemo_arena_clear(&reuse->records);
+}
+
+static inline uint64_t reusedm_hash(unsigned long long key)
+{
+	unsigned hashv;
+
+	HASH_VALUE(&key, sizeof(key), hashv);
+	return hashv;
+}
+
+/* spread a hash value over 64 bits, for comparison with a sampling threshold */
+static inline uint64_t reusedm_sample_hash(uint64_t hash)
+{
+	return hash << 32;
+}
+
+/* return the value of a key, inserting the key if absent. */
+static inline uint64_t *reusedm_lookup(struct mnemo_reusedm *reuse,
+				       unsigned long long key, uint64_t hash,
+				       int *found)
+{
+	struct mnemo_record *rec = NULL;
+
+	HASH_FIND_BYHASHVALUE(hh, reuse->last_seen, &key, sizeof(key),
+			      (unsigned)hash, rec);
+	*found = rec != NULL;
+	if (rec == NULL) {
+		rec = mnemo_arena_alloc(&reuse->records);
+		rec->toto = key;
+		HASH_ADD_KEYPTR_BYHASHVALUE(hh, reuse->last_seen, &rec->toto,
+					    sizeof(rec->toto), (unsigned)hash,
+					    rec);
+	}
+	return &rec->value;
+}
+
+/* remove a key from the map, returning its value. */
+static inline uint64_t reusedm_map_remove(struct mnemo_reusedm *reuse,
+					  unsigned long long key,
+					  uint64_t hash)
+{
+	struct mnemo_record *rec = NULL;
+	uint64_t value;
+
+	HASH_FIND_BYHASHVALUE(hh, reuse->last_seen, &key, sizeof(key),
+			      (unsigned)hash, rec);
+	assert(rec != NULL);
+	value = rec->value;
+	HASH_DELETE(hh, reuse->last_seen, rec);
+	mnemo_arena_free(&reuse->records, rec);
+	return value;
+}
+
+/* prefetch the hashmap bucket a key falls into. */
+static inline void reusedm_prefetch_map(struct mnemo_reusedm *reuse,
+					uint64_t hash)
+{
+	unsigned bkt;
+	UT_hash_table *tbl;
+
+	if (reuse->last_seen == NULL)
+		return;
+	tbl = reuse->last_seen->hh.tbl;
+	HASH_TO_BKT((unsigned)hash, tbl->num_buckets, bkt);
+	mnemo_prefetch(&tbl->buckets[bkt]);
+}
+
+/* prefetch the first record chained in a bucket, the bucket itself should
+ * have been prefetched earlier.
+ */
+static inline void reusedm_prefetch_entry(struct mnemo_reusedm *reuse,
+					  unsigned long long key, uint64_t hash)
+{
+	unsigned bkt;
+	UT_hash_table *tbl;
+	UT_hash_handle *hh;
+
+	(void)key;
+	if (reuse->last_seen == NULL)
+		return;
+	tbl = reuse->last_seen->hh.tbl;
+	HASH_TO_BKT((unsigned)hash, tbl->num_buckets, bkt);
+	hh = tbl->buckets[bkt].hh_head;
+	if (hh != NULL)
+		mnemo_prefetch(ELMT_FROM_HH(tbl, hh));
+}
+
+/* call fn on the value of every key of the map. */
+static void reusedm_map_foreach(struct mnemo_reusedm *reuse,
+				void (*fn)(struct mnemo_reusedm *reuse,
+					   unsigned long long key,
+					   uint64_t *value, void *arg),
+				void *arg)
+{
+	struct mnemo_record *rec, *tmp;
+
+	HASH_ITER(hh, reuse->last_seen, rec, tmp)
+		fn(reuse, rec->toto, &rec->value, arg);
+}
+
+#else /* !MNEMO_USE_UTHASH */
+
+static void reusedm_map_init(struct mnemo_reusedm *reuse)
+{
+	mnemo_keymap_init(&reuse->last_seen, reuse->max);
+}
+
+static void reusedm_map_clear(struct mnemo_reusedm *reuse)
+{
+	mnemo_keymap_clear(&reuse->last_seen);
+}
+
+static void reusedm_map_fini(struct mnemo_reusedm *reuse)
+{
+	mnemo_keymap_fini(&reuse->last_seen);
+}
+
+static inline uint64_t reusedm_hash(unsigned long long key)
+{
+	return mnemo_keymap_hash(key);
+}
+
+/* spread a hash value over 64 bits, for comparison with a sampling threshold */
+static inline uint64_t reusedm_sample_hash(uint64_t hash)
+{
+	return hash;
+}
+
+/* return the value of a key, inserting the key if absent. */
+static inline uint64_t *reusedm_lookup(struct mnemo_reusedm *reuse,
+				       unsigned long long key, uint64_t hash,
+				       int *found)
+{
+	return &mnemo_keymap_lookup(&reuse->last_seen, key, hash,
+				    found)->value;
+}
+
+/* remove a key from the map, returning its value. */
+static inline uint64_t reusedm_map_remove(struct mnemo_reusedm *reuse,
+					  unsigned long long key,
+					  uint64_t hash)
+{
+	struct mnemo_keymap_slot *s;
+	uint64_t value;
+
+	s = mnemo_keymap_find(&reuse->last_seen, key, hash);
+	assert(s != NULL);
+	value = s->value;
+	mnemo_keymap_remove(&reuse->last_seen, s);
+	return value;
+}
+
+/* prefetch the slot a key hashes to. */
+static inline void reusedm_prefetch_map(struct mnemo_reusedm *reuse,
+					uint64_t hash)
+{
+	mnemo_keymap_prefetch(&reuse->last_seen, hash);
+}
+
+/* prefetch the tree node of a key, its slot should have been prefetched
+ * earlier. The fenwick engine keeps everything in the slot.
+ */
+static inline void reusedm_prefetch_entry(struct mnemo_reusedm *reuse,
+					  unsigned long long key, uint64_t hash)
+{
+	struct mnemo_keymap_slot *s;
+
+	if (reuse->engine != MNEMO_REUSE_SPLAY)
+		return;
+	s = mnemo_keymap_find(&reuse->last_seen, key, hash);
+	if (s != NULL)
+		mnemo_prefetch((void *)(uintptr_t)s->value);
+}
+
+/* call fn on the value of every key of the map. */
+static void reusedm_map_foreach(struct mnemo_reusedm *reuse,
+				void (*fn)(struct mnemo_reusedm *reuse,
+					   unsigned long long key,
+					   uint64_t *value, void *arg),
+				void *arg)
+{
+	struct mnemo_keymap *m = &reuse->last_seen;
+
+	for (size_t i = 0; i <= m->mask; i++)
+		if (m->slots[i].value != MNEMO_KEYMAP_EMPTY)
+			fn(reuse, m->slots[i].key, &m->slots[i].value, arg);
+}
+
+#endif /* MNEMO_USE_UTHASH */
+
+static void reusedm_approx_alloc(struct mnemo_reusedm *reuse, size_t size)
+{
+	reuse->starts = realloc(reuse->starts, size * sizeof(*reuse->starts));
+	reuse->counts = realloc(reuse->counts, size * sizeof(*reuse->counts));
+	assert(reuse->starts != NULL && reuse->counts != NULL);
+	mnemo_fenwick_resize(&reuse->fenwick, size);
+}
+
 /* allocate and init a new reuse record.
  * @param max the maximum number of keys the trace will contain, 0 if unknown.
+ * @param engine the data structure used to compute distances.
+ * @param error the error bound of the approximate engine.
  */
-struct mnemo_reusedm *mnemo_reusedm_init(size_t max)
+static struct mnemo_reusedm *reusedm_init(size_t max,
+					  enum mnemo_reuse_engine engine,
+					  double error)
 {
 	struct mnemo_reusedm *ret;
 
-	assert(max == 0);
+	assert(engine == MNEMO_REUSE_SPLAY || engine == MNEMO_REUSE_FENWICK ||
+	       engine == MNEMO_REUSE_APPROX);
 	ret = calloc(1, sizeof(struct mnemo_reusedm));
 	assert(ret != NULL);
+	ret->engine = engine;
 	ret->now = 0;
-	ret->last_seen = NULL;
+	ret->nkeys = 0;
 	ret->splay = NULL;
+	ret->threshold = ret->threshold0 = UINT64_MAX;
+	ret->rate = 1.0;
+	ret->smax = 0;
+	ret->hist = NULL;
+	ret->regions = NULL;
+	ret->series = NULL;
+	ret->interval = ret->ticks = ret->istart = 0;
+	ret->max = max;
+	reusedm_map_init(ret);
+	mnemo_arena_init(&ret->nodes, sizeof(struct mnemo_node));
+	if (engine == MNEMO_REUSE_SPLAY)
+		mnemo_arena_reserve(&ret->nodes, max);
+	if (engine == MNEMO_REUSE_FENWICK) {
+		/* leave room for at least as many reuses as keys between two
+		 * compactions.
+		 */
+		size_t size = MNEMO_REUSE_FENWICK_SIZE;
+		while (size < 2 * max)
+			size *= 2;
+		mnemo_fenwick_init(&ret->fenwick, size);
+	}
+	if (engine == MNEMO_REUSE_APPROX) {
+		ret->error = error;
+		ret->nblocks = 0;
+		reusedm_approx_alloc(ret, MNEMO_REUSE_APPROX_BLOCKS);
+	}
 	return ret;
 }
 
-int mnemo_reusedm_add(struct mnemo_reusedm *reuse, unsigned long long key)
+struct mnemo_reusedm *mnemo_reusedm_init(size_t max)
+{
+	return mnemo_reusedm_init_engine(max, MNEMO_REUSE_SPLAY);
+}
+
+struct mnemo_reusedm *mnemo_reusedm_init_engine(size_t max,
+						enum mnemo_reuse_engine engine)
+{
+	if (engine == MNEMO_REUSE_APPROX)
+		return mnemo_reusedm_init_approx(max, MNEMO_REUSE_APPROX_ERROR);
+	return reusedm_init(max, engine, 0.0);
+}
+
+struct mnemo_reusedm *mnemo_reusedm_init_approx(size_t max, double error)
+{
+	assert(error > 0.0 && error < 1.0);
+	return reusedm_init(max, MNEMO_REUSE_APPROX, error);
+}
+
+/* sampling rate corresponding to a threshold */
+static double reusedm_sample_rate(uint64_t threshold)
+{
+	return ((double)threshold + 1.0) / 18446744073709551616.0;
+}
+
+struct mnemo_reusedm *mnemo_reusedm_init_sampled(size_t max,
+						 enum mnemo_reuse_engine engine,
+						 double rate, size_t smax)
+{
+	struct mnemo_reusedm *ret;
+
+	assert(rate > 0.0 && rate <= 1.0);
+	if (max == 0)
+		max = smax;
+	if (engine == MNEMO_REUSE_APPROX)
+		ret = mnemo_reusedm_init_approx(max, MNEMO_REUSE_APPROX_ERROR);
+	else
+		ret = mnemo_reusedm_init_engine(max, engine);
+	if (rate < 1.0)
+		ret->threshold0 = rate * 18446744073709551616.0;
+	ret->threshold = ret->threshold0;
+	ret->rate = reusedm_sample_rate(ret->threshold);
+	ret->smax = smax;
+	return ret;
+}
+
+double mnemo_reusedm_rate(const struct mnemo_reusedm *reuse)
 {
 	assert(reuse != NULL);
-	struct mnemo_record *rec = NULL;
-	int distance = -1;
-	HASH_FIND(hh, reuse->last_seen, &key, sizeof(key), rec);
-	if (rec != NULL) {
-		/* fun fact: since the record has both a hash handle and a splay
+	return reuse->rate;
+}
+
+/* number of keys ahead of the current one that the batch loop hashes and
+ * prefetches. The hashmap is prefetched at this distance, and the engine data
+ * of the key at half this distance, once the map is likely in cache.
+ */
+#define MNEMO_REUSE_PREFETCH 16
+
+static inline int64_t reusedm_splay_add(struct mnemo_reusedm *reuse,
+					uint64_t *value, int found)
+{
+	struct mnemo_node *node;
+	int64_t distance = -1;
+	if (found) {
+		/* fun fact: since the hashmap points directly to the splay
 		 * node, we don't need to use find, and can directly splay the
 		 * node
 		 */
-		SPLAY_SPLAY(reuse->splay, rec);
-		if(rec->right == NULL)
+		node = (struct mnemo_node *)(uintptr_t)*value;
+		SPLAY_SPLAY(reuse->splay, node);
+		if(node->right == NULL)
 			distance = 0;
 		else
-			distance = rec->right->weight;
-		SPLAY_REMOVE2(reuse->splay, &rec->time, sizeof(rec->time), rec,
-			      time, left, right, parent);
-		HASH_DEL(reuse->last_seen, rec);
+			distance = node->right->weight;
+		SPLAY_REMOVE2(reuse->splay, &node->time, sizeof(node->time),
+			      node, time, left, right, parent);
 	}
 	else {
-		rec = calloc(1, sizeof(struct mnemo_record));
-		assert(rec != NULL);
+		node = mnemo_arena_alloc(&reuse->nodes);
+		*value = (uintptr_t)node;
+	}
+	node->time = reuse->now++;
+	SPLAY_ADD2(reuse->splay, time, sizeof(node->time), node);
+	return distance;
+}
+
+static void reusedm_fenwick_rank(struct mnemo_reusedm *reuse,
+				 unsigned long long key, uint64_t *value,
+				 void *arg)
+{
+	(void)key;
+	(void)arg;
+	*value = mnemo_fenwick_prefix(&reuse->fenwick, *value);
+}
+
+/* renumber the last access of each key to its rank among all last accesses,
+ * freeing the end of the fenwick tree. The tree doubles in size if it would
+ * end up more than half full.
+ */
+static void reusedm_fenwick_compact(struct mnemo_reusedm *reuse)
+{
+	size_t size = reuse->fenwick.size;
+
+	/* the tree is only modified once all ranks are known */
+	reusedm_map_foreach(reuse, reusedm_fenwick_rank, NULL);
+	while (reuse->nkeys > size / 2)
+		size *= 2;
+	if (size != reuse->fenwick.size)
+		mnemo_fenwick_resize(&reuse->fenwick, size);
+	mnemo_fenwick_fill(&reuse->fenwick, reuse->nkeys);
+	reuse->now = reuse->nkeys;
+}
+
+static inline int64_t reusedm_fenwick_add(struct mnemo_reusedm *reuse,
+					  uint64_t *value, int found)
+{
+	int64_t distance = -1;
+
+	if (found) {
+		/* every key has exactly one bit set, the distance is the
+		 * number of bits set after the last access to this one.
+		 */
+		distance = reuse->nkeys -
+			mnemo_fenwick_prefix(&reuse->fenwick, *value + 1);
+		mnemo_fenwick_add(&reuse->fenwick, *value, -1);
+	}
+	*value = reuse->now++;
+	mnemo_fenwick_add(&reuse->fenwick, *value, 1);
+	return distance;
+}
+
+/* merge blocks from the most recent to the oldest, as long as the merged
+ * block respects the error bound. The list doubles in size if it would end up
+ * more than half full.
+ */
+static void reusedm_approx_compact(struct mnemo_reusedm *reuse)
+{
+	size_t n = reuse->nblocks, size = reuse->fenwick.size, out;
+	uint64_t start;
+	int64_t count, after = 0;
+
+	/* a block of count keys, with after keys accessed since, reports
+	 * distances within count / 2 of the exact one.
+	 */
+	out = n;
+	start = reuse->starts[n - 1];
+	count = reuse->counts[n - 1];
+	for (size_t i = n - 1; i-- > 0;) {
+		if (count + reuse->counts[i] <= 2 * reuse->error * after) {
+			start = reuse->starts[i];
+			count += reuse->counts[i];
+			continue;
+		}
+		out--;
+		reuse->starts[out] = start;
+		reuse->counts[out] = count;
+		after += count;
+		start = reuse->starts[i];
+		count = reuse->counts[i];
+	}
+	out--;
+	reuse->starts[out] = start;
+	reuse->counts[out] = count;
+
+	reuse->nblocks = n - out;
+	memmove(reuse->starts, &reuse->starts[out],
+		reuse->nblocks * sizeof(*reuse->starts));
+	memmove(reuse->counts, &reuse->counts[out],
+		reuse->nblocks * sizeof(*reuse->counts));
+	while (reuse->nblocks > size / 2)
+		size *= 2;
+	if (size != reuse->fenwick.size)
+		reusedm_approx_alloc(reuse, size);
+	mnemo_fenwick_build(&reuse->fenwick, reuse->counts, reuse->nblocks);
+}
+
+/* find the block of an access: the last one starting before it. */
+static inline size_t reusedm_approx_block(const struct mnemo_reusedm *reuse,
+					  uint64_t time)
+{
+	size_t lo = 0, hi = reuse->nblocks;
+
+	while (hi - lo > 1) {
+		size_t mid = lo + (hi - lo) / 2;
+
+		if (reuse->starts[mid] <= time)
+			lo = mid;
+		else
+			hi = mid;
+	}
+	return lo;
+}
+
+static inline int64_t reusedm_approx_add(struct mnemo_reusedm *reuse,
+					 uint64_t *value, int found)
+{
+	int64_t distance = -1;
+
+	if (reuse->nblocks == reuse->fenwick.size)
+		reusedm_approx_compact(reuse);
+	if (found) {
+		size_t lo = reusedm_approx_block(reuse, *value);
+		int64_t after;
+
+		after = reuse->nkeys - mnemo_fenwick_prefix(&reuse->fenwick,
+							     lo + 1);
+		distance = after + (reuse->counts[lo] - 1) / 2;
+		reuse->counts[lo]--;
+		mnemo_fenwick_add(&reuse->fenwick, lo, -1);
 	}
-	rec->toto = key;
-	rec->time = reuse->now++;
-	HASH_ADD(hh, reuse->last_seen, toto, sizeof(rec->toto), rec);
-	SPLAY_ADD2(reuse->splay, time, sizeof(rec->time), rec);
+	reuse->starts[reuse->nblocks] = reuse->now;
+	reuse->counts[reuse->nblocks] = 1;
+	mnemo_fenwick_add(&reuse->fenwick, reuse->nblocks, 1);
+	reuse->nblocks++;
+	*value = reuse->now++;
 	return distance;
 }
 
+/* core of the reuse distance computation, for a key whose hash value has
+ * already been computed by the caller.
+ */
+static inline int64_t reusedm_add(struct mnemo_reusedm *reuse,
+				  unsigned long long key, uint64_t hash)
+{
+	uint64_t *value;
+	int found;
+
+	/* compaction renumbers all values, it must happen before the lookup
+	 * of a new key, whose value isn't set yet.
+	 */
+	if (reuse->engine == MNEMO_REUSE_FENWICK &&
+	    reuse->now == reuse->fenwick.size)
+		reusedm_fenwick_compact(reuse);
+	value = reusedm_lookup(reuse, key, hash, &found);
+	if (!found)
+		reuse->nkeys++;
+	switch (reuse->engine) {
+	case MNEMO_REUSE_FENWICK:
+		return reusedm_fenwick_add(reuse, value, found);
+	case MNEMO_REUSE_APPROX:
+		return reusedm_approx_add(reuse, value, found);
+	default:
+		return reusedm_splay_add(reuse, value, found);
+	}
+}
+
+/* forget a key, as if it had never been accessed. */
+static void reusedm_remove(struct mnemo_reusedm *reuse, unsigned long long key,
+			   uint64_t hash)
+{
+	uint64_t value = reusedm_map_remove(reuse, key, hash);
+	struct mnemo_node *node;
+	size_t b;
+
+	switch (reuse->engine) {
+	case MNEMO_REUSE_FENWICK:
+		mnemo_fenwick_add(&reuse->fenwick, value, -1);
+		break;
+	case MNEMO_REUSE_APPROX:
+		b = reusedm_approx_block(reuse, value);
+		reuse->counts[b]--;
+		mnemo_fenwick_add(&reuse->fenwick, b, -1);
+		break;
+	default:
+		node = (struct mnemo_node *)(uintptr_t)value;
+		SPLAY_SPLAY(reuse->splay, node);
+		SPLAY_REMOVE2(reuse->splay, &node->time, sizeof(node->time),
+			      node, time, left, right, parent);
+		mnemo_arena_free(&reuse->nodes, node);
+		break;
+	}
+	reuse->nkeys--;
+}
+
+/* a tracked key and its spread hash, see reusedm_sample_evict */
+struct reusedm_sample {
+	unsigned long long key;
+	uint64_t hash;
+};
+
+static void reusedm_sample_collect(struct mnemo_reusedm *reuse,
+				   unsigned long long key, uint64_t *value,
+				   void *arg)
+{
+	struct reusedm_sample **next = arg;
+
+	(void)reuse;
+	(void)value;
+	(*next)->key = key;
+	(*next)->hash = reusedm_sample_hash(reusedm_hash(key));
+	(*next)++;
+}
+
+static inline void reusedm_sample_swap(struct reusedm_sample *s, size_t i,
+				       size_t j)
+{
+	struct reusedm_sample tmp = s[i];
+
+	s[i] = s[j];
+	s[j] = tmp;
+}
+
+/* return the k-th smallest hash of an array of n samples, reordering it. */
+static uint64_t reusedm_sample_select(struct reusedm_sample *s, size_t n,
+				      size_t k)
+{
+	size_t lo = 0, hi = n;
+
+	/* quickselect, with a middle pivot: hashes are random anyway */
+	while (hi - lo > 1) {
+		uint64_t pivot = s[lo + (hi - lo) / 2].hash;
+		size_t lt = lo, i = lo, gt = hi;
+
+		/* three way partition: [lo, lt) < pivot, [gt, hi) > pivot */
+		while (i < gt) {
+			if (s[i].hash < pivot)
+				reusedm_sample_swap(s, lt++, i++);
+			else if (s[i].hash > pivot)
+				reusedm_sample_swap(s, --gt, i);
+			else
+				i++;
+		}
+		if (k < lt)
+			hi = lt;
+		else if (k >= gt)
+			lo = gt;
+		else
+			return pivot;
+	}
+	return s[k].hash;
+}
+
+/* lower the sampling threshold so that a fixed-size sampler gets back under
+ * its budget, forgetting the keys above the new threshold.
+ */
+static void reusedm_sample_evict(struct mnemo_reusedm *reuse)
+{
+	size_t n = reuse->nkeys;
+	size_t keep = reuse->smax - reuse->smax / MNEMO_REUSE_SAMPLE_EVICT;
+	struct reusedm_sample *samples, *next;
+	uint64_t limit;
+
+	samples = malloc(n * sizeof(*samples));
+	assert(samples != NULL);
+	next = samples;
+	reusedm_map_foreach(reuse, reusedm_sample_collect, &next);
+	limit = reusedm_sample_select(samples, n, keep);
+	if (limit > 0)
+		reuse->threshold = limit - 1;
+	else
+		reuse->threshold = 0;
+	reuse->rate = reusedm_sample_rate(reuse->threshold);
+	for (size_t i = 0; i < n; i++)
+		if (samples[i].hash > reuse->threshold)
+			reusedm_remove(reuse, samples[i].key,
+				       reusedm_hash(samples[i].key));
+	free(samples);
+}
+
+/* close the current interval, if it holds any access. */
+static void reusedm_snapshot(struct mnemo_reusedm *reuse)
+{
+	if (reuse->ticks == 0)
+		return;
+	mnemo_series_snapshot(reuse->series, reuse->hist, reuse->istart,
+			      reuse->ticks);
+	reuse->istart += reuse->ticks;
+	reuse->ticks = 0;
+}
+
+/* sampling front end: skip the keys above the threshold, scale the distance
+ * of the others by the sampling rate.
+ */
+static inline int64_t reusedm_sample_track(struct mnemo_reusedm *reuse,
+					   unsigned long long key,
+					   uint64_t hash)
+{
+	int64_t distance;
+
+	distance = reusedm_add(reuse, key, hash);
+	if (distance > 0 && reuse->rate < 1.0)
+		distance = distance / reuse->rate;
+	if (reuse->hist != NULL)
+		mnemo_histogram_count(reuse->hist, distance, 1.0 / reuse->rate);
+	if (reuse->regions != NULL)
+		mnemo_regions_count(reuse->regions, key, distance,
+				    1.0 / reuse->rate);
+	if (reuse->smax != 0 && reuse->nkeys > reuse->smax)
+		reusedm_sample_evict(reuse);
+	return distance;
+}
+
+static inline int64_t reusedm_sample_add(struct mnemo_reusedm *reuse,
+					 unsigned long long key, uint64_t hash)
+{
+	int64_t distance = MNEMO_REUSE_SKIPPED;
+
+	if (reusedm_sample_hash(hash) <= reuse->threshold)
+		distance = reusedm_sample_track(reuse, key, hash);
+	/* skipped accesses count in the length of intervals too */
+	if (reuse->series != NULL && ++reuse->ticks == reuse->interval)
+		reusedm_snapshot(reuse);
+	return distance;
+}
+
+int mnemo_reusedm_add(struct mnemo_reusedm *reuse, unsigned long long key)
+{
+	assert(reuse != NULL);
+	return reusedm_sample_add(reuse, key, reusedm_hash(key));
+}
+
+int64_t mnemo_reusedm_add64(struct mnemo_reusedm *reuse,
+			    unsigned long long key)
+{
+	assert(reuse != NULL);
+	return reusedm_sample_add(reuse, key, reusedm_hash(key));
+}
+
+void mnemo_reusedm_add_batch(struct mnemo_reusedm *reuse,
+			     const unsigned long long *keys, size_t n,
+			     int64_t *out)
+{
+	/* ring of the hash values computed ahead of time */
+	uint64_t hashv[MNEMO_REUSE_PREFETCH];
+	const size_t half = MNEMO_REUSE_PREFETCH / 2;
+
+	assert(reuse != NULL);
+	assert(n == 0 || keys != NULL);
+
+	for (size_t i = 0; i < n && i < MNEMO_REUSE_PREFETCH; i++) {
+		hashv[i] = reusedm_hash(keys[i]);
+		if (reusedm_sample_hash(hashv[i]) <= reuse->threshold)
+			reusedm_prefetch_map(reuse, hashv[i]);
+	}
+	for (size_t i = 0; i < n; i++) {
+		size_t slot = i % MNEMO_REUSE_PREFETCH;
+		uint64_t h = hashv[slot];
+		int64_t distance;
+
+		/* skipped keys are not prefetched */
+		if (i + MNEMO_REUSE_PREFETCH < n) {
+			hashv[slot] = reusedm_hash(keys[i + MNEMO_REUSE_PREFETCH]);
+			if (reusedm_sample_hash(hashv[slot]) <= reuse->threshold)
+				reusedm_prefetch_map(reuse, hashv[slot]);
+		}
+		if (i + half < n) {
+			uint64_t ahead = hashv[(i + half) % MNEMO_REUSE_PREFETCH];
+
+			if (reusedm_sample_hash(ahead) <= reuse->threshold)
+				reusedm_prefetch_entry(reuse, keys[i + half],
+						       ahead);
+		}
+		distance = reusedm_sample_add(reuse, keys[i], h);
+		if (out != NULL)
+			out[i] = distance;
+	}
+}
+
+/* smallest chunk of a parallel batch, smaller batches are not worth the
+ * threads.
+ */
+#define MNEMO_REUSE_MIN_CHUNK 65536
+
+/* a chunk of a parallel batch:
+ * - the keys of the chunk and their distances, -1 for the first access to a
+ *   key within the chunk.
+ * - the keys of the chunk, each once, by order of their last access.
+ * - the thread computing the distances.
+ */
+struct reusedm_chunk {
+	const unsigned long long *keys;
+	int64_t *out;
+	size_t n;
+	unsigned long long *lasts;
+	size_t nlasts;
+	pthread_t thread;
+};
+
+static void reusedm_chunk_last(struct mnemo_reusedm *reuse,
+			       unsigned long long key, uint64_t *value,
+			       void *arg)
+{
+	unsigned long long *lasts = arg;
+
+	(void)reuse;
+	lasts[*value] = key;
+}
+
+/* compute the distances within a chunk, with a private fenwick engine. */
+static void *reusedm_chunk_run(void *arg)
+{
+	struct reusedm_chunk *c = arg;
+	struct mnemo_reusedm *local;
+
+	local = reusedm_init(0, MNEMO_REUSE_FENWICK, 0.0);
+	mnemo_reusedm_add_batch(local, c->keys, c->n, c->out);
+	/* compaction turns the value of each key into the rank of its last
+	 * access.
+	 */
+	reusedm_fenwick_compact(local);
+	c->nlasts = local->nkeys;
+	c->lasts = malloc(c->nlasts * sizeof(*c->lasts));
+	assert(c->nlasts == 0 || c->lasts != NULL);
+	reusedm_map_foreach(local, reusedm_chunk_last, c->lasts);
+	mnemo_reusedm_fini(local);
+	return NULL;
+}
+
+/* resolve the first accesses of a chunk against the state of the manager at
+ * the start of the chunk, then bring the manager to its state at the end of
+ * the chunk.
+ */
+static void reusedm_chunk_merge(struct mnemo_reusedm *reuse,
+				struct reusedm_chunk *c)
+{
+	/* Feeding the first access of each key, in order, puts the keys seen
+	 * earlier in the chunk on top of the stack, each exactly once, with
+	 * the rest of the stack in its order at the start of the chunk: that
+	 * is the right distance, even if the order of the top keys isn't.
+	 */
+	for (size_t i = 0; i < c->n; i++)
+		if (c->out[i] == -1)
+			c->out[i] = reusedm_add(reuse, c->keys[i],
+						reusedm_hash(c->keys[i]));
+	/* touching the keys again by order of last access fixes it. */
+	for (size_t i = 0; i < c->nlasts; i++)
+		reusedm_add(reuse, c->lasts[i], reusedm_hash(c->lasts[i]));
+	if (reuse->hist != NULL)
+		for (size_t i = 0; i < c->n; i++)
+			mnemo_histogram_count(reuse->hist, c->out[i], 1.0);
+	if (reuse->regions != NULL)
+		for (size_t i = 0; i < c->n; i++)
+			mnemo_regions_count(reuse->regions, c->keys[i],
+					    c->out[i], 1.0);
+}
+
+void mnemo_reusedm_add_parallel(struct mnemo_reusedm *reuse,
+				const unsigned long long *keys, size_t n,
+				int64_t *out, unsigned int nthreads)
+{
+	struct reusedm_chunk *chunks;
+	int64_t *buf = out;
+	size_t start = 0;
+	int err;
+
+	assert(reuse != NULL);
+	assert(n == 0 || keys != NULL);
+	if (nthreads == 0) {
+		long ncpus = sysconf(_SC_NPROCESSORS_ONLN);
+
+		nthreads = ncpus > 0 ? ncpus : 1;
+	}
+	if (n / nthreads < MNEMO_REUSE_MIN_CHUNK)
+		nthreads = n / MNEMO_REUSE_MIN_CHUNK;
+
+	/* only exact, unsampled distances can be merged, and snapshots must
+	 * be taken in trace order.
+	 */
+	if (nthreads <= 1 || reuse->engine == MNEMO_REUSE_APPROX ||
+	    reuse->threshold0 != UINT64_MAX || reuse->smax != 0 ||
+	    reuse->series != NULL) {
+		mnemo_reusedm_add_batch(reuse, keys, n, out);
+		return;
+	}
+
+	if (buf == NULL) {
+		buf = malloc(n * sizeof(*buf));
+		assert(buf != NULL);
+	}
+	chunks = calloc(nthreads, sizeof(*chunks));
+	assert(chunks != NULL);
+	for (unsigned int t = 0; t < nthreads; t++) {
+		size_t end = t + 1 == nthreads ? n : start + n / nthreads;
+
+		chunks[t].keys = &keys[start];
+		chunks[t].out = &buf[start];
+		chunks[t].n = end - start;
+		err = pthread_create(&chunks[t].thread, NULL, reusedm_chunk_run,
+				     &chunks[t]);
+		assert(err == 0);
+		start = end;
+	}
+	/* chunks are merged in trace order, while the later ones are still
+	 * being computed.
+	 */
+	for (unsigned int t = 0; t < nthreads; t++) {
+		err = pthread_join(chunks[t].thread, NULL);
+		assert(err == 0);
+		reusedm_chunk_merge(reuse, &chunks[t]);
+		free(chunks[t].lasts);
+	}
+	(void)err;
+	free(chunks);
+	if (out == NULL)
+		free(buf);
+}
+
+void mnemo_reusedm_attach(struct mnemo_reusedm *reuse,
+			  struct mnemo_histogram *h)
+{
+	assert(reuse != NULL);
+	reuse->hist = h;
+}
+
+void mnemo_reusedm_attach_regions(struct mnemo_reusedm *reuse,
+				  struct mnemo_regions *g)
+{
+	assert(reuse != NULL);
+	reuse->regions = g;
+}
+
+void mnemo_reusedm_intervals(struct mnemo_reusedm *reuse,
+			     struct mnemo_series *s,
+			     unsigned long long length)
+{
+	assert(reuse != NULL);
+	assert(s == NULL || reuse->hist != NULL);
+	reuse->series = s;
+	reuse->interval = length;
+	reuse->istart += reuse->ticks;
+	reuse->ticks = 0;
+}
+
+void mnemo_reusedm_mark(struct mnemo_reusedm *reuse)
+{
+	assert(reuse != NULL);
+	if (reuse->series != NULL)
+		reusedm_snapshot(reuse);
+}
+
 void mnemo_reusedm_reset(struct mnemo_reusedm *reuse)
 {
 	assert(reuse != NULL);
-	HASH_CLEAR(hh, reuse->last_seen);
-	SPLAY_CLEAR(reuse->splay);
+	reusedm_map_clear(reuse);
+	/* nodes are all released with the arena, no need to walk the tree */
+	reuse->splay = NULL;
+	mnemo_arena_clear(&reuse->nodes);
+	if (reuse->engine == MNEMO_REUSE_SPLAY)
+		mnemo_arena_reserve(&reuse->nodes, reuse->max);
+	mnemo_fenwick_fill(&reuse->fenwick, 0);
+	reuse->nblocks = 0;
+	reuse->threshold = reuse->threshold0;
+	reuse->rate = reusedm_sample_rate(reuse->threshold);
+	reuse->now = 0;
+	reuse->ticks = reuse->istart = 0;
+	reuse->nkeys = 0;
 }
 
 void mnemo_reusedm_fini(struct mnemo_reusedm *reuse)
 {
-	mnemo_reusedm_reset(reuse);
+	assert(reuse != NULL);
+	reusedm_map_fini(reuse);
+	mnemo_arena_clear(&reuse->nodes);
+	mnemo_fenwick_fini(&reuse->fenwick);
+	free(reuse->starts);
+	free(reuse->counts);
 	free(reuse);
 }
+
+/* Checkpoints:
+ * - a header: the magic string, the version of the format and the engine,
+ *   the current timestamp, the number of keys, the maximum number of keys
+ *   given at init, the initial and current sampling thresholds, the budget of
+ *   sampled keys, the error bound as a double, and the number of blocks and
+ *   the size of the list of blocks of the approximate engine, on which its
+ *   compactions depend, all little-endian.
+ * - a record per key: the key and its last access time, sorted by time.
+ * - for the approximate engine, the start of each block, then its count.
+ * Records and blocks are flat arrays of little-endian 64-bit words, used in
+ * place from the mapping of the file.
+ */
+#define MNEMO_CHECKPOINT_MAGIC "MNEMOCKP"
+#define MNEMO_CHECKPOINT_VERSION 1
+#define MNEMO_CHECKPOINT_HEADER 88
+
+struct reusedm_record {
+	uint64_t key;
+	uint64_t time;
+};
+
+static void reusedm_record_collect(struct mnemo_reusedm *reuse,
+				   unsigned long long key, uint64_t *value,
+				   void *arg)
+{
+	struct reusedm_record **next = arg;
+
+	(*next)->key = key;
+	if (reuse->engine == MNEMO_REUSE_SPLAY)
+		(*next)->time = ((struct mnemo_node *)(uintptr_t)*value)->time;
+	else
+		(*next)->time = *value;
+	(*next)++;
+}
+
+static int reusedm_record_cmp(const void *a, const void *b)
+{
+	const struct reusedm_record *ra = a, *rb = b;
+
+	return (ra->time > rb->time) - (ra->time < rb->time);
+}
+
+static int reusedm_write64(FILE *f, const uint64_t *v, size_t n)
+{
+	uint64_t buf[512];
+
+	while (n > 0) {
+		size_t len = n < 512 ? n : 512;
+
+		for (size_t i = 0; i < len; i++)
+			buf[i] = mnemo_le64(v[i]);
+		if (fwrite(buf, sizeof(*buf), len, f) != len)
+			return -1;
+		v += len;
+		n -= len;
+	}
+	return 0;
+}
+
+/* the keys and last access times of all the keys, sorted by time. */
+static struct reusedm_record *reusedm_records(struct mnemo_reusedm *reuse)
+{
+	struct reusedm_record *ret, *next;
+
+	ret = malloc((reuse->nkeys + 1) * sizeof(*ret));
+	assert(ret != NULL);
+	next = ret;
+	reusedm_map_foreach(reuse, reusedm_record_collect, &next);
+	assert((size_t)(next - ret) == reuse->nkeys);
+	qsort(ret, reuse->nkeys, sizeof(*ret), reusedm_record_cmp);
+	return ret;
+}
+
+size_t mnemo_reusedm_nkeys(const struct mnemo_reusedm *reuse)
+{
+	assert(reuse != NULL);
+	return reuse->nkeys;
+}
+
+void mnemo_reusedm_stack(struct mnemo_reusedm *reuse, unsigned long long *keys)
+{
+	struct reusedm_record *records;
+
+	assert(reuse != NULL);
+	assert(reuse->nkeys == 0 || keys != NULL);
+	records = reusedm_records(reuse);
+	for (size_t i = 0; i < reuse->nkeys; i++)
+		keys[i] = records[i].key;
+	free(records);
+}
+
+int mnemo_reusedm_save(struct mnemo_reusedm *reuse, const char *path)
+{
+	unsigned char header[MNEMO_CHECKPOINT_HEADER] = { 0 };
+	struct reusedm_record *records;
+	uint64_t error;
+	FILE *f;
+	int err = 0;
+
+	assert(reuse != NULL && path != NULL);
+	records = reusedm_records(reuse);
+
+	memcpy(header, MNEMO_CHECKPOINT_MAGIC, strlen(MNEMO_CHECKPOINT_MAGIC));
+	mnemo_put64(&header[8], MNEMO_CHECKPOINT_VERSION |
+		    (uint64_t)reuse->engine << 32);
+	mnemo_put64(&header[16], reuse->now);
+	mnemo_put64(&header[24], reuse->nkeys);
+	mnemo_put64(&header[32], reuse->max);
+	mnemo_put64(&header[40], reuse->threshold0);
+	mnemo_put64(&header[48], reuse->threshold);
+	mnemo_put64(&header[56], reuse->smax);
+	memcpy(&error, &reuse->error, sizeof(error));
+	mnemo_put64(&header[64], error);
+	mnemo_put64(&header[72], reuse->nblocks);
+	if (reuse->engine == MNEMO_REUSE_APPROX)
+		mnemo_put64(&header[80], reuse->fenwick.size);
+
+	f = fopen(path, "wb");
+	if (f == NULL) {
+		err = -errno;
+		goto out;
+	}
+	if (fwrite(header, sizeof(header), 1, f) != 1 ||
+	    reusedm_write64(f, (uint64_t *)records, 2 * reuse->nkeys) ||
+	    reusedm_write64(f, reuse->starts, reuse->nblocks) ||
+	    reusedm_write64(f, (uint64_t *)reuse->counts, reuse->nblocks))
+		err = -errno;
+	if (fclose(f) != 0 && err == 0)
+		err = -errno;
+out:
+	free(records);
+	return err;
+}
+
+/* build a balanced tree out of nodes sorted by time. */
+static struct mnemo_node *reusedm_splay_build(struct mnemo_node **nodes,
+					      size_t n,
+					      struct mnemo_node *parent)
+{
+	struct mnemo_node *root;
+
+	if (n == 0)
+		return NULL;
+	root = nodes[n / 2];
+	root->parent = parent;
+	root->left = reusedm_splay_build(nodes, n / 2, root);
+	root->right = reusedm_splay_build(&nodes[n / 2 + 1], n - n / 2 - 1,
+					  root);
+	root->weight = n;
+	return root;
+}
+
+/* restore the keys and engine state of a checkpoint, return 0 if valid. */
+static int reusedm_restore(struct mnemo_reusedm *reuse,
+			   const uint64_t *records, size_t nkeys,
+			   const uint64_t *starts, const uint64_t *counts,
+			   size_t nblocks, size_t size)
+{
+	struct mnemo_node **nodes = NULL;
+	int64_t total = 0;
+
+	if (reuse->engine == MNEMO_REUSE_SPLAY) {
+		nodes = malloc((nkeys + 1) * sizeof(*nodes));
+		assert(nodes != NULL);
+	}
+	for (size_t i = 0; i < nkeys; i++) {
+		unsigned long long key = mnemo_le64(records[2 * i]);
+		uint64_t time = mnemo_le64(records[2 * i + 1]);
+		uint64_t *value;
+		int found;
+
+		if (time >= reuse->now ||
+		    (i > 0 && time <= mnemo_le64(records[2 * i - 1])))
+			goto err;
+		value = reusedm_lookup(reuse, key, reusedm_hash(key), &found);
+		if (found)
+			goto err;
+		reuse->nkeys++;
+		switch (reuse->engine) {
+		case MNEMO_REUSE_FENWICK:
+			/* only the order of the last accesses matters */
+			*value = i;
+			break;
+		case MNEMO_REUSE_APPROX:
+			*value = time;
+			break;
+		default:
+			nodes[i] = mnemo_arena_alloc(&reuse->nodes);
+			nodes[i]->time = time;
+			*value = (uintptr_t)nodes[i];
+			break;
+		}
+	}
+	switch (reuse->engine) {
+	case MNEMO_REUSE_FENWICK:
+		while (nkeys > reuse->fenwick.size / 2)
+			mnemo_fenwick_resize(&reuse->fenwick,
+					     2 * reuse->fenwick.size);
+		mnemo_fenwick_fill(&reuse->fenwick, nkeys);
+		reuse->now = nkeys;
+		break;
+	case MNEMO_REUSE_APPROX:
+		if (size != reuse->fenwick.size)
+			reusedm_approx_alloc(reuse, size);
+		for (size_t b = 0; b < nblocks; b++) {
+			reuse->starts[b] = mnemo_le64(starts[b]);
+			reuse->counts[b] = mnemo_le64(counts[b]);
+			if (reuse->starts[b] >= reuse->now ||
+			    (b > 0 && reuse->starts[b] <= reuse->starts[b - 1]) ||
+			    reuse->counts[b] < 0)
+				goto err;
+			total += reuse->counts[b];
+		}
+		if ((size_t)total != nkeys || (nkeys > 0 && nblocks == 0))
+			goto err;
+		reuse->nblocks = nblocks;
+		mnemo_fenwick_build(&reuse->fenwick, reuse->counts, nblocks);
+		break;
+	default:
+		reuse->splay = reusedm_splay_build(nodes, nkeys, NULL);
+		break;
+	}
+	free(nodes);
+	return 0;
+err:
+	free(nodes);
+	return -1;
+}
+
+struct mnemo_reusedm *mnemo_reusedm_load(const char *path)
+{
+	struct mnemo_reusedm *ret = NULL;
+	const unsigned char *map;
+	uint64_t version, now, nkeys, nblocks, size, max, bits;
+	enum mnemo_reuse_engine engine;
+	size_t mapsize;
+	double error;
+
+	assert(path != NULL);
+	map = mnemo_mapfile(path, MNEMO_CHECKPOINT_MAGIC,
+			    MNEMO_CHECKPOINT_HEADER, &mapsize);
+	if (map == NULL)
+		return NULL;
+	version = mnemo_get64(&map[8]);
+	engine = version >> 32;
+	now = mnemo_get64(&map[16]);
+	nkeys = mnemo_get64(&map[24]);
+	max = mnemo_get64(&map[32]);
+	bits = mnemo_get64(&map[64]);
+	memcpy(&error, &bits, sizeof(error));
+	nblocks = mnemo_get64(&map[72]);
+	size = mnemo_get64(&map[80]);
+	if ((version & 0xffffffff) != MNEMO_CHECKPOINT_VERSION ||
+	    (engine != MNEMO_REUSE_SPLAY && engine != MNEMO_REUSE_FENWICK &&
+	     engine != MNEMO_REUSE_APPROX) ||
+	    (engine == MNEMO_REUSE_APPROX && !(error > 0.0 && error < 1.0)) ||
+	    /* the list of blocks only doubles when more than half full */
+	    (engine == MNEMO_REUSE_APPROX && (size < MNEMO_REUSE_APPROX_BLOCKS ||
+					       (size & (size - 1)) ||
+					       nblocks > size ||
+					       (size > MNEMO_REUSE_APPROX_BLOCKS &&
+						size > 2 * now))) ||
+	    (engine != MNEMO_REUSE_APPROX && (nblocks != 0 || size != 0)) ||
+	    nkeys > (mapsize - MNEMO_CHECKPOINT_HEADER) / 16 ||
+	    nblocks > (mapsize - MNEMO_CHECKPOINT_HEADER) / 16 ||
+	    mapsize != MNEMO_CHECKPOINT_HEADER + 16 * (nkeys + nblocks))
+		goto err_invalid;
+
+	/* the manager is sized for the keys of the checkpoint */
+	ret = reusedm_init(max > nkeys ? max : nkeys, engine, error);
+	ret->max = max;
+	ret->now = now;
+	ret->threshold0 = mnemo_get64(&map[40]);
+	ret->threshold = mnemo_get64(&map[48]);
+	ret->rate = reusedm_sample_rate(ret->threshold);
+	ret->smax = mnemo_get64(&map[56]);
+	if (reusedm_restore(ret, (const uint64_t *)&map[MNEMO_CHECKPOINT_HEADER],
+			    nkeys,
+			    (const uint64_t *)&map[MNEMO_CHECKPOINT_HEADER +
+						   16 * nkeys],
+			    (const uint64_t *)&map[MNEMO_CHECKPOINT_HEADER +
+						   16 * nkeys + 8 * nblocks],
+			    nblocks, size) != 0)
+		goto err_invalid;
+	munmap((void *)map, mapsize);
+	return ret;
+err_invalid:
+	if (ret != NULL)
+		mnemo_reusedm_fini(ret);
+	munmap((void *)map, mapsize);
+	errno = EINVAL;
+	return NULL;
+}
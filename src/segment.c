@@ -0,0 +1,322 @@
+#include "config.h"
+
+#include <mnemo.h>
+
+#include <internal/endian.h>
+#include <internal/histogram.h>
+#include <internal/mapfile.h>
+
+/* number of keys whose distances are buffered at once */
+#define MNEMO_SEGMENT_CHUNK (1 << 16)
+
+/* Segment files:
+ * - a header: the magic string, the version of the format and the scale of the
+ *   histogram, its number of bins and their width, the number of accesses,
+ *   the cold misses as a double, and the number of first and of last
+ *   accesses, all little-endian.
+ * - the bins of the histogram, as doubles.
+ * - the keys by order of first access, then by order of last access.
+ */
+#define MNEMO_SEGMENT_MAGIC "MNEMOSEG"
+#define MNEMO_SEGMENT_VERSION 1
+#define MNEMO_SEGMENT_HEADER 64
+
+/* the summary of a segment of a trace:
+ * - an exact reuse distance manager, whose LRU stack holds the keys by order
+ *   of last access, and the histogram attached to it
+ * - the keys by order of first access
+ * - the number of accesses
+ * - a buffer for the distances of a chunk of keys.
+ */
+struct mnemo_segment {
+	struct mnemo_reusedm *reuse;
+	struct mnemo_histogram *hist;
+	unsigned long long *firsts;
+	size_t nfirsts, maxfirsts;
+	unsigned long long accesses;
+	int64_t *dist;
+};
+
+static void segment_first(struct mnemo_segment *s, unsigned long long key)
+{
+	if (s->nfirsts == s->maxfirsts) {
+		s->maxfirsts = s->maxfirsts ? 2 * s->maxfirsts :
+			MNEMO_SEGMENT_CHUNK;
+		s->firsts = realloc(s->firsts,
+				    s->maxfirsts * sizeof(*s->firsts));
+		assert(s->firsts != NULL);
+	}
+	s->firsts[s->nfirsts++] = key;
+}
+
+struct mnemo_segment *mnemo_segment_init(size_t max,
+					 enum mnemo_histogram_scale scale,
+					 size_t nbins,
+					 unsigned long long width)
+{
+	struct mnemo_segment *ret;
+
+	ret = calloc(1, sizeof(struct mnemo_segment));
+	assert(ret != NULL);
+	ret->reuse = mnemo_reusedm_init_engine(max, MNEMO_REUSE_FENWICK);
+	ret->hist = mnemo_histogram_init(scale, nbins, width);
+	mnemo_reusedm_attach(ret->reuse, ret->hist);
+	ret->dist = malloc(MNEMO_SEGMENT_CHUNK * sizeof(*ret->dist));
+	assert(ret->dist != NULL);
+	return ret;
+}
+
+void mnemo_segment_add_batch(struct mnemo_segment *s,
+			     const unsigned long long *keys, size_t n)
+{
+	assert(s != NULL);
+	assert(n == 0 || keys != NULL);
+	for (size_t i = 0; i < n; i += MNEMO_SEGMENT_CHUNK) {
+		size_t len = n - i < MNEMO_SEGMENT_CHUNK ?
+			n - i : MNEMO_SEGMENT_CHUNK;
+
+		mnemo_reusedm_add_batch(s->reuse, &keys[i], len, s->dist);
+		for (size_t j = 0; j < len; j++)
+			if (s->dist[j] == -1)
+				segment_first(s, keys[i + j]);
+	}
+	s->accesses += n;
+}
+
+int mnemo_segment_from_trace(struct mnemo_segment *s, struct mnemo_trace *t,
+			     size_t block, size_t nblocks)
+{
+	unsigned long long *buf;
+	int err = 0;
+
+	assert(s != NULL && t != NULL);
+	assert(block <= mnemo_trace_nblocks(t));
+	if (nblocks > mnemo_trace_nblocks(t) - block)
+		nblocks = mnemo_trace_nblocks(t) - block;
+	if (nblocks == 0)
+		return 0;
+	/* blocks are all the same size, but the last one */
+	buf = malloc(mnemo_trace_block_length(t, block) * sizeof(*buf));
+	assert(buf != NULL);
+	for (size_t b = block; b < block + nblocks; b++) {
+		err = mnemo_trace_decode(t, b, buf);
+		if (err != 0)
+			break;
+		mnemo_segment_add_batch(s, buf, mnemo_trace_block_length(t, b));
+	}
+	free(buf);
+	return err;
+}
+
+const struct mnemo_histogram *
+mnemo_segment_histogram(const struct mnemo_segment *s)
+{
+	assert(s != NULL);
+	return s->hist;
+}
+
+unsigned long long mnemo_segment_accesses(const struct mnemo_segment *s)
+{
+	assert(s != NULL);
+	return s->accesses;
+}
+
+size_t mnemo_segment_nkeys(const struct mnemo_segment *s)
+{
+	assert(s != NULL);
+	return s->nfirsts;
+}
+
+void mnemo_segment_merge(struct mnemo_segment *a, struct mnemo_segment *b)
+{
+	struct mnemo_histogram *ha, *hb;
+	unsigned long long *lasts;
+	size_t nlasts;
+	double resolved = 0.0;
+
+	assert(a != NULL && b != NULL && a != b);
+	ha = a->hist;
+	hb = b->hist;
+	assert(ha->scale == hb->scale && ha->nbins == hb->nbins &&
+	       ha->width == hb->width);
+	nlasts = mnemo_reusedm_nkeys(b->reuse);
+	lasts = malloc((nlasts + 1) * sizeof(*lasts));
+	assert(lasts != NULL);
+	mnemo_reusedm_stack(b->reuse, lasts);
+
+	/* The first accesses of the later segment, in order, find the keys of
+	 * the earlier one at their true distance, see
+	 * mnemo_reusedm_add_parallel. They were counted as cold misses in the
+	 * later segment, and only stay so for the keys new to both.
+	 */
+	mnemo_reusedm_attach(a->reuse, NULL);
+	for (size_t i = 0; i < b->nfirsts; i += MNEMO_SEGMENT_CHUNK) {
+		size_t len = b->nfirsts - i < MNEMO_SEGMENT_CHUNK ?
+			b->nfirsts - i : MNEMO_SEGMENT_CHUNK;
+
+		mnemo_reusedm_add_batch(a->reuse, &b->firsts[i], len, a->dist);
+		for (size_t j = 0; j < len; j++) {
+			if (a->dist[j] == -1) {
+				segment_first(a, b->firsts[i + j]);
+				continue;
+			}
+			mnemo_histogram_count(ha, a->dist[j], 1.0);
+			resolved += 1.0;
+		}
+	}
+	/* touching the keys by order of last access then gives the stack at
+	 * the end of the later segment.
+	 */
+	mnemo_reusedm_add_batch(a->reuse, lasts, nlasts, NULL);
+	mnemo_reusedm_attach(a->reuse, ha);
+	free(lasts);
+
+	for (size_t i = 0; i < ha->nbins; i++)
+		ha->bins[i] += hb->bins[i];
+	ha->cold += hb->cold - resolved;
+	a->accesses += b->accesses;
+}
+
+int mnemo_segment_save(struct mnemo_segment *s, const char *path)
+{
+	unsigned char header[MNEMO_SEGMENT_HEADER] = { 0 };
+	unsigned long long *lasts;
+	size_t nlasts;
+	uint64_t bits;
+	FILE *f;
+	int err = 0;
+
+	assert(s != NULL && path != NULL);
+	nlasts = mnemo_reusedm_nkeys(s->reuse);
+	lasts = malloc((nlasts + 1) * sizeof(*lasts));
+	assert(lasts != NULL);
+	mnemo_reusedm_stack(s->reuse, lasts);
+
+	memcpy(header, MNEMO_SEGMENT_MAGIC, strlen(MNEMO_SEGMENT_MAGIC));
+	mnemo_put64(&header[8], MNEMO_SEGMENT_VERSION |
+		    (uint64_t)s->hist->scale << 32);
+	mnemo_put64(&header[16], s->hist->nbins);
+	mnemo_put64(&header[24], s->hist->width);
+	mnemo_put64(&header[32], s->accesses);
+	memcpy(&bits, &s->hist->cold, sizeof(bits));
+	mnemo_put64(&header[40], bits);
+	mnemo_put64(&header[48], s->nfirsts);
+	mnemo_put64(&header[56], nlasts);
+
+	f = fopen(path, "wb");
+	if (f == NULL) {
+		err = -errno;
+		goto out;
+	}
+	if (fwrite(header, sizeof(header), 1, f) != 1)
+		err = -errno;
+	for (size_t i = 0; err == 0 && i < s->hist->nbins; i++) {
+		unsigned char word[8];
+
+		memcpy(&bits, &s->hist->bins[i], sizeof(bits));
+		mnemo_put64(word, bits);
+		if (fwrite(word, sizeof(word), 1, f) != 1)
+			err = -errno;
+	}
+	for (size_t i = 0; err == 0 && i < s->nfirsts + nlasts; i++) {
+		unsigned char word[8];
+
+		mnemo_put64(word, i < s->nfirsts ? s->firsts[i] :
+			    lasts[i - s->nfirsts]);
+		if (fwrite(word, sizeof(word), 1, f) != 1)
+			err = -errno;
+	}
+	if (fclose(f) != 0 && err == 0)
+		err = -errno;
+out:
+	free(lasts);
+	return err;
+}
+
+struct mnemo_segment *mnemo_segment_load(const char *path)
+{
+	struct mnemo_segment *ret;
+	const unsigned char *map;
+	const uint64_t *words;
+	uint64_t version, nbins, nfirsts, nlasts, bits;
+	enum mnemo_histogram_scale scale;
+	size_t size;
+
+	assert(path != NULL);
+	map = mnemo_mapfile(path, MNEMO_SEGMENT_MAGIC, MNEMO_SEGMENT_HEADER,
+			    &size);
+	if (map == NULL)
+		return NULL;
+	version = mnemo_get64(&map[8]);
+	scale = version >> 32;
+	nbins = mnemo_get64(&map[16]);
+	nfirsts = mnemo_get64(&map[48]);
+	nlasts = mnemo_get64(&map[56]);
+	if ((version & 0xffffffff) != MNEMO_SEGMENT_VERSION ||
+	    (scale != MNEMO_HISTOGRAM_LOG2 && scale != MNEMO_HISTOGRAM_LINEAR) ||
+	    nbins == 0 || (scale == MNEMO_HISTOGRAM_LOG2 && nbins > 65) ||
+	    (scale == MNEMO_HISTOGRAM_LINEAR && mnemo_get64(&map[24]) == 0) ||
+	    nfirsts != nlasts ||
+	    nbins > (size - MNEMO_SEGMENT_HEADER) / 8 ||
+	    nfirsts > (size - MNEMO_SEGMENT_HEADER) / 16 ||
+	    size != MNEMO_SEGMENT_HEADER + 8 * (nbins + nfirsts + nlasts)) {
+		munmap((void *)map, size);
+		errno = EINVAL;
+		return NULL;
+	}
+
+	ret = mnemo_segment_init(nfirsts, scale, nbins, mnemo_get64(&map[24]));
+	words = (const uint64_t *)&map[MNEMO_SEGMENT_HEADER];
+	/* the stack of the manager is rebuilt from the last accesses, without
+	 * counting them.
+	 */
+	mnemo_reusedm_attach(ret->reuse, NULL);
+	for (size_t i = 0; i < nlasts; i += 256) {
+		size_t len = nlasts - i < 256 ? nlasts - i : 256;
+		unsigned long long keys[256];
+
+		for (size_t j = 0; j < len; j++)
+			keys[j] = mnemo_le64(words[nbins + nfirsts + i + j]);
+		mnemo_reusedm_add_batch(ret->reuse, keys, len, ret->dist);
+		/* every key is last accessed once */
+		for (size_t j = 0; j < len; j++)
+			if (ret->dist[j] != -1)
+				goto err_invalid;
+	}
+	mnemo_reusedm_attach(ret->reuse, ret->hist);
+	for (size_t i = 0; i < nfirsts; i++)
+		segment_first(ret, mnemo_le64(words[nbins + i]));
+	for (size_t i = 0; i < nbins; i++) {
+		bits = mnemo_le64(words[i]);
+		memcpy(&ret->hist->bins[i], &bits, sizeof(bits));
+	}
+	bits = mnemo_get64(&map[40]);
+	memcpy(&ret->hist->cold, &bits, sizeof(bits));
+	ret->accesses = mnemo_get64(&map[32]);
+	munmap((void *)map, size);
+	return ret;
+err_invalid:
+	mnemo_segment_fini(ret);
+	munmap((void *)map, size);
+	errno = EINVAL;
+	return NULL;
+}
+
+void mnemo_segment_reset(struct mnemo_segment *s)
+{
+	assert(s != NULL);
+	mnemo_reusedm_reset(s->reuse);
+	mnemo_histogram_reset(s->hist);
+	s->nfirsts = 0;
+	s->accesses = 0;
+}
+
+void mnemo_segment_fini(struct mnemo_segment *s)
+{
+	assert(s != NULL);
+	mnemo_reusedm_fini(s->reuse);
+	mnemo_histogram_fini(s->hist);
+	free(s->firsts);
+	free(s->dist);
+	free(s);
+}
@@ -0,0 +1,70 @@
+#include "config.h"
+
+#include <mnemo.h>
+
+#include <internal/series.h>
+
+struct mnemo_series *mnemo_series_init(void)
+{
+	struct mnemo_series *ret;
+
+	ret = calloc(1, sizeof(struct mnemo_series));
+	assert(ret != NULL);
+	return ret;
+}
+
+size_t mnemo_series_count(const struct mnemo_series *s)
+{
+	assert(s != NULL);
+	return s->n;
+}
+
+size_t mnemo_series_nbins(const struct mnemo_series *s)
+{
+	assert(s != NULL);
+	return s->nbins;
+}
+
+const double *mnemo_series_bins(const struct mnemo_series *s, size_t i)
+{
+	assert(s != NULL);
+	assert(i < s->n);
+	return &s->bins[i * s->nbins];
+}
+
+double mnemo_series_cold(const struct mnemo_series *s, size_t i)
+{
+	assert(s != NULL);
+	assert(i < s->n);
+	return s->cold[i];
+}
+
+unsigned long long mnemo_series_start(const struct mnemo_series *s, size_t i)
+{
+	assert(s != NULL);
+	assert(i < s->n);
+	return s->starts[i];
+}
+
+unsigned long long mnemo_series_length(const struct mnemo_series *s, size_t i)
+{
+	assert(s != NULL);
+	assert(i < s->n);
+	return s->lengths[i];
+}
+
+void mnemo_series_reset(struct mnemo_series *s)
+{
+	assert(s != NULL);
+	s->n = 0;
+}
+
+void mnemo_series_fini(struct mnemo_series *s)
+{
+	assert(s != NULL);
+	free(s->bins);
+	free(s->cold);
+	free(s->starts);
+	free(s->lengths);
+	free(s);
+}
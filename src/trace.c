@@ -0,0 +1,431 @@
+#include "config.h"
+
+#include <mnemo.h>
+
+#include <internal/codec.h>
+#include <internal/endian.h>
+
+#include <fcntl.h>
+#include <sys/stat.h>
+
+/* number of keys handed to the batch loop at once, and of a block of a raw
+ * trace. Input pages are dropped once their window is done, which bounds the
+ * resident memory of huge traces.
+ */
+#define MNEMO_TRACE_WINDOW (1 << 20)
+
+/* Compressed traces:
+ * - a header: the magic string, the version of the format, the number of keys
+ *   per block, the number of keys and of blocks, and the offset of the index,
+ *   all little-endian.
+ * - blocks encoded with the block codec, each of blocksize keys but the last.
+ * - the index: the offset of each block, then the offset of the index itself.
+ */
+#define MNEMO_TRACE_MAGIC "MNEMOTRC"
+#define MNEMO_TRACE_VERSION 1
+#define MNEMO_TRACE_HEADER 40
+
+/* default number of keys per block of a compressed trace */
+#define MNEMO_TRACE_BLOCK 65536
+
+/* a trace file mapped in memory:
+ * - the mapping
+ * - the keys of a raw trace, little-endian, NULL for a compressed one
+ * - the number of keys, of keys per block and of blocks
+ * - the index of a compressed trace.
+ */
+struct mnemo_trace {
+	const unsigned char *map;
+	size_t size;
+	const uint64_t *keys;
+	size_t n;
+	size_t blocksize;
+	size_t nblocks;
+	const unsigned char *index;
+};
+
+/* a compressed trace being written:
+ * - the file, and the current offset in it
+ * - the keys of the current block, and a buffer to encode it
+ * - the offsets of the blocks written so far
+ * - the total number of keys.
+ */
+struct mnemo_trace_writer {
+	FILE *f;
+	uint64_t offset;
+	size_t blocksize;
+	unsigned long long *keys;
+	size_t n;
+	unsigned char *buf;
+	uint64_t *offsets;
+	size_t nblocks, maxblocks;
+	uint64_t nkeys;
+};
+
+static uint64_t trace_offset(const struct mnemo_trace *t, size_t block)
+{
+	return mnemo_get64(&t->index[block * 8]);
+}
+
+/* parse the header of a compressed trace, return 0 if valid. */
+static int trace_parse(struct mnemo_trace *t)
+{
+	const unsigned char *h = t->map;
+	uint64_t nkeys, nblocks, index;
+
+	/* the version, then the number of keys per block */
+	if ((mnemo_get64(&h[8]) & 0xffffffff) != MNEMO_TRACE_VERSION)
+		return -1;
+	t->blocksize = mnemo_get64(&h[8]) >> 32;
+	nkeys = mnemo_get64(&h[16]);
+	nblocks = mnemo_get64(&h[24]);
+	index = mnemo_get64(&h[32]);
+	if (t->blocksize == 0 || index < MNEMO_TRACE_HEADER ||
+	    index > t->size || (t->size - index) % 8)
+		return -1;
+	/* the index holds an offset per block and its own, and every block but
+	 * the last one is full. Both are checked without overflows, whatever
+	 * the header says.
+	 */
+	if (nblocks >= (t->size - index) / 8 ||
+	    (t->size - index) / 8 != nblocks + 1 ||
+	    nblocks != nkeys / t->blocksize + (nkeys % t->blocksize != 0))
+		return -1;
+	t->n = nkeys;
+	t->nblocks = nblocks;
+	t->index = t->map + index;
+	t->keys = NULL;
+	return 0;
+}
+
+struct mnemo_trace *mnemo_trace_open(const char *path)
+{
+	struct mnemo_trace *ret;
+	struct stat st;
+	void *map = NULL;
+	int fd, err;
+
+	assert(path != NULL);
+	fd = open(path, O_RDONLY);
+	if (fd == -1)
+		return NULL;
+	if (fstat(fd, &st) == -1)
+		goto err_close;
+	if (st.st_size > 0) {
+		map = mmap(NULL, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+		if (map == MAP_FAILED)
+			goto err_close;
+		madvise(map, st.st_size, MADV_SEQUENTIAL);
+	}
+	/* the mapping keeps the file open */
+	close(fd);
+	ret = calloc(1, sizeof(struct mnemo_trace));
+	assert(ret != NULL);
+	ret->map = map;
+	ret->size = st.st_size;
+	if (ret->size >= MNEMO_TRACE_HEADER &&
+	    !memcmp(map, MNEMO_TRACE_MAGIC, strlen(MNEMO_TRACE_MAGIC))) {
+		if (trace_parse(ret) == 0)
+			return ret;
+	} else if (ret->size % sizeof(uint64_t) == 0) {
+		ret->keys = map;
+		ret->n = ret->size / sizeof(uint64_t);
+		ret->blocksize = MNEMO_TRACE_WINDOW;
+		ret->nblocks = (ret->n + MNEMO_TRACE_WINDOW - 1) /
+			MNEMO_TRACE_WINDOW;
+		return ret;
+	}
+	mnemo_trace_close(ret);
+	errno = EINVAL;
+	return NULL;
+err_close:
+	err = errno;
+	close(fd);
+	errno = err;
+	return NULL;
+}
+
+size_t mnemo_trace_length(const struct mnemo_trace *t)
+{
+	assert(t != NULL);
+	return t->n;
+}
+
+size_t mnemo_trace_nblocks(const struct mnemo_trace *t)
+{
+	assert(t != NULL);
+	return t->nblocks;
+}
+
+size_t mnemo_trace_block_length(const struct mnemo_trace *t, size_t block)
+{
+	assert(t != NULL);
+	assert(block < t->nblocks);
+	if (block + 1 < t->nblocks)
+		return t->blocksize;
+	return t->n - block * t->blocksize;
+}
+
+int mnemo_trace_decode(const struct mnemo_trace *t, size_t block,
+		       unsigned long long *keys)
+{
+	size_t n = mnemo_trace_block_length(t, block);
+	uint64_t start, end;
+
+	if (t->keys != NULL) {
+		const uint64_t *src = &t->keys[block * t->blocksize];
+
+		for (size_t i = 0; i < n; i++)
+#ifdef MNEMO_BIG_ENDIAN
+			keys[i] = __builtin_bswap64(src[i]);
+#else
+			keys[i] = src[i];
+#endif
+		return 0;
+	}
+	start = trace_offset(t, block);
+	end = trace_offset(t, block + 1);
+	if (start < MNEMO_TRACE_HEADER || start > end ||
+	    end > (uint64_t)(t->index - t->map))
+		return -EINVAL;
+	if (mnemo_codec_decode(t->map + start, end - start, keys, n) != 0)
+		return -EINVAL;
+	return 0;
+}
+
+void mnemo_trace_close(struct mnemo_trace *t)
+{
+	assert(t != NULL);
+	if (t->size > 0)
+		munmap((void *)t->map, t->size);
+	free(t);
+}
+
+/* map an output file of n distances. The blocks of the file are allocated
+ * upfront: a full disk fails here, instead of raising SIGBUS on a store to the
+ * mapping.
+ */
+static int64_t *trace_output_map(const char *path, size_t n, size_t *size)
+{
+	void *map;
+	int fd, err;
+
+	fd = open(path, O_RDWR | O_CREAT | O_TRUNC, 0644);
+	if (fd == -1)
+		return NULL;
+	*size = n * sizeof(int64_t);
+	err = posix_fallocate(fd, 0, *size);
+	if (err != 0) {
+		close(fd);
+		errno = err;
+		return NULL;
+	}
+	map = mmap(NULL, *size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+	if (map == MAP_FAILED)
+		goto err_close;
+	madvise(map, *size, MADV_SEQUENTIAL);
+	close(fd);
+	return map;
+err_close:
+	err = errno;
+	close(fd);
+	errno = err;
+	return NULL;
+}
+
+int mnemo_reuse_from_trace(struct mnemo_reusedm *r, struct mnemo_trace *t,
+			   const char *output)
+{
+	int64_t *out = NULL;
+	size_t outsize = 0;
+	unsigned long long *buf = NULL;
+	int err = 0;
+
+	assert(r != NULL && t != NULL);
+	if (t->n == 0) {
+		/* nothing to map, the output is just an empty file */
+		int fd;
+
+		if (output == NULL)
+			return 0;
+		fd = open(output, O_WRONLY | O_CREAT | O_TRUNC, 0644);
+		if (fd == -1)
+			return -errno;
+		close(fd);
+		return 0;
+	}
+	if (output != NULL) {
+		out = trace_output_map(output, t->n, &outsize);
+		if (out == NULL)
+			return -errno;
+	}
+#ifndef MNEMO_BIG_ENDIAN
+	/* uint64_t and unsigned long long have the same representation, the
+	 * keys of a raw trace go straight from the page cache to the batch
+	 * loop.
+	 */
+	if (t->keys == NULL) {
+#endif
+		/* blocks are decoded one at a time, in a buffer that stays in
+		 * cache.
+		 */
+		buf = malloc(t->blocksize * sizeof(*buf));
+		assert(buf != NULL);
+#ifndef MNEMO_BIG_ENDIAN
+	}
+#endif
+	for (size_t b = 0; b < t->nblocks; b++) {
+		size_t n = mnemo_trace_block_length(t, b);
+		size_t i = b * t->blocksize;
+		const unsigned long long *keys;
+		int64_t *o = out != NULL ? &out[i] : NULL;
+
+		if (buf != NULL) {
+			err = mnemo_trace_decode(t, b, buf);
+			if (err != 0)
+				break;
+			keys = buf;
+		} else {
+			keys = (const unsigned long long *)&t->keys[i];
+		}
+		mnemo_reusedm_add_batch(r, keys, n, o);
+#ifdef MNEMO_BIG_ENDIAN
+		for (size_t j = 0; o != NULL && j < n; j++)
+			o[j] = __builtin_bswap64(o[j]);
+#endif
+		/* drop the window from the mapping, it won't be read again */
+		if (t->keys != NULL)
+			madvise((void *)&t->keys[i], n * sizeof(uint64_t),
+				MADV_DONTNEED);
+	}
+	free(buf);
+	if (out != NULL)
+		munmap(out, outsize);
+	return err;
+}
+
+struct mnemo_trace_writer *mnemo_trace_writer_open(const char *path,
+						   size_t blocksize)
+{
+	struct mnemo_trace_writer *ret;
+	unsigned char header[MNEMO_TRACE_HEADER] = { 0 };
+	FILE *f;
+
+	assert(path != NULL);
+	/* the header holds the size of the blocks on 32 bits */
+	if (blocksize > UINT32_MAX) {
+		errno = EINVAL;
+		return NULL;
+	}
+	f = fopen(path, "wb");
+	if (f == NULL)
+		return NULL;
+	/* the header is only known at the end */
+	if (fwrite(header, sizeof(header), 1, f) != 1) {
+		int err = errno;
+
+		fclose(f);
+		errno = err;
+		return NULL;
+	}
+	ret = calloc(1, sizeof(struct mnemo_trace_writer));
+	assert(ret != NULL);
+	ret->f = f;
+	ret->offset = MNEMO_TRACE_HEADER;
+	ret->blocksize = blocksize != 0 ? blocksize : MNEMO_TRACE_BLOCK;
+	ret->keys = malloc(ret->blocksize * sizeof(*ret->keys));
+	ret->buf = malloc(MNEMO_CODEC_BOUND(ret->blocksize));
+	assert(ret->keys != NULL && ret->buf != NULL);
+	ret->n = 0;
+	ret->offsets = NULL;
+	ret->nblocks = ret->maxblocks = 0;
+	ret->nkeys = 0;
+	return ret;
+}
+
+/* record the offset of the next block or of the index. */
+static void trace_writer_mark(struct mnemo_trace_writer *w)
+{
+	if (w->nblocks == w->maxblocks) {
+		w->maxblocks = w->maxblocks ? 2 * w->maxblocks : 64;
+		w->offsets = realloc(w->offsets,
+				     w->maxblocks * sizeof(*w->offsets));
+		assert(w->offsets != NULL);
+	}
+	w->offsets[w->nblocks++] = w->offset;
+}
+
+/* encode and write the current block. */
+static int trace_writer_flush(struct mnemo_trace_writer *w)
+{
+	size_t size;
+
+	if (w->n == 0)
+		return 0;
+	trace_writer_mark(w);
+	size = mnemo_codec_encode(w->keys, w->n, w->buf);
+	if (fwrite(w->buf, size, 1, w->f) != 1)
+		return -errno;
+	w->offset += size;
+	w->nkeys += w->n;
+	w->n = 0;
+	return 0;
+}
+
+int mnemo_trace_writer_add(struct mnemo_trace_writer *w,
+			   const unsigned long long *keys, size_t n)
+{
+	assert(w != NULL);
+	assert(n == 0 || keys != NULL);
+	while (n > 0) {
+		size_t len = w->blocksize - w->n;
+		int err;
+
+		if (len > n)
+			len = n;
+		memcpy(&w->keys[w->n], keys, len * sizeof(*keys));
+		w->n += len;
+		keys += len;
+		n -= len;
+		if (w->n == w->blocksize) {
+			err = trace_writer_flush(w);
+			if (err != 0)
+				return err;
+		}
+	}
+	return 0;
+}
+
+int mnemo_trace_writer_close(struct mnemo_trace_writer *w)
+{
+	unsigned char header[MNEMO_TRACE_HEADER], entry[8];
+	size_t nblocks;
+	int err;
+
+	assert(w != NULL);
+	err = trace_writer_flush(w);
+	/* the last offset is the one of the index */
+	nblocks = w->nblocks;
+	trace_writer_mark(w);
+	for (size_t i = 0; err == 0 && i <= nblocks; i++) {
+		mnemo_put64(entry, w->offsets[i]);
+		if (fwrite(entry, sizeof(entry), 1, w->f) != 1)
+			err = -errno;
+	}
+	memcpy(header, MNEMO_TRACE_MAGIC, strlen(MNEMO_TRACE_MAGIC));
+	mnemo_put64(&header[8],
+		    MNEMO_TRACE_VERSION | (uint64_t)w->blocksize << 32);
+	mnemo_put64(&header[16], w->nkeys);
+	mnemo_put64(&header[24], nblocks);
+	mnemo_put64(&header[32], w->offset);
+	if (err == 0 && (fseek(w->f, 0, SEEK_SET) != 0 ||
+			 fwrite(header, sizeof(header), 1, w->f) != 1))
+		err = -errno;
+	if (fclose(w->f) != 0 && err == 0)
+		err = -errno;
+	free(w->keys);
+	free(w->buf);
+	free(w->offsets);
+	free(w);
+	return err;
+}
@@ -0,0 +1,111 @@
+#include "reference.h"
+
+/* Check the asynchronous front end: the histogram of the keys pushed through
+ * the ring must be the one of mnemo_reusedm_add_batch once flushed, and once
+ * the front end is freed. Rings are small, so that they wrap around and fill
+ * up often. With the drop policy, the histogram is the one of the accepted
+ * keys, and the front end reports exactly the pushes that were rejected.
+ */
+
+#define N 200000
+
+#define NBINS 64
+
+static void check_histogram(const struct mnemo_histogram *h,
+			    const struct mnemo_histogram *ref)
+{
+	check(mnemo_histogram_cold(h) == mnemo_histogram_cold(ref));
+	for (size_t b = 0; b < NBINS; b++)
+		check(mnemo_histogram_bins(h)[b] ==
+		      mnemo_histogram_bins(ref)[b]);
+}
+
+static struct mnemo_reusedm *init(struct mnemo_histogram **h)
+{
+	struct mnemo_reusedm *ret = mnemo_reusedm_init(0);
+
+	*h = mnemo_histogram_init(MNEMO_HISTOGRAM_LOG2, NBINS, 0);
+	mnemo_reusedm_attach(ret, *h);
+	return ret;
+}
+
+static void check_block(const unsigned long long *keys, size_t capacity)
+{
+	struct mnemo_reusedm *r, *ref;
+	struct mnemo_histogram *h, *href;
+	struct mnemo_reuse_async *a;
+
+	r = init(&h);
+	ref = init(&href);
+	a = mnemo_reuse_async_init(r, capacity, MNEMO_ASYNC_BLOCK);
+	/* flushes in the middle of groups of published keys */
+	for (size_t i = 0, len = 1; i < N; i += len, len = 2 * len + 1) {
+		if (len > N - i)
+			len = N - i;
+		for (size_t j = i; j < i + len; j++)
+			check(mnemo_reuse_async_push(a, keys[j]) == 0);
+		mnemo_reuse_async_flush(a);
+		mnemo_reusedm_add_batch(ref, &keys[i], len, NULL);
+		check_histogram(h, href);
+	}
+	mnemo_reuse_async_flush(a);
+	check_histogram(h, href);
+
+	/* keys left in the ring are added by fini */
+	for (size_t i = 0; i < N / 3; i++)
+		check(mnemo_reuse_async_push(a, keys[i]) == 0);
+	check(mnemo_reuse_async_dropped(a) == 0);
+	mnemo_reuse_async_fini(a);
+	mnemo_reusedm_add_batch(ref, keys, N / 3, NULL);
+	check_histogram(h, href);
+	check(mnemo_reusedm_nkeys(r) == mnemo_reusedm_nkeys(ref));
+	mnemo_reusedm_fini(r);
+	mnemo_reusedm_fini(ref);
+	mnemo_histogram_fini(h);
+	mnemo_histogram_fini(href);
+}
+
+static void check_drop(const unsigned long long *keys, size_t capacity)
+{
+	struct mnemo_reusedm *r, *ref;
+	struct mnemo_histogram *h, *href;
+	struct mnemo_reuse_async *a;
+	unsigned long long rejected = 0;
+
+	r = init(&h);
+	ref = init(&href);
+	a = mnemo_reuse_async_init(r, capacity, MNEMO_ASYNC_DROP);
+	for (size_t i = 0; i < N; i++) {
+		int err = mnemo_reuse_async_push(a, keys[i]);
+
+		check(err == 0 || err == -EAGAIN);
+		if (err == 0)
+			mnemo_reusedm_add(ref, keys[i]);
+		else
+			rejected++;
+		check(mnemo_reuse_async_dropped(a) == rejected);
+	}
+	/* the analysis thread adds keys far slower than they are pushed */
+	check(rejected > 0);
+	mnemo_reuse_async_flush(a);
+	check_histogram(h, href);
+	mnemo_reuse_async_fini(a);
+	check_histogram(h, href);
+	mnemo_reusedm_fini(r);
+	mnemo_reusedm_fini(ref);
+	mnemo_histogram_fini(h);
+	mnemo_histogram_fini(href);
+}
+
+int main(void)
+{
+	unsigned long long *keys = ref_trace(N, 20000, 42);
+
+	check_block(keys, 0);
+	check_block(keys, 1000);
+	check_block(keys, 1 << 16);
+	check_drop(keys, 0);
+	check_drop(keys, 1000);
+	free(keys);
+	return EXIT_SUCCESS;
+}
@@ -0,0 +1,104 @@
+#include "reference.h"
+
+/* Check the cache simulator against the naive models of reference.h, access
+ * by access, for LRU and tree-PLRU caches. Random caches have no reference,
+ * but batches must match single accesses. A fully associative LRU cache must
+ * also miss exactly on the reuse distances at least as large as its number of
+ * lines.
+ */
+
+#define N 100000
+
+static const struct mnemo_cache_config configs[] = {
+	{ 32768, 8, 64, MNEMO_CACHE_LRU },
+	{ 32768, 8, 64, MNEMO_CACHE_PLRU },
+	{ 32768, 8, 64, MNEMO_CACHE_RANDOM },
+	{ 32768, 1, 64, MNEMO_CACHE_LRU },
+	{ 32768, 0, 64, MNEMO_CACHE_LRU },
+	{ 4096, 0, 64, MNEMO_CACHE_PLRU },
+	{ 1 << 20, 16, 128, MNEMO_CACHE_LRU },
+	{ 65536, 64, 64, MNEMO_CACHE_PLRU },
+	{ 65536, 2, 32, MNEMO_CACHE_PLRU },
+};
+
+#define NCONFIGS (sizeof(configs) / sizeof(configs[0]))
+
+/* index of the fully associative LRU cache of 512 lines */
+#define FULLY_ASSOCIATIVE 4
+
+int main(void)
+{
+	unsigned long long *addrs, *lines, state = 42;
+	unsigned long long misses[NCONFIGS] = { 0 };
+	struct mnemo_cache *c, *single;
+	unsigned char *out, one[NCONFIGS];
+	struct mnemo_reusedm *r;
+	int64_t *dist;
+
+	addrs = malloc(N * sizeof(*addrs));
+	out = malloc(NCONFIGS * N * sizeof(*out));
+	check(addrs != NULL && out != NULL);
+	/* random accesses within 128 KiB, and a sequential sweep of 1 MiB */
+	for (size_t i = 0; i < N; i++)
+		addrs[i] = ref_next(&state) % 3 ? ref_next(&state) % (1 << 17) :
+			i * 8 % (1 << 20);
+
+	/* batches of random sizes, against single accesses */
+	c = mnemo_cache_init(configs, NCONFIGS);
+	single = mnemo_cache_init(configs, NCONFIGS);
+	check(mnemo_cache_nconfigs(c) == NCONFIGS);
+	for (size_t i = 0, len; i < N; i += len) {
+		len = ref_next(&state) % 1000 + 1;
+		if (len > N - i)
+			len = N - i;
+		mnemo_cache_add_batch(c, &addrs[i], len, out);
+		for (size_t j = 0; j < len; j++) {
+			mnemo_cache_add(single, addrs[i + j], one);
+			for (size_t k = 0; k < NCONFIGS; k++) {
+				check(out[k * len + j] == one[k]);
+				misses[k] += one[k];
+			}
+		}
+	}
+	check(mnemo_cache_accesses(c) == N);
+	for (size_t k = 0; k < NCONFIGS; k++) {
+		check(mnemo_cache_misses(c, k) == misses[k]);
+		check(mnemo_cache_misses(single, k) == misses[k]);
+	}
+	mnemo_cache_fini(single);
+
+	/* the same trace after a reset, against the naive models */
+	mnemo_cache_reset(c);
+	check(mnemo_cache_accesses(c) == 0);
+	mnemo_cache_add_batch(c, addrs, N, out);
+	for (size_t k = 0; k < NCONFIGS; k++) {
+		struct ref_cache ref;
+
+		check(mnemo_cache_misses(c, k) == misses[k]);
+		if (configs[k].policy == MNEMO_CACHE_RANDOM)
+			continue;
+		ref_cache_init(&ref, &configs[k]);
+		for (size_t i = 0; i < N; i++)
+			check(out[k * N + i] == ref_cache_access(&ref, addrs[i]));
+		ref_cache_fini(&ref);
+	}
+
+	/* a fully associative LRU cache of 512 lines, against reuse distances */
+	lines = malloc(N * sizeof(*lines));
+	dist = malloc(N * sizeof(*dist));
+	check(lines != NULL && dist != NULL);
+	for (size_t i = 0; i < N; i++)
+		lines[i] = addrs[i] / 64;
+	r = mnemo_reusedm_init(0);
+	mnemo_reusedm_add_batch(r, lines, N, dist);
+	for (size_t i = 0; i < N; i++)
+		check(out[FULLY_ASSOCIATIVE * N + i] ==
+		      (dist[i] < 0 || dist[i] >= 512));
+	mnemo_reusedm_fini(r);
+	mnemo_cache_fini(c);
+	free(addrs);
+	free(lines);
+	free(dist);
+	free(out);
+	return EXIT_SUCCESS;
+}
@@ -0,0 +1,128 @@
+#include "reference.h"
+
+/* Check checkpoints of reuse distance managers: a manager loaded from the
+ * checkpoint of another one must hold the same LRU stack, and give the same
+ * distances to the rest of the trace, for all the engines and for sampling
+ * managers. Exact engines must also match an LRU stack over the whole trace.
+ * Malformed files must be rejected.
+ */
+
+#define N 100000
+
+#define PATH "checkpoint-test.ckp"
+
+static void check_round_trip(struct mnemo_reusedm *r,
+			     const unsigned long long *keys, const int64_t *ref)
+{
+	struct mnemo_reusedm *loaded;
+	unsigned long long *a, *b;
+	int64_t *out = malloc(N * sizeof(*out));
+	int64_t *lout = malloc(N * sizeof(*lout));
+	size_t nkeys;
+
+	check(out != NULL && lout != NULL);
+	mnemo_reusedm_add_batch(r, keys, N / 2, out);
+	check(mnemo_reusedm_save(r, PATH) == 0);
+	loaded = mnemo_reusedm_load(PATH);
+	check(loaded != NULL);
+
+	nkeys = mnemo_reusedm_nkeys(r);
+	check(mnemo_reusedm_nkeys(loaded) == nkeys);
+	check(mnemo_reusedm_rate(loaded) == mnemo_reusedm_rate(r));
+	a = malloc((nkeys + 1) * sizeof(*a));
+	b = malloc((nkeys + 1) * sizeof(*b));
+	check(a != NULL && b != NULL);
+	mnemo_reusedm_stack(r, a);
+	mnemo_reusedm_stack(loaded, b);
+	check(!memcmp(a, b, nkeys * sizeof(*a)));
+
+	mnemo_reusedm_add_batch(r, &keys[N / 2], N - N / 2, &out[N / 2]);
+	mnemo_reusedm_add_batch(loaded, &keys[N / 2], N - N / 2, &lout[N / 2]);
+	for (size_t i = N / 2; i < N; i++) {
+		check(lout[i] == out[i]);
+		check(ref == NULL || out[i] == ref[i]);
+	}
+	mnemo_reusedm_fini(r);
+	mnemo_reusedm_fini(loaded);
+	free(a);
+	free(b);
+	free(out);
+	free(lout);
+}
+
+/* overwrite a 64-bit word of a checkpoint */
+static void corrupt(long offset, uint64_t value)
+{
+	FILE *f = fopen(PATH, "r+b");
+
+	check(f != NULL);
+	check(fseek(f, offset, SEEK_SET) == 0);
+	check(fwrite(&value, sizeof(value), 1, f) == 1);
+	check(fclose(f) == 0);
+}
+
+static void check_rejected(void)
+{
+	struct mnemo_reusedm *r = mnemo_reusedm_init(0);
+
+	/* an empty manager is a valid checkpoint */
+	check(mnemo_reusedm_save(r, PATH) == 0);
+	mnemo_reusedm_fini(r);
+	r = mnemo_reusedm_load(PATH);
+	check(r != NULL && mnemo_reusedm_nkeys(r) == 0);
+	check(mnemo_reusedm_add(r, 5) == -1);
+	for (unsigned long long i = 0; i < 100; i++)
+		mnemo_reusedm_add(r, i % 37);
+	check(mnemo_reusedm_save(r, PATH) == 0);
+
+	/* the time of the fourth key, after the 88-byte header */
+	corrupt(88 + 16 * 3 + 8, 0);
+	errno = 0;
+	check(mnemo_reusedm_load(PATH) == NULL && errno == EINVAL);
+	check(mnemo_reusedm_save(r, PATH) == 0);
+	corrupt(0, 0);
+	errno = 0;
+	check(mnemo_reusedm_load(PATH) == NULL && errno == EINVAL);
+	check(mnemo_reusedm_save(r, PATH) == 0);
+	check(truncate(PATH, 90) == 0);
+	errno = 0;
+	check(mnemo_reusedm_load(PATH) == NULL && errno == EINVAL);
+	check(truncate(PATH, 10) == 0);
+	errno = 0;
+	check(mnemo_reusedm_load(PATH) == NULL && errno == EINVAL);
+	unlink(PATH);
+	errno = 0;
+	check(mnemo_reusedm_load(PATH) == NULL && errno == ENOENT);
+	check(mnemo_reusedm_save(r, "checkpoint-test.d/none") == -ENOENT);
+	mnemo_reusedm_fini(r);
+}
+
+int main(void)
+{
+	unsigned long long *keys = malloc(N * sizeof(*keys)), state = 42;
+	int64_t *ref;
+
+	check(keys != NULL);
+	/* the footprint grows in the second half of the trace */
+	for (size_t i = 0; i < N; i++)
+		keys[i] = ref_next(&state) % (i < N / 2 ? 3000 : 9000);
+	ref = ref_distances(keys, N);
+
+	check_round_trip(mnemo_reusedm_init_engine(0, MNEMO_REUSE_SPLAY), keys,
+			 ref);
+	check_round_trip(mnemo_reusedm_init_engine(100, MNEMO_REUSE_SPLAY),
+			 keys, ref);
+	check_round_trip(mnemo_reusedm_init_engine(0, MNEMO_REUSE_FENWICK),
+			 keys, ref);
+	check_round_trip(mnemo_reusedm_init_approx(0, 0.05), keys, NULL);
+	check_round_trip(mnemo_reusedm_init_sampled(0, MNEMO_REUSE_FENWICK,
+						    0.5, 0),
+			 keys, NULL);
+	check_round_trip(mnemo_reusedm_init_sampled(0, MNEMO_REUSE_SPLAY,
+						    1.0, 1000),
+			 keys, NULL);
+	check_rejected();
+	free(keys);
+	free(ref);
+	return EXIT_SUCCESS;
+}
@@ -0,0 +1,79 @@
+#include "reference.h"
+
+/* Check the reuse distance engines against an explicit LRU stack: the splay
+ * and Fenwick engines are exact, the approximate one is within its relative
+ * error bound, exact for small distances, and reports all cold misses.
+ */
+
+#define N 60000
+
+static const size_t footprints[] = { 1, 7, 300, 4000 };
+
+#define NFOOTPRINTS (sizeof(footprints) / sizeof(footprints[0]))
+
+static void check_exact(enum mnemo_reuse_engine engine, size_t max,
+			const unsigned long long *keys, const int64_t *ref)
+{
+	struct mnemo_reusedm *r;
+	int64_t *out = malloc(N * sizeof(*out));
+
+	check(out != NULL);
+	/* one key at a time */
+	r = mnemo_reusedm_init_engine(max, engine);
+	for (size_t i = 0; i < N; i++)
+		check(mnemo_reusedm_add64(r, keys[i]) == ref[i]);
+	mnemo_reusedm_fini(r);
+
+	/* in batches of varying size, and again after a reset */
+	r = mnemo_reusedm_init_engine(max, engine);
+	for (int pass = 0; pass < 2; pass++) {
+		for (size_t i = 0, len = 1; i < N; i += len, len = 2 * len + 1) {
+			if (len > N - i)
+				len = N - i;
+			mnemo_reusedm_add_batch(r, &keys[i], len, &out[i]);
+		}
+		for (size_t i = 0; i < N; i++)
+			check(out[i] == ref[i]);
+		mnemo_reusedm_reset(r);
+	}
+	mnemo_reusedm_fini(r);
+	free(out);
+}
+
+static void check_approx(double error, const unsigned long long *keys,
+			 const int64_t *ref)
+{
+	struct mnemo_reusedm *r;
+	int64_t *out = malloc(N * sizeof(*out));
+
+	check(out != NULL);
+	r = mnemo_reusedm_init_approx(0, error);
+	mnemo_reusedm_add_batch(r, keys, N, out);
+	for (size_t i = 0; i < N; i++) {
+		int64_t d = out[i] > ref[i] ? out[i] - ref[i] : ref[i] - out[i];
+
+		check((out[i] == -1) == (ref[i] == -1));
+		check(ref[i] == -1 || d <= error * ref[i]);
+		check(ref[i] >= 1 / (2 * error) || out[i] == ref[i]);
+	}
+	mnemo_reusedm_fini(r);
+	free(out);
+}
+
+int main(void)
+{
+	for (size_t f = 0; f < NFOOTPRINTS; f++) {
+		unsigned long long *keys = ref_trace(N, footprints[f], 42 + f);
+		int64_t *ref = ref_distances(keys, N);
+
+		check_exact(MNEMO_REUSE_SPLAY, 0, keys, ref);
+		check_exact(MNEMO_REUSE_SPLAY, footprints[f], keys, ref);
+		check_exact(MNEMO_REUSE_FENWICK, 0, keys, ref);
+		check_exact(MNEMO_REUSE_FENWICK, footprints[f], keys, ref);
+		check_approx(MNEMO_REUSE_APPROX_ERROR, keys, ref);
+		check_approx(0.2, keys, ref);
+		free(keys);
+		free(ref);
+	}
+	return EXIT_SUCCESS;
+}
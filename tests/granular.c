@@ -0,0 +1,124 @@
+#include "reference.h"
+
+/* Check the multi-granularity manager against independent managers, one per
+ * level, fed with all the addresses shifted by the shift of their level: the
+ * accesses it drops, consecutive ones to the same key of a level, must have a
+ * distance of 0 there, and removing them must not change the other distances
+ * nor the attached histograms. Sequential runs of addresses, which repeat the
+ * keys of coarse levels, straddle the chunks the manager splits batches in,
+ * and batches of all sizes are added, some of them a chunk long.
+ */
+
+/* MNEMO_GRAN_CHUNK, in src/granular.c */
+#define CHUNK (1 << 18)
+
+#define N (2 * CHUNK + 5000)
+
+/* the trace alternates between sequential runs and random accesses */
+#define RUN 1000
+
+#define NLEVELS 4
+#define NBINS 64
+
+static const unsigned int shifts[NLEVELS] = { 3, 6, 12, 16 };
+
+static unsigned long long *trace(void)
+{
+	unsigned long long *ret = ref_trace(N, 1 << 16, 42);
+
+	/* words of the runs, and lines of the rest */
+	for (size_t i = 0; i < N; i++)
+		ret[i] = i / RUN % 2 ? ret[i] << 6 | i % 64 : i * 8 % (1 << 24);
+	return ret;
+}
+
+static void check_histogram(const struct mnemo_histogram *h,
+			    const struct mnemo_histogram *ref)
+{
+	check(mnemo_histogram_cold(h) == mnemo_histogram_cold(ref));
+	for (size_t b = 0; b < NBINS; b++)
+		check(mnemo_histogram_bins(h)[b] ==
+		      mnemo_histogram_bins(ref)[b]);
+}
+
+/* add the trace in batches of the given lengths, repeated up to its end */
+static void check_batches(enum mnemo_reuse_engine engine,
+			  const unsigned long long *addrs,
+			  const size_t *lengths, size_t nlengths)
+{
+	struct mnemo_reuse_gran *g;
+	struct mnemo_reusedm *refs[NLEVELS];
+	struct mnemo_histogram *h[NLEVELS], *href[NLEVELS];
+	unsigned long long *keys = malloc(N * sizeof(*keys));
+	int64_t *out = malloc(NLEVELS * N * sizeof(*out));
+	int64_t *ref = malloc(N * sizeof(*ref));
+
+	check(keys != NULL && out != NULL && ref != NULL);
+	g = mnemo_reuse_gran_init(0, engine, shifts, NLEVELS);
+	check(mnemo_reuse_gran_nlevels(g) == NLEVELS);
+	for (size_t l = 0; l < NLEVELS; l++) {
+		h[l] = mnemo_histogram_init(MNEMO_HISTOGRAM_LOG2, NBINS, 0);
+		href[l] = mnemo_histogram_init(MNEMO_HISTOGRAM_LOG2, NBINS, 0);
+		mnemo_reuse_gran_attach(g, l, h[l]);
+		refs[l] = mnemo_reusedm_init_engine(0, engine);
+		mnemo_reusedm_attach(refs[l], href[l]);
+	}
+
+	for (size_t i = 0, k = 0, n; i < N; i += n, k = (k + 1) % nlengths) {
+		n = lengths[k] < N - i ? lengths[k] : N - i;
+		/* a batch without distances in the middle of the others */
+		mnemo_reuse_gran_add_batch(g, &addrs[i], n, k == 1 ? NULL : out);
+		for (size_t l = 0; l < NLEVELS; l++) {
+			for (size_t j = 0; j < n; j++)
+				keys[j] = addrs[i + j] >> shifts[l];
+			mnemo_reusedm_add_batch(refs[l], keys, n, ref);
+			for (size_t j = 0; j < n && k != 1; j++)
+				check(out[l * n + j] == ref[j]);
+			check_histogram(h[l], href[l]);
+		}
+	}
+
+	/* a reset forgets the last key of each level */
+	mnemo_reuse_gran_reset(g);
+	for (size_t l = 0; l < NLEVELS; l++) {
+		mnemo_histogram_reset(h[l]);
+		mnemo_reusedm_reset(refs[l]);
+		mnemo_histogram_reset(href[l]);
+	}
+	mnemo_reuse_gran_add_batch(g, addrs, CHUNK, out);
+	for (size_t l = 0; l < NLEVELS; l++) {
+		for (size_t j = 0; j < CHUNK; j++)
+			keys[j] = addrs[j] >> shifts[l];
+		mnemo_reusedm_add_batch(refs[l], keys, CHUNK, ref);
+		for (size_t j = 0; j < CHUNK; j++)
+			check(out[l * CHUNK + j] == ref[j]);
+		check_histogram(h[l], href[l]);
+	}
+
+	mnemo_reuse_gran_fini(g);
+	for (size_t l = 0; l < NLEVELS; l++) {
+		mnemo_reusedm_fini(refs[l]);
+		mnemo_histogram_fini(h[l]);
+		mnemo_histogram_fini(href[l]);
+	}
+	free(keys);
+	free(out);
+	free(ref);
+}
+
+int main(void)
+{
+	unsigned long long *addrs = trace();
+	/* runs straddle the ends of the chunks of the first batch */
+	const size_t whole[] = { N };
+	const size_t chunks[] = { CHUNK - 1, CHUNK, CHUNK + 1 };
+	const size_t small[] = { 1, 7, 1000, 2 * RUN + 1, 3 };
+
+	check((CHUNK / RUN) % 2 == 0 && (2 * CHUNK / RUN) % 2 == 0);
+	check_batches(MNEMO_REUSE_SPLAY, addrs, whole, 1);
+	check_batches(MNEMO_REUSE_FENWICK, addrs, whole, 1);
+	check_batches(MNEMO_REUSE_SPLAY, addrs, chunks, 3);
+	check_batches(MNEMO_REUSE_SPLAY, addrs, small, 5);
+	free(addrs);
+	return EXIT_SUCCESS;
+}
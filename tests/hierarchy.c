@@ -0,0 +1,268 @@
+#include "reference.h"
+
+/* Check cache hierarchies against a naive model, built on the caches of
+ * reference.h, that runs each access down its chain of levels before the next
+ * one. Non-inclusive, inclusive and exclusive levels are mixed in several
+ * chains, with per-range counters, and batches must match single accesses.
+ * Two properties are also checked against the plain cache simulator and reuse
+ * distances: a non-inclusive level sees the misses of the level above, and a
+ * fully associative LRU victim cache below a fully associative LRU level
+ * misses like a single LRU cache of their combined size.
+ */
+
+#define N 100000
+
+#define TOP MNEMO_HIERARCHY_TOP
+
+static const struct mnemo_hierarchy_level levels[] = {
+	/* L1 and L2, and an exclusive L3 below L2 */
+	{ { 4096, 4, 64, MNEMO_CACHE_LRU }, MNEMO_INCLUSION_NINE, TOP },
+	{ { 32768, 8, 64, MNEMO_CACHE_PLRU }, MNEMO_INCLUSION_NINE, 0 },
+	/* fully associative L1, and its victim cache */
+	{ { 4096, 0, 64, MNEMO_CACHE_LRU }, MNEMO_INCLUSION_NINE, TOP },
+	{ { 8192, 0, 64, MNEMO_CACHE_LRU }, MNEMO_INCLUSION_EXCLUSIVE, 2 },
+	/* a TLB of 16 pages */
+	{ { 16 * 4096, 0, 4096, MNEMO_CACHE_LRU }, MNEMO_INCLUSION_NINE, TOP },
+	/* L1 and an inclusive L2 of larger lines */
+	{ { 4096, 4, 64, MNEMO_CACHE_LRU }, MNEMO_INCLUSION_NINE, TOP },
+	{ { 16384, 4, 128, MNEMO_CACHE_LRU }, MNEMO_INCLUSION_INCLUSIVE, 5 },
+	{ { 32768, 8, 64, MNEMO_CACHE_PLRU }, MNEMO_INCLUSION_EXCLUSIVE, 1 },
+	/* L1, L2 and an inclusive L3 invalidating both */
+	{ { 2048, 4, 64, MNEMO_CACHE_LRU }, MNEMO_INCLUSION_NINE, TOP },
+	{ { 8192, 8, 64, MNEMO_CACHE_PLRU }, MNEMO_INCLUSION_NINE, 8 },
+	{ { 32768, 8, 128, MNEMO_CACHE_LRU }, MNEMO_INCLUSION_INCLUSIVE, 9 },
+};
+
+#define NLEVELS (sizeof(levels) / sizeof(levels[0]))
+
+static const struct mnemo_range ranges[] = {
+	{ 0, 1 << 16 },
+	{ 1 << 16, 1 << 17 },
+	{ 1 << 20, (1 << 20) + (1 << 21) },
+};
+
+#define NRANGES (sizeof(ranges) / sizeof(ranges[0]))
+
+/* the naive hierarchy */
+
+enum ref_event_type {
+	REF_LOOKUP,
+	REF_INSERT,
+};
+
+struct ref_event {
+	unsigned long long addr;
+	enum ref_event_type type;
+};
+
+/* an access produces a few events per level, at most two per event above */
+#define REF_EVENTS 64
+
+struct ref_level {
+	struct ref_cache cache;
+	enum mnemo_inclusion inclusion;
+	size_t above, below;
+	struct mnemo_cache_stats stats[NRANGES + 1];
+};
+
+static struct ref_level ref[NLEVELS];
+
+static size_t ref_range(unsigned long long addr)
+{
+	for (size_t r = 0; r < NRANGES; r++)
+		if (addr >= ranges[r].start && addr < ranges[r].end)
+			return r;
+	return NRANGES;
+}
+
+static void ref_init(void)
+{
+	for (size_t l = 0; l < NLEVELS; l++) {
+		ref_cache_init(&ref[l].cache, &levels[l].cache);
+		ref[l].inclusion = levels[l].inclusion;
+		ref[l].above = levels[l].above;
+		ref[l].below = NLEVELS;
+		memset(ref[l].stats, 0, sizeof(ref[l].stats));
+	}
+	for (size_t l = 0; l < NLEVELS; l++)
+		if (ref[l].above != TOP)
+			ref[ref[l].above].below = l;
+}
+
+static void ref_fini(void)
+{
+	for (size_t l = 0; l < NLEVELS; l++)
+		ref_cache_fini(&ref[l].cache);
+}
+
+/* fill a missing line, invalidate its victim above an inclusive level, and
+ * send it to an exclusive level below.
+ */
+static void ref_fill(size_t l, unsigned long long addr, struct ref_event *out,
+		     size_t *nout)
+{
+	struct ref_cache *c = &ref[l].cache;
+	unsigned long long victim, start;
+
+	if (!ref_cache_insert(c, addr / c->linesize, &victim))
+		return;
+	start = victim * c->linesize;
+	if (ref[l].inclusion == MNEMO_INCLUSION_INCLUSIVE)
+		for (size_t u = ref[l].above; u != TOP; u = ref[u].above)
+			for (unsigned long long a = start;
+			     a < start + c->linesize;
+			     a += ref[u].cache.linesize)
+				ref_cache_remove(&ref[u].cache,
+						 a / ref[u].cache.linesize);
+	if (ref[l].below != NLEVELS &&
+	    ref[ref[l].below].inclusion == MNEMO_INCLUSION_EXCLUSIVE) {
+		check(*nout < REF_EVENTS);
+		out[(*nout)++] = (struct ref_event){ start, REF_INSERT };
+	}
+}
+
+static void ref_access(unsigned long long addr)
+{
+	size_t range = ref_range(addr);
+
+	for (size_t top = 0; top < NLEVELS; top++) {
+		struct ref_event in[REF_EVENTS], out[REF_EVENTS];
+		size_t nin = 1, nout;
+
+		if (ref[top].above != TOP)
+			continue;
+		in[0] = (struct ref_event){ addr, REF_LOOKUP };
+		for (size_t l = top; l != NLEVELS; l = ref[l].below) {
+			struct ref_cache *c = &ref[l].cache;
+			int exclusive = ref[l].inclusion ==
+				MNEMO_INCLUSION_EXCLUSIVE;
+
+			nout = 0;
+			for (size_t i = 0; i < nin; i++) {
+				unsigned long long line = in[i].addr /
+					c->linesize;
+
+				if (in[i].type == REF_INSERT) {
+					if (!ref_cache_lookup(c, line))
+						ref_fill(l, in[i].addr, out,
+							 &nout);
+					continue;
+				}
+				if (ref_cache_lookup(c, line)) {
+					ref[l].stats[range].hits++;
+					if (exclusive)
+						ref_cache_remove(c, line);
+					continue;
+				}
+				ref[l].stats[range].misses++;
+				if (ref[l].below != NLEVELS) {
+					check(nout < REF_EVENTS);
+					out[nout++] = in[i];
+				}
+				if (!exclusive)
+					ref_fill(l, in[i].addr, out, &nout);
+			}
+			memcpy(in, out, nout * sizeof(*out));
+			nin = nout;
+		}
+	}
+}
+
+/* per-range counters of a level must match, and add up to the totals */
+static void check_stats(const struct mnemo_hierarchy *h, size_t l,
+			const struct mnemo_cache_stats *stats)
+{
+	struct mnemo_cache_stats all, s;
+	unsigned long long hits = 0, misses = 0;
+
+	for (size_t r = 0; r <= NRANGES; r++) {
+		s = mnemo_hierarchy_stats(h, l, r);
+		check(s.hits == stats[r].hits && s.misses == stats[r].misses);
+		hits += s.hits;
+		misses += s.misses;
+	}
+	all = mnemo_hierarchy_stats(h, l, MNEMO_HIERARCHY_ALL);
+	check(all.hits == hits && all.misses == misses);
+}
+
+int main(void)
+{
+	struct mnemo_hierarchy *h, *single;
+	struct mnemo_cache *c;
+	struct mnemo_reusedm *r;
+	unsigned long long *addrs, *lines, state = 42;
+	unsigned char *out;
+	int64_t *dist;
+	size_t nmisses = 0;
+
+	addrs = malloc(N * sizeof(*addrs));
+	check(addrs != NULL);
+	/* random accesses within 256 KiB, and a sequential sweep of 4 MiB */
+	for (size_t i = 0; i < N; i++)
+		addrs[i] = ref_next(&state) % 3 ? ref_next(&state) % (1 << 18) :
+			(1 << 20) + i * 8 % (1 << 22);
+
+	/* batches of random sizes, single accesses and the naive model */
+	h = mnemo_hierarchy_init(levels, NLEVELS, ranges, NRANGES);
+	single = mnemo_hierarchy_init(levels, NLEVELS, ranges, NRANGES);
+	ref_init();
+	for (size_t i = 0, len; i < N; i += len) {
+		len = ref_next(&state) % 10000 + 1;
+		if (len > N - i)
+			len = N - i;
+		mnemo_hierarchy_add_batch(h, &addrs[i], len);
+		for (size_t j = 0; j < len; j++) {
+			mnemo_hierarchy_add(single, addrs[i + j]);
+			ref_access(addrs[i + j]);
+		}
+	}
+	for (size_t l = 0; l < NLEVELS; l++) {
+		check_stats(h, l, ref[l].stats);
+		check_stats(single, l, ref[l].stats);
+	}
+	mnemo_hierarchy_fini(single);
+
+	/* the same trace after a reset */
+	mnemo_hierarchy_reset(h);
+	mnemo_hierarchy_add_batch(h, addrs, N);
+	for (size_t l = 0; l < NLEVELS; l++)
+		check_stats(h, l, ref[l].stats);
+	ref_fini();
+
+	/* level 1 sees the misses of level 0 */
+	out = malloc(N * sizeof(*out));
+	lines = malloc(N * sizeof(*lines));
+	check(out != NULL && lines != NULL);
+	c = mnemo_cache_init(&levels[0].cache, 1);
+	mnemo_cache_add_batch(c, addrs, N, out);
+	for (size_t i = 0; i < N; i++)
+		if (out[i])
+			lines[nmisses++] = addrs[i];
+	mnemo_cache_fini(c);
+	c = mnemo_cache_init(&levels[1].cache, 1);
+	mnemo_cache_add_batch(c, lines, nmisses, NULL);
+	check(mnemo_hierarchy_stats(h, 1, MNEMO_HIERARCHY_ALL).misses ==
+	      mnemo_cache_misses(c, 0));
+	mnemo_cache_fini(c);
+
+	/* levels 2 and 3 act as a single LRU cache of 64 + 128 lines */
+	dist = malloc(N * sizeof(*dist));
+	check(dist != NULL);
+	for (size_t i = 0; i < N; i++)
+		lines[i] = addrs[i] / 64;
+	r = mnemo_reusedm_init(0);
+	mnemo_reusedm_add_batch(r, lines, N, dist);
+	nmisses = 0;
+	for (size_t i = 0; i < N; i++)
+		nmisses += dist[i] < 0 || dist[i] >= 192;
+	check(mnemo_hierarchy_stats(h, 3, MNEMO_HIERARCHY_ALL).misses ==
+	      nmisses);
+	mnemo_reusedm_fini(r);
+
+	mnemo_hierarchy_fini(h);
+	free(addrs);
+	free(lines);
+	free(dist);
+	free(out);
+	return EXIT_SUCCESS;
+}
@@ -0,0 +1,221 @@
+#include "reference.h"
+
+/* Check histograms: distances at the edges of log2 and linear bins, including
+ * the ones past the last bin, land where a naive binning puts them, cold misses
+ * and skipped accesses are counted apart, and a histogram attached to managers
+ * counts the distances of an LRU stack, weighted by the inverse of the rate
+ * for a sampling manager. Miss ratio curves must match the misses of an LRU
+ * stack at the start of each bin, and at every size with bins of width 1, and
+ * interpolate linearly in between.
+ */
+
+#define N 50000
+
+/* keys of the trace are below KEYS */
+#define KEYS 3000
+
+/* bin of a distance, one bit at a time or one width at a time */
+static size_t naive_bin(enum mnemo_histogram_scale scale, size_t nbins,
+			unsigned long long width, unsigned long long d)
+{
+	size_t bin = 0;
+
+	if (scale == MNEMO_HISTOGRAM_LOG2) {
+		for (; d != 0; d >>= 1)
+			bin++;
+	} else {
+		for (; d >= width && bin < nbins; d -= width)
+			bin++;
+	}
+	return bin < nbins ? bin : nbins - 1;
+}
+
+/* start of a bin, by the definition of the bins */
+static unsigned long long naive_start(enum mnemo_histogram_scale scale,
+				      unsigned long long width, size_t bin)
+{
+	unsigned long long ret = 0;
+
+	for (size_t b = 0; b < bin; b++)
+		ret = scale == MNEMO_HISTOGRAM_LINEAR ? ret + width :
+			ret == 0 ? 1 : 2 * ret;
+	return ret;
+}
+
+static void check_edges(enum mnemo_histogram_scale scale, size_t nbins,
+			unsigned long long width)
+{
+	struct mnemo_histogram *h = mnemo_histogram_init(scale, nbins, width);
+	double *ref = calloc(nbins, sizeof(*ref));
+	double cold = 0.0;
+
+	check(ref != NULL);
+	check(mnemo_histogram_nbins(h) == nbins);
+	for (size_t b = 0; b < nbins; b++)
+		check(mnemo_histogram_bin_start(h, b) ==
+		      naive_start(scale, width, b));
+	/* each side of the start of every bin that fits in 63 bits */
+	for (size_t b = 0; b <= nbins; b++) {
+		unsigned long long start = naive_start(scale, width, b);
+
+		if (b > 0 && start <= naive_start(scale, width, b - 1))
+			break;
+		for (unsigned long long d = start > 2 ? start - 2 : 0;
+		     d <= start + 2 && d <= INT64_MAX; d++) {
+			mnemo_histogram_add(h, d, 0.5 + d % 3);
+			ref[naive_bin(scale, nbins, width, d)] += 0.5 + d % 3;
+		}
+	}
+	mnemo_histogram_add(h, INT64_MAX, 1.0);
+	ref[naive_bin(scale, nbins, width, INT64_MAX)] += 1.0;
+	mnemo_histogram_add(h, -1, 2.5);
+	cold += 2.5;
+	mnemo_histogram_add(h, MNEMO_REUSE_SKIPPED, 100.0);
+	check(mnemo_histogram_cold(h) == cold);
+	for (size_t b = 0; b < nbins; b++)
+		check(mnemo_histogram_bins(h)[b] == ref[b]);
+
+	mnemo_histogram_reset(h);
+	check(mnemo_histogram_cold(h) == 0.0);
+	for (size_t b = 0; b < nbins; b++)
+		check(mnemo_histogram_bins(h)[b] == 0.0);
+	mnemo_histogram_fini(h);
+	free(ref);
+}
+
+/* the histogram of managers must count the distances they return */
+static void check_attached(const unsigned long long *keys)
+{
+	struct mnemo_histogram *h, *ref;
+	struct mnemo_reusedm *r, *s;
+	int64_t *out = malloc(N * sizeof(*out));
+	int64_t *lru = ref_distances(keys, N);
+	double weight;
+
+	check(out != NULL);
+	h = mnemo_histogram_init(MNEMO_HISTOGRAM_LOG2, 20, 0);
+	ref = mnemo_histogram_init(MNEMO_HISTOGRAM_LOG2, 20, 0);
+	r = mnemo_reusedm_init(0);
+	mnemo_reusedm_attach(r, h);
+	mnemo_reusedm_add_batch(r, keys, N / 2, out);
+	for (size_t i = N / 2; i < N; i++)
+		out[i] = mnemo_reusedm_add(r, keys[i]);
+	for (size_t i = 0; i < N; i++) {
+		check(out[i] == lru[i]);
+		mnemo_histogram_add(ref, lru[i], 1.0);
+	}
+	check(mnemo_histogram_cold(h) == mnemo_histogram_cold(ref));
+	for (size_t b = 0; b < 20; b++)
+		check(mnemo_histogram_bins(h)[b] ==
+		      mnemo_histogram_bins(ref)[b]);
+
+	/* a sampled manager sharing the histogram, once detached from r */
+	mnemo_reusedm_attach(r, NULL);
+	mnemo_reusedm_add_batch(r, keys, N, NULL);
+	s = mnemo_reusedm_init_sampled(0, MNEMO_REUSE_SPLAY, 0.3, 0);
+	mnemo_reusedm_attach(s, h);
+	mnemo_reusedm_add_batch(s, keys, N, out);
+	weight = 1.0 / mnemo_reusedm_rate(s);
+	for (size_t i = 0; i < N; i++)
+		mnemo_histogram_add(ref, out[i], weight);
+	check(mnemo_histogram_cold(h) == mnemo_histogram_cold(ref));
+	for (size_t b = 0; b < 20; b++)
+		check(mnemo_histogram_bins(h)[b] ==
+		      mnemo_histogram_bins(ref)[b]);
+	mnemo_reusedm_fini(r);
+	mnemo_reusedm_fini(s);
+	mnemo_histogram_fini(h);
+	mnemo_histogram_fini(ref);
+	free(out);
+	free(lru);
+}
+
+/* misses of a fully associative LRU cache of a given size */
+static double lru_misses(const int64_t *lru, unsigned long long size)
+{
+	double ret = 0.0;
+
+	for (size_t i = 0; i < N; i++)
+		ret += lru[i] < 0 || (unsigned long long)lru[i] >= size;
+	return ret;
+}
+
+static int close_to(double a, double b)
+{
+	return a - b < 1e-12 && b - a < 1e-12;
+}
+
+/* log2 bins, the last ones past the largest distance of the trace */
+#define NBINS 10
+
+static void check_mrc(const unsigned long long *keys)
+{
+	struct mnemo_histogram *h;
+	int64_t *lru = ref_distances(keys, N);
+	unsigned long long sizes[3 * NBINS];
+	double out[3 * NBINS], mrc[NBINS], ratio;
+
+	/* bins of width 1, exact at all sizes */
+	h = mnemo_histogram_init(MNEMO_HISTOGRAM_LINEAR, KEYS + 1, 1);
+	for (size_t i = 0; i < N; i++)
+		mnemo_histogram_add(h, lru[i], 1.0);
+	for (unsigned long long s = 0; s < KEYS + 2; s++) {
+		mnemo_histogram_mrc(h, &s, 1, &ratio);
+		check(close_to(ratio, lru_misses(lru, s) / N));
+	}
+	mnemo_histogram_fini(h);
+
+	/* log2 bins, exact at the start of each bin */
+	h = mnemo_histogram_init(MNEMO_HISTOGRAM_LOG2, NBINS, 0);
+	for (size_t i = 0; i < N; i++)
+		mnemo_histogram_add(h, lru[i], 1.0);
+	mnemo_histogram_mrc(h, NULL, NBINS, mrc);
+	for (size_t b = 0; b < NBINS; b++)
+		check(close_to(mrc[b], lru_misses(lru, 1ULL << b >> 1) / N));
+
+	/* and linear within a bin, while sizes within the last bin count all
+	 * its accesses as misses.
+	 */
+	for (size_t b = 0; b < NBINS; b++) {
+		unsigned long long lo = 1ULL << b >> 1, hi = 1ULL << b;
+
+		sizes[3 * b] = lo + (hi - lo) / 3;
+		sizes[3 * b + 1] = lo + 2 * (hi - lo) / 3;
+		sizes[3 * b + 2] = hi - 1;
+	}
+	mnemo_histogram_mrc(h, sizes, 3 * NBINS, out);
+	for (size_t i = 0; i < 3 * NBINS; i++) {
+		size_t b = i / 3;
+		unsigned long long lo = 1ULL << b >> 1, hi = 1ULL << b;
+		double expected = lru_misses(lru, lo);
+
+		if (b + 1 < NBINS)
+			expected -= (expected - lru_misses(lru, hi)) *
+				(sizes[i] - lo) / (hi - lo);
+		check(close_to(out[i], expected / N));
+		check(out[i] <= mrc[b]);
+		check(b + 1 == NBINS || out[i] >= mrc[b + 1]);
+	}
+	mnemo_histogram_reset(h);
+	mnemo_histogram_mrc(h, NULL, NBINS, mrc);
+	for (size_t b = 0; b < NBINS; b++)
+		check(mrc[b] == 0.0);
+	mnemo_histogram_fini(h);
+	free(lru);
+}
+
+int main(void)
+{
+	unsigned long long *keys = ref_trace(N, KEYS, 42);
+
+	check_edges(MNEMO_HISTOGRAM_LOG2, 65, 0);
+	check_edges(MNEMO_HISTOGRAM_LOG2, 10, 0);
+	check_edges(MNEMO_HISTOGRAM_LOG2, 1, 0);
+	check_edges(MNEMO_HISTOGRAM_LINEAR, 50, 1);
+	check_edges(MNEMO_HISTOGRAM_LINEAR, 20, 7);
+	check_edges(MNEMO_HISTOGRAM_LINEAR, 1, 10);
+	check_attached(keys);
+	check_mrc(keys);
+	free(keys);
+	return EXIT_SUCCESS;
+}
@@ -0,0 +1,72 @@
+#include "reference.h"
+
+#include <internal/keymap.h>
+
+/* Check the open addressing key map against a direct-mapped table, under a
+ * random mix of insertions, updates and removals that grows the map from its
+ * smallest size and then shrinks and refills it, so that removals shift long
+ * probe sequences back.
+ */
+
+#define KEYS 5000
+#define OPS 400000
+
+static uint64_t values[KEYS];
+static int present[KEYS];
+
+static void check_map(const struct mnemo_keymap *m, size_t count)
+{
+	check(m->count == count);
+	for (uint64_t k = 0; k < KEYS; k++) {
+		struct mnemo_keymap_slot *s;
+
+		s = mnemo_keymap_find(m, k, mnemo_keymap_hash(k));
+		check((s != NULL) == present[k]);
+		check(s == NULL || s->value == values[k]);
+	}
+}
+
+int main(void)
+{
+	struct mnemo_keymap m;
+	unsigned long long state = 42;
+	size_t count = 0;
+
+	mnemo_keymap_init(&m, 0);
+	for (size_t i = 0; i < OPS; i++) {
+		uint64_t k = ref_next(&state) % KEYS;
+		uint64_t hash = mnemo_keymap_hash(k);
+		/* mostly inserts first, then mostly removals, then balanced */
+		unsigned int insert = i < OPS / 4 ? 80 : i < OPS / 2 ? 20 : 50;
+		struct mnemo_keymap_slot *s;
+		int found;
+
+		if (ref_next(&state) % 100 < insert) {
+			s = mnemo_keymap_lookup(&m, k, hash, &found);
+			check(found == present[k]);
+			check(!found || s->value == values[k]);
+			s->value = i;
+			values[k] = i;
+			if (!found)
+				count++;
+			present[k] = 1;
+		} else {
+			s = mnemo_keymap_find(&m, k, hash);
+			check((s != NULL) == present[k]);
+			if (s != NULL) {
+				mnemo_keymap_remove(&m, s);
+				present[k] = 0;
+				count--;
+			}
+		}
+		if (i % 10000 == 0)
+			check_map(&m, count);
+	}
+	check_map(&m, count);
+
+	mnemo_keymap_clear(&m);
+	memset(present, 0, sizeof(present));
+	check_map(&m, 0);
+	mnemo_keymap_fini(&m);
+	return EXIT_SUCCESS;
+}
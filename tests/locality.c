@@ -0,0 +1,126 @@
+#include "reference.h"
+
+/* Check the locality engine: reuse times against a table of last accesses,
+ * and the average footprint against the footprints of all the windows of the
+ * trace, counted one window at a time.
+ *
+ * The footprint is exact for windows shorter than 64 accesses. Beyond, only
+ * the times in the bin of the window length w are estimated, and bins are at
+ * most w/32 wide: each time t within w/32 of w is off by less than w/32 in
+ * the sum of the excesses over w, and the footprint by that sum over the
+ * n - w + 1 windows.
+ */
+
+#define N 20000
+
+/* keys of the trace are below KEYS */
+#define KEYS 1100
+
+/* random accesses to 500 keys, with bursts over a small set of keys that
+ * changes halfway through the trace.
+ */
+static unsigned long long *trace(void)
+{
+	unsigned long long *ret = malloc(N * sizeof(*ret)), state = 42;
+
+	check(ret != NULL);
+	for (size_t i = 0; i < N; i++)
+		ret[i] = i / 7 % 3 ? ref_next(&state) % 500 :
+			ref_next(&state) % 50 + (i < N / 2 ? 500 : 1000);
+	return ret;
+}
+
+/* average number of distinct keys of the windows of length w */
+static double windows_footprint(const unsigned long long *keys, size_t w)
+{
+	static size_t counts[KEYS];
+	size_t distinct = 0;
+	double sum = 0.0;
+
+	memset(counts, 0, sizeof(counts));
+	for (size_t i = 0; i < N; i++) {
+		if (counts[keys[i]]++ == 0)
+			distinct++;
+		if (i >= w && --counts[keys[i - w]] == 0)
+			distinct--;
+		if (i + 1 >= w)
+			sum += distinct;
+	}
+	return sum / (N - w + 1);
+}
+
+int main(void)
+{
+	unsigned long long *keys = trace();
+	unsigned long long last[KEYS] = { 0 };
+	unsigned long long sizes[] = { 1, 10, 50, 100, 200, 400, 549, 550, 1000 };
+	double mrc[sizeof(sizes) / sizeof(sizes[0])];
+	/* reuse, first access and end of trace distances of the trace */
+	unsigned long long *times = malloc((N + KEYS) * sizeof(*times));
+	size_t ntimes = 0, nkeys = 0;
+	struct mnemo_locality *l;
+	struct mnemo_histogram *h;
+	int64_t *out = malloc(N * sizeof(*out));
+
+	check(times != NULL && out != NULL);
+	l = mnemo_locality_init(0);
+	h = mnemo_histogram_init(MNEMO_HISTOGRAM_LOG2, 20, 0);
+	mnemo_locality_attach(l, h);
+	mnemo_locality_add_batch(l, keys, N / 3, out);
+	for (size_t i = N / 3; i < N; i++)
+		out[i] = mnemo_locality_add(l, keys[i]);
+
+	/* times are counted from 1 */
+	for (size_t i = 0; i < N; i++) {
+		unsigned long long k = keys[i];
+
+		check(k < KEYS);
+		if (last[k] == 0) {
+			check(out[i] == -1);
+			nkeys++;
+		} else {
+			check(out[i] == (int64_t)(i + 1 - last[k]));
+		}
+		times[ntimes++] = last[k] == 0 ? i + 1 : i + 1 - last[k];
+		last[k] = i + 1;
+	}
+	for (size_t k = 0; k < KEYS; k++)
+		if (last[k] != 0)
+			times[ntimes++] = N + 1 - last[k];
+	check(mnemo_locality_accesses(l) == N);
+	check(mnemo_locality_keys(l) == nkeys);
+	check(mnemo_histogram_cold(h) == nkeys);
+
+	for (size_t w = 1; w <= N; w += w < 100 ? 1 : w / 8) {
+		double fp = mnemo_locality_footprint(l, w);
+		double ref = windows_footprint(keys, w);
+		double width = w < 64 ? 0.0 : w / 32.0, bound = 1e-9 * nkeys;
+
+		for (size_t i = 0; i < ntimes; i++)
+			if (times[i] + width > w && times[i] < w + width)
+				bound += width / (N - w + 1);
+		check(fp - ref <= bound && ref - fp <= bound);
+	}
+	check(mnemo_locality_footprint(l, N) == nkeys);
+	check(mnemo_locality_footprint(l, 2 * N) == nkeys);
+
+	/* miss ratios decrease with the size of caches smaller than the data,
+	 * larger ones only take cold misses.
+	 */
+	mnemo_locality_mrc(l, sizes, sizeof(sizes) / sizeof(sizes[0]), mrc);
+	for (size_t i = 0; i < sizeof(sizes) / sizeof(sizes[0]); i++) {
+		check(mrc[i] >= 0.0 && mrc[i] <= 1.0);
+		check(i == 0 || sizes[i] >= nkeys || mrc[i] <= mrc[i - 1]);
+		check(sizes[i] < nkeys || mrc[i] == (double)nkeys / N);
+	}
+
+	mnemo_locality_reset(l);
+	check(mnemo_locality_accesses(l) == 0 && mnemo_locality_keys(l) == 0);
+	check(mnemo_locality_footprint(l, 5) == 0.0);
+	mnemo_locality_fini(l);
+	mnemo_histogram_fini(h);
+	free(keys);
+	free(times);
+	free(out);
+	return EXIT_SUCCESS;
+}
@@ -0,0 +1,164 @@
+#include "reference.h"
+
+#include <pthread.h>
+#include <time.h>
+
+/* Check the multi-producer front end: producer threads push their part of a
+ * trace, with timestamps shared by accesses of distinct producers, and the
+ * shared and private histograms must be the ones of a sequential replay of the
+ * trace in (timestamp, registration) order, and of each producer alone.
+ * Producers publish and sleep at random, one pushes a few accesses and stays
+ * idle before leaving, another leaves without pushing anything.
+ */
+
+#define N 200000
+
+/* producers pushing most of the trace, the idle one, and the empty one */
+#define BUSY 4
+#define IDLE BUSY
+#define NPRODUCERS (BUSY + 2)
+
+#define ROUNDS 3
+
+/* keys are below KEYS, and bins of width 1 hold all the distances */
+#define KEYS 2000
+#define NBINS (KEYS + 1)
+
+struct access {
+	unsigned long long key;
+	uint64_t time;
+};
+
+struct producer {
+	struct mnemo_reuse_producer *handle;
+	struct access *accesses;
+	size_t n;
+	unsigned long long seed;
+};
+
+static void pause_for(long ns)
+{
+	struct timespec ts = { 0, ns };
+
+	nanosleep(&ts, NULL);
+}
+
+static void *produce(void *arg)
+{
+	struct producer *p = arg;
+
+	for (size_t i = 0; i < p->n; i++) {
+		mnemo_reuse_mp_push(p->handle, p->accesses[i].key,
+				    p->accesses[i].time);
+		if (i % 512 == 511 && ref_next(&p->seed) % 4 == 0) {
+			mnemo_reuse_mp_publish(p->handle);
+			pause_for(100000);
+		}
+	}
+	if (p->n != 0 && p->n < 64) {
+		/* the others wait for its next access */
+		mnemo_reuse_mp_publish(p->handle);
+		pause_for(20000000);
+	}
+	mnemo_reuse_mp_leave(p->handle);
+	return NULL;
+}
+
+static struct mnemo_reusedm *init(struct mnemo_histogram **h)
+{
+	struct mnemo_reusedm *ret = mnemo_reusedm_init(0);
+
+	*h = mnemo_histogram_init(MNEMO_HISTOGRAM_LINEAR, NBINS, 1);
+	mnemo_reusedm_attach(ret, *h);
+	return ret;
+}
+
+static void check_histogram(const struct mnemo_histogram *h,
+			    const struct mnemo_histogram *ref)
+{
+	check(mnemo_histogram_cold(h) == mnemo_histogram_cold(ref));
+	for (size_t b = 0; b < NBINS; b++)
+		check(mnemo_histogram_bins(h)[b] ==
+		      mnemo_histogram_bins(ref)[b]);
+}
+
+static void check_round(unsigned long long seed)
+{
+	struct producer producers[NPRODUCERS];
+	struct mnemo_reusedm *shared, *ref, *private[NPRODUCERS];
+	struct mnemo_reusedm *refs[NPRODUCERS];
+	struct mnemo_histogram *hshared, *href, *hprivate[NPRODUCERS];
+	struct mnemo_histogram *hrefs[NPRODUCERS];
+	pthread_t threads[NPRODUCERS];
+	struct mnemo_reuse_mp *mp;
+	size_t last = NPRODUCERS;
+	uint64_t time = 0;
+
+	ref = init(&href);
+	for (size_t p = 0; p < NPRODUCERS; p++) {
+		producers[p].accesses = malloc(N * sizeof(struct access));
+		check(producers[p].accesses != NULL);
+		producers[p].n = 0;
+		producers[p].seed = seed + p;
+		refs[p] = init(&hrefs[p]);
+	}
+
+	/* the trace, in merge order: the timestamp only stays the same for a
+	 * producer registered later than the previous one.
+	 */
+	for (size_t i = 0; i < N; i++) {
+		size_t p = i < 100 && ref_next(&seed) % 4 == 0 ? IDLE :
+			ref_next(&seed) % BUSY;
+		/* producers share keys, over footprints of their own */
+		unsigned long long key = ref_next(&seed) %
+			(p % 2 ? KEYS / 4 : KEYS);
+		struct producer *q = &producers[p];
+
+		if (last == NPRODUCERS || p <= last || ref_next(&seed) % 2)
+			time++;
+		last = p;
+		q->accesses[q->n++] = (struct access){ key, time };
+		mnemo_reusedm_add64(ref, key);
+		mnemo_reusedm_add64(refs[p], key);
+	}
+	check(producers[IDLE].n > 0 && producers[IDLE].n < 64);
+	check(producers[IDLE + 1].n == 0);
+
+	shared = init(&hshared);
+	mp = mnemo_reuse_mp_init(shared);
+	for (size_t p = 0; p < NPRODUCERS; p++) {
+		/* the last busy producer only counts the shared stream */
+		private[p] = p == BUSY - 1 ? NULL : init(&hprivate[p]);
+		producers[p].handle = mnemo_reuse_mp_join(mp, private[p]);
+	}
+	for (size_t p = 0; p < NPRODUCERS; p++)
+		check(pthread_create(&threads[p], NULL, produce,
+				     &producers[p]) == 0);
+	for (size_t p = 0; p < NPRODUCERS; p++)
+		check(pthread_join(threads[p], NULL) == 0);
+	mnemo_reuse_mp_fini(mp);
+
+	check(mnemo_reusedm_nkeys(shared) == mnemo_reusedm_nkeys(ref));
+	check_histogram(hshared, href);
+	for (size_t p = 0; p < NPRODUCERS; p++) {
+		if (private[p] != NULL) {
+			check_histogram(hprivate[p], hrefs[p]);
+			mnemo_reusedm_fini(private[p]);
+			mnemo_histogram_fini(hprivate[p]);
+		}
+		mnemo_reusedm_fini(refs[p]);
+		mnemo_histogram_fini(hrefs[p]);
+		free(producers[p].accesses);
+	}
+	mnemo_reusedm_fini(shared);
+	mnemo_histogram_fini(hshared);
+	mnemo_reusedm_fini(ref);
+	mnemo_histogram_fini(href);
+}
+
+int main(void)
+{
+	for (unsigned long long r = 0; r < ROUNDS; r++)
+		check_round(42 + 100 * r);
+	return EXIT_SUCCESS;
+}
@@ -0,0 +1,77 @@
+#include "reference.h"
+
+/* Check that the multithreaded batch interface gives the same distances and
+ * histograms as the sequential one, which the engines test checks against an
+ * LRU stack. Batches are large enough to be split between threads, and the
+ * second batch reuses the keys left in the manager by the first one.
+ */
+
+#define N 300000
+
+static const size_t footprints[] = { 10, 5000, 200000 };
+
+#define NFOOTPRINTS (sizeof(footprints) / sizeof(footprints[0]))
+
+static const unsigned int threads[] = { 2, 3, 8 };
+
+#define NTHREADS (sizeof(threads) / sizeof(threads[0]))
+
+/* a manager of an engine, counting its distances in a histogram */
+static struct mnemo_reusedm *init(enum mnemo_reuse_engine engine,
+				  struct mnemo_histogram **h)
+{
+	struct mnemo_reusedm *ret = mnemo_reusedm_init_engine(0, engine);
+
+	*h = mnemo_histogram_init(MNEMO_HISTOGRAM_LINEAR, 1000, 10);
+	mnemo_reusedm_attach(ret, *h);
+	return ret;
+}
+
+static void check_parallel(enum mnemo_reuse_engine engine,
+			   const unsigned long long *keys, unsigned int nthreads)
+{
+	struct mnemo_reusedm *seq, *par;
+	struct mnemo_histogram *hseq, *hpar;
+	int64_t *ref = malloc(N * sizeof(*ref));
+	int64_t *out = malloc(N * sizeof(*out));
+
+	check(ref != NULL && out != NULL);
+	seq = init(engine, &hseq);
+	par = init(engine, &hpar);
+	mnemo_reusedm_add_batch(seq, keys, N / 2, ref);
+	mnemo_reusedm_add_batch(seq, &keys[N / 2], N - N / 2, &ref[N / 2]);
+	mnemo_reusedm_add_parallel(par, keys, N / 2, out, nthreads);
+	mnemo_reusedm_add_parallel(par, &keys[N / 2], N - N / 2, &out[N / 2],
+				   nthreads);
+	for (size_t i = 0; i < N; i++)
+		check(out[i] == ref[i]);
+	check(mnemo_reusedm_nkeys(par) == mnemo_reusedm_nkeys(seq));
+	check(mnemo_histogram_cold(hpar) == mnemo_histogram_cold(hseq));
+	for (size_t b = 0; b < mnemo_histogram_nbins(hseq); b++)
+		check(mnemo_histogram_bins(hpar)[b] ==
+		      mnemo_histogram_bins(hseq)[b]);
+	/* the manager goes on like the sequential one */
+	for (size_t i = 0; i < 1000; i++)
+		check(mnemo_reusedm_add64(par, keys[i]) ==
+		      mnemo_reusedm_add64(seq, keys[i]));
+	mnemo_reusedm_fini(seq);
+	mnemo_reusedm_fini(par);
+	mnemo_histogram_fini(hseq);
+	mnemo_histogram_fini(hpar);
+	free(ref);
+	free(out);
+}
+
+int main(void)
+{
+	for (size_t f = 0; f < NFOOTPRINTS; f++) {
+		unsigned long long *keys = ref_trace(N, footprints[f], 42 + f);
+
+		for (size_t t = 0; t < NTHREADS; t++) {
+			check_parallel(MNEMO_REUSE_SPLAY, keys, threads[t]);
+			check_parallel(MNEMO_REUSE_FENWICK, keys, threads[t]);
+		}
+		free(keys);
+	}
+	return EXIT_SUCCESS;
+}
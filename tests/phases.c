@@ -0,0 +1,106 @@
+#include "reference.h"
+
+/* Check phase detection on a synthetic trace switching between two phases: a
+ * loop over a few keys, and random accesses to more keys. Intervals end at the
+ * phase boundaries, and the runs must be the phases of the trace, the second
+ * occurrence of a phase going back to its first one, with the snapshots and
+ * accesses of each run. Representatives of a phase are intervals of the phase.
+ */
+
+/* lengths of the phases, alternating between the loop and random accesses */
+static const unsigned long long lengths[] = { 9500, 6100, 5000, 12345, 3000,
+					       1000, 700 };
+
+#define NPHASES (sizeof(lengths) / sizeof(lengths[0]))
+
+/* intervals are ended by marks, at most LENGTH accesses apart */
+#define LENGTH 1000
+#define NBINS 16
+
+static unsigned long long key(size_t phase, unsigned long long i,
+			      unsigned long long *state)
+{
+	return phase % 2 ? 1000 + ref_next(state) % 128 : i % 16;
+}
+
+static void check_phases(void)
+{
+	struct mnemo_reusedm *r = mnemo_reusedm_init(0);
+	struct mnemo_histogram *h;
+	struct mnemo_series *s = mnemo_series_init();
+	struct mnemo_phases *p = mnemo_phases_init(0.5);
+	unsigned long long state = 42, start = 0;
+	size_t first = 0;
+
+	h = mnemo_histogram_init(MNEMO_HISTOGRAM_LOG2, NBINS, 0);
+	mnemo_reusedm_attach(r, h);
+	mnemo_reusedm_intervals(r, s, 0);
+	mnemo_series_attach_phases(s, p);
+	for (size_t i = 0; i < NPHASES; i++) {
+		for (unsigned long long j = 0; j < lengths[i]; j++) {
+			mnemo_reusedm_add64(r, key(i, j, &state));
+			if (j % LENGTH == LENGTH - 1)
+				mnemo_reusedm_mark(r);
+		}
+		mnemo_reusedm_mark(r);
+	}
+
+	/* one run per phase of the trace, in one of two phases */
+	check(mnemo_phases_count(p) == 2);
+	check(mnemo_phases_nruns(p) == NPHASES);
+	for (size_t i = 0; i < NPHASES; i++) {
+		struct mnemo_phase run = mnemo_phases_run(p, i);
+		size_t count = (lengths[i] + LENGTH - 1) / LENGTH;
+
+		check(run.id == i % 2);
+		check(run.first == first && run.count == count);
+		check(run.start == start && run.length == lengths[i]);
+		check(mnemo_series_start(s, first) == start);
+		first += count;
+		start += lengths[i];
+	}
+	check(mnemo_series_count(s) == first);
+
+	/* the representative of a phase is an interval of one of its runs */
+	for (size_t id = 0; id < 2; id++) {
+		size_t rep = mnemo_phases_representative(p, s, id);
+		int found = 0;
+
+		for (size_t i = 0; i < NPHASES; i++) {
+			struct mnemo_phase run = mnemo_phases_run(p, i);
+
+			found |= run.id == id && rep >= run.first &&
+				 rep < run.first + run.count;
+		}
+		check(found);
+	}
+
+	/* a reset detector forgets its phases, and all the intervals are
+	 * within the largest threshold of each other.
+	 */
+	mnemo_phases_reset(p);
+	mnemo_series_reset(s);
+	check(mnemo_phases_count(p) == 0 && mnemo_phases_nruns(p) == 0);
+	mnemo_series_attach_phases(s, NULL);
+	mnemo_phases_fini(p);
+	p = mnemo_phases_init(2.0);
+	mnemo_series_attach_phases(s, p);
+	mnemo_reusedm_intervals(r, s, LENGTH);
+	for (size_t i = 0; i < NPHASES; i++)
+		for (unsigned long long j = 0; j < lengths[i]; j++)
+			mnemo_reusedm_add64(r, key(i, j, &state));
+	check(mnemo_phases_count(p) == 1 && mnemo_phases_nruns(p) == 1);
+	check(mnemo_phases_run(p, 0).count == mnemo_series_count(s));
+
+	mnemo_series_attach_phases(s, NULL);
+	mnemo_reusedm_fini(r);
+	mnemo_histogram_fini(h);
+	mnemo_series_fini(s);
+	mnemo_phases_fini(p);
+}
+
+int main(void)
+{
+	check_phases();
+	return EXIT_SUCCESS;
+}
@@ -0,0 +1,219 @@
+/*
+ * Reference models shared by the unit tests.
+ *
+ * The library is checked against naive implementations of what it computes,
+ * simple enough to be obviously right, on traces small enough for them.
+ * Checks do not use assert, so that tests still run with NDEBUG.
+ */
+
+#ifndef MNEMO_TESTS_REFERENCE_H
+#define MNEMO_TESTS_REFERENCE_H 1
+
+#include "config.h"
+
+#include "mnemo.h"
+
+#define check(cond)							\
+	do {								\
+		if (!(cond)) {						\
+			fprintf(stderr, "%s:%d: check failed: %s\n",	\
+				__FILE__, __LINE__, #cond);		\
+			exit(EXIT_FAILURE);				\
+		}							\
+	} while (0)
+
+/* xorshift64*, good enough to generate a trace */
+static inline unsigned long long ref_next(unsigned long long *state)
+{
+	unsigned long long x = *state;
+
+	x ^= x >> 12;
+	x ^= x << 25;
+	x ^= x >> 27;
+	*state = x;
+	return x * 0x2545F4914F6CDD1DULL;
+}
+
+/* a trace of n accesses to keys below footprint, mixing a sequential sweep,
+ * a strided stream and random accesses, so that distances span all scales.
+ */
+static inline unsigned long long *ref_trace(size_t n, size_t footprint,
+					    unsigned long long seed)
+{
+	unsigned long long *ret = malloc(n * sizeof(*ret));
+
+	check(ret != NULL && footprint > 0);
+	for (size_t i = 0; i < n; i++) {
+		switch (i % 3) {
+		case 0:
+			ret[i] = i / 3 % footprint;
+			break;
+		case 1:
+			ret[i] = i * 7 % footprint;
+			break;
+		default:
+			ret[i] = ref_next(&seed) % footprint;
+		}
+	}
+	return ret;
+}
+
+/* reuse distances of a trace, on an explicit LRU stack: the distance of an
+ * access is the depth of its key in the stack, -1 for the first access.
+ */
+static inline int64_t *ref_distances(const unsigned long long *keys, size_t n)
+{
+	unsigned long long *stack = malloc(n * sizeof(*stack));
+	int64_t *ret = malloc(n * sizeof(*ret));
+	size_t depth = 0;
+
+	check(stack != NULL && ret != NULL);
+	/* the top of the stack is at the end of the array */
+	for (size_t i = 0; i < n; i++) {
+		size_t d;
+
+		for (d = 0; d < depth; d++)
+			if (stack[depth - 1 - d] == keys[i])
+				break;
+		if (d == depth) {
+			ret[i] = -1;
+			stack[depth++] = keys[i];
+			continue;
+		}
+		ret[i] = d;
+		memmove(&stack[depth - 1 - d], &stack[depth - d],
+			d * sizeof(*stack));
+		stack[depth - 1] = keys[i];
+	}
+	free(stack);
+	return ret;
+}
+
+/* a set-associative cache, in terms of line numbers:
+ * - LRU: ways are stamped with the time of their last access, and the oldest
+ *   one is evicted once the set is full.
+ * - tree-PLRU: an explicit tree of bits per set, nodes 1 to ways - 1, each
+ *   pointing to the child that was not used last.
+ * Missing lines fill the first invalid way of their set.
+ */
+struct ref_cache {
+	enum mnemo_cache_policy policy;
+	unsigned long long linesize;
+	size_t nsets, ways;
+	unsigned long long *tags;
+	/* time of the last access of a way, 0 if the way is invalid */
+	unsigned long long *stamps;
+	unsigned char *tree;
+	unsigned long long now;
+};
+
+static inline void ref_cache_init(struct ref_cache *r,
+				  const struct mnemo_cache_config *c)
+{
+	check(c->policy == MNEMO_CACHE_LRU || c->policy == MNEMO_CACHE_PLRU);
+	r->policy = c->policy;
+	r->linesize = c->line;
+	r->ways = c->assoc != 0 ? c->assoc : c->size / c->line;
+	r->nsets = c->size / c->line / r->ways;
+	r->tags = calloc(r->nsets * r->ways, sizeof(*r->tags));
+	r->stamps = calloc(r->nsets * r->ways, sizeof(*r->stamps));
+	r->tree = calloc(r->nsets * r->ways, sizeof(*r->tree));
+	check(r->tags != NULL && r->stamps != NULL && r->tree != NULL);
+	r->now = 0;
+}
+
+static inline void ref_cache_fini(struct ref_cache *r)
+{
+	free(r->tags);
+	free(r->stamps);
+	free(r->tree);
+}
+
+/* way of a line, r->ways if it is not cached */
+static inline size_t ref_cache_way(const struct ref_cache *r,
+				   unsigned long long line)
+{
+	size_t set = line % r->nsets;
+
+	for (size_t w = 0; w < r->ways; w++)
+		if (r->stamps[set * r->ways + w] != 0 &&
+		    r->tags[set * r->ways + w] == line)
+			return w;
+	return r->ways;
+}
+
+/* mark a way of the set of a line as the most recently used */
+static inline void ref_cache_touch(struct ref_cache *r,
+				   unsigned long long line, size_t w)
+{
+	size_t set = line % r->nsets;
+
+	r->stamps[set * r->ways + w] = ++r->now;
+	for (size_t node = w + r->ways; node > 1; node /= 2)
+		r->tree[set * r->ways + node / 2] = !(node & 1);
+}
+
+/* look a line up, return 1 on a hit */
+static inline int ref_cache_lookup(struct ref_cache *r,
+				   unsigned long long line)
+{
+	size_t w = ref_cache_way(r, line);
+
+	if (w == r->ways)
+		return 0;
+	ref_cache_touch(r, line, w);
+	return 1;
+}
+
+/* insert a missing line, return 1 if another one was evicted, in victim */
+static inline int ref_cache_insert(struct ref_cache *r,
+				   unsigned long long line,
+				   unsigned long long *victim)
+{
+	size_t set = line % r->nsets, w, lru = 0;
+	const unsigned long long *stamps = &r->stamps[set * r->ways];
+	int evicted;
+
+	for (w = 0; w < r->ways && stamps[w] != 0; w++)
+		if (stamps[w] < stamps[lru])
+			lru = w;
+	if (w == r->ways && r->policy == MNEMO_CACHE_LRU) {
+		w = lru;
+	} else if (w == r->ways) {
+		size_t node = 1;
+
+		while (node < r->ways)
+			node = 2 * node + r->tree[set * r->ways + node];
+		w = node - r->ways;
+	}
+	evicted = stamps[w] != 0;
+	if (evicted)
+		*victim = r->tags[set * r->ways + w];
+	r->tags[set * r->ways + w] = line;
+	ref_cache_touch(r, line, w);
+	return evicted;
+}
+
+/* invalidate a line, if it is cached */
+static inline void ref_cache_remove(struct ref_cache *r,
+				    unsigned long long line)
+{
+	size_t w = ref_cache_way(r, line);
+
+	if (w < r->ways)
+		r->stamps[line % r->nsets * r->ways + w] = 0;
+}
+
+/* access a byte address, return 1 on a miss */
+static inline int ref_cache_access(struct ref_cache *r,
+				   unsigned long long addr)
+{
+	unsigned long long line = addr / r->linesize, victim;
+
+	if (ref_cache_lookup(r, line))
+		return 0;
+	ref_cache_insert(r, line, &victim);
+	return 1;
+}
+
+#endif /* MNEMO_TESTS_REFERENCE_H */
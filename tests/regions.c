@@ -0,0 +1,172 @@
+#include "reference.h"
+
+#include <internal/ranges.h>
+
+/* Check tables of regions: the range of a key is the one a linear scan finds,
+ * at the bounds of the ranges, in the gaps between them and past them,
+ * whatever the order of the lookups. The statistics and histograms of the
+ * regions of a manager must be the ones of the distances of an LRU stack, or
+ * of the sampled distances weighted by the inverse of the rate, split by the
+ * region of their key.
+ */
+
+#define N 50000
+
+/* keys of the trace are below KEYS */
+#define KEYS 4000
+
+/* adjacent ranges, a range of one key, gaps, and keys past the last range */
+static const struct mnemo_range ranges[] = {
+	{ 0, 100 },
+	{ 100, 101 },
+	{ 500, 1000 },
+	{ 1000, 2000 },
+	{ 3000, KEYS - 1 },
+};
+
+#define NRANGES (sizeof(ranges) / sizeof(ranges[0]))
+
+/* few bins, so that the last one collects the larger distances */
+#define NBINS 8
+
+static size_t naive_find(const struct mnemo_range *r, size_t n,
+			 unsigned long long key)
+{
+	for (size_t i = 0; i < n; i++)
+		if (key >= r[i].start && key < r[i].end)
+			return i;
+	return n;
+}
+
+static void check_find(const struct mnemo_range *r, size_t n)
+{
+	struct mnemo_ranges t;
+	unsigned long long state = 42;
+
+	mnemo_ranges_init(&t, r, n);
+	/* around the bounds, in order then backwards */
+	for (size_t i = 0; i < n; i++)
+		for (unsigned long long k = r[i].start > 1 ? r[i].start - 2 : 0;
+		     k <= r[i].end + 1; k++)
+			check(mnemo_ranges_find(&t, k) == naive_find(r, n, k));
+	for (size_t i = n; i-- > 0;)
+		for (unsigned long long k = r[i].end + 1;
+		     k + 2 >= r[i].start && k != ~0ULL; k--)
+			check(mnemo_ranges_find(&t, k) == naive_find(r, n, k));
+	/* at random, so that the last range found rarely holds the key */
+	for (size_t i = 0; i < 100000; i++) {
+		unsigned long long k = ref_next(&state) % (KEYS + 10);
+
+		check(mnemo_ranges_find(&t, k) == naive_find(r, n, k));
+	}
+	check(mnemo_ranges_find(&t, ~0ULL) == naive_find(r, n, ~0ULL));
+	mnemo_ranges_fini(&t);
+}
+
+/* statistics of a region, from the distances of its accesses */
+struct naive_region {
+	struct mnemo_region_stats stats;
+	double sum;
+	struct mnemo_histogram *hist;
+};
+
+static void check_stats(struct mnemo_reusedm *r, double rate,
+			const unsigned long long *keys)
+{
+	struct mnemo_regions *g = mnemo_regions_init(ranges, NRANGES, NBINS);
+	struct naive_region naive[NRANGES + 1];
+	int64_t *out = malloc(N * sizeof(*out));
+	int64_t *lru = ref_distances(keys, N);
+	struct mnemo_region_stats stats;
+
+	check(out != NULL);
+	check(mnemo_regions_nregions(g) == NRANGES);
+	for (size_t i = 0; i <= NRANGES; i++) {
+		naive[i].stats = (struct mnemo_region_stats){ 0.0, 0.0, 0.0, -1 };
+		naive[i].sum = 0.0;
+		naive[i].hist = mnemo_histogram_init(MNEMO_HISTOGRAM_LOG2,
+						     NBINS, 0);
+	}
+
+	/* batches and single accesses count in the same way */
+	mnemo_reusedm_attach_regions(r, g);
+	mnemo_reusedm_add_batch(r, keys, N / 2, out);
+	for (size_t i = N / 2; i < N; i++)
+		out[i] = mnemo_reusedm_add64(r, keys[i]);
+	for (size_t i = 0; i < N; i++) {
+		struct naive_region *n;
+
+		if (rate == 1.0)
+			check(out[i] == lru[i]);
+		if (out[i] == MNEMO_REUSE_SKIPPED)
+			continue;
+		n = &naive[naive_find(ranges, NRANGES, keys[i])];
+		n->stats.accesses += 1.0 / rate;
+		mnemo_histogram_add(n->hist, out[i], 1.0 / rate);
+		if (out[i] < 0) {
+			n->stats.cold += 1.0 / rate;
+			continue;
+		}
+		n->sum += out[i] * (1.0 / rate);
+		if (out[i] > n->stats.max)
+			n->stats.max = out[i];
+	}
+
+	for (size_t i = 0; i <= NRANGES; i++) {
+		const struct mnemo_histogram *h = mnemo_regions_histogram(g, i);
+		struct naive_region *n = &naive[i];
+		double reuses = n->stats.accesses - n->stats.cold;
+
+		mnemo_regions_stats(g, i, &stats);
+		check(stats.accesses == n->stats.accesses);
+		check(stats.cold == n->stats.cold);
+		check(stats.mean == (reuses > 0 ? n->sum / reuses : 0.0));
+		check(stats.max == n->stats.max);
+		check(mnemo_histogram_nbins(h) == NBINS);
+		check(mnemo_histogram_cold(h) == mnemo_histogram_cold(n->hist));
+		for (size_t b = 0; b < NBINS; b++)
+			check(mnemo_histogram_bins(h)[b] ==
+			      mnemo_histogram_bins(n->hist)[b]);
+		/* all the regions and the keys out of them are accessed */
+		check(stats.accesses > 0.0 || rate < 1.0);
+		mnemo_histogram_fini(n->hist);
+	}
+
+	/* a detached table is left as is, and a reset one is empty */
+	mnemo_reusedm_attach_regions(r, NULL);
+	mnemo_reusedm_add_batch(r, keys, N, NULL);
+	mnemo_regions_stats(g, 0, &stats);
+	check(stats.accesses == naive[0].stats.accesses);
+	mnemo_regions_reset(g);
+	for (size_t i = 0; i <= NRANGES; i++) {
+		mnemo_regions_stats(g, i, &stats);
+		check(stats.accesses == 0.0 && stats.cold == 0.0 &&
+		      stats.mean == 0.0 && stats.max == -1);
+		for (size_t b = 0; b < NBINS; b++)
+			check(mnemo_histogram_bins(
+				mnemo_regions_histogram(g, i))[b] == 0.0);
+	}
+	mnemo_regions_fini(g);
+	free(out);
+	free(lru);
+}
+
+int main(void)
+{
+	unsigned long long *keys = ref_trace(N, KEYS, 42);
+	struct mnemo_reusedm *r;
+
+	check_find(ranges, NRANGES);
+	check_find(ranges, 1);
+	check_find(&ranges[2], 2);
+	check_find(NULL, 0);
+
+	r = mnemo_reusedm_init(0);
+	check_stats(r, 1.0, keys);
+	mnemo_reusedm_fini(r);
+	r = mnemo_reusedm_init_sampled(0, MNEMO_REUSE_FENWICK, 0.5, 0);
+	check_stats(r, mnemo_reusedm_rate(r), keys);
+	mnemo_reusedm_fini(r);
+	free(keys);
+	return EXIT_SUCCESS;
+}
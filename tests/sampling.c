@@ -0,0 +1,131 @@
+#include "reference.h"
+
+/* Check the sampling front end against an explicit LRU stack: at rate 1 all
+ * the keys are tracked with exact distances. At a lower fixed rate, a key is
+ * either always tracked or always skipped, about the given fraction of the
+ * keys is tracked, and the distances of tracked accesses are the ones of the
+ * trace of tracked keys, scaled by the inverse of the rate. A sampler with a
+ * budget of keys stays within it, and only lowers its rate.
+ */
+
+#define N 60000
+
+/* keys of the trace are below KEYS */
+#define KEYS 20000
+
+#define SMAX 1000
+
+static void check_exact(enum mnemo_reuse_engine engine,
+			const unsigned long long *keys, const int64_t *ref)
+{
+	struct mnemo_reusedm *r = mnemo_reusedm_init_sampled(0, engine, 1.0, 0);
+	int64_t *out = malloc(N * sizeof(*out));
+
+	check(out != NULL);
+	check(mnemo_reusedm_rate(r) == 1.0);
+	mnemo_reusedm_add_batch(r, keys, N, out);
+	for (size_t i = 0; i < N; i++)
+		check(out[i] == ref[i]);
+	check(mnemo_reusedm_rate(r) == 1.0);
+	mnemo_reusedm_fini(r);
+	free(out);
+}
+
+static void check_fixed(enum mnemo_reuse_engine engine, double rate,
+			const unsigned long long *keys)
+{
+	struct mnemo_reusedm *r = mnemo_reusedm_init_sampled(0, engine, rate, 0);
+	struct mnemo_reusedm *single = mnemo_reusedm_init_sampled(0, engine,
+								   rate, 0);
+	int64_t *out = malloc(N * sizeof(*out)), *ref;
+	unsigned long long *tracked = malloc(N * sizeof(*tracked));
+	static int sampled[KEYS];
+	size_t ntracked = 0, nsampled = 0, nkeys = 0;
+	double expected;
+
+	check(out != NULL && tracked != NULL);
+	check(mnemo_reusedm_rate(r) >= rate - 1e-12 &&
+	      mnemo_reusedm_rate(r) <= rate + 1e-12);
+	rate = mnemo_reusedm_rate(r);
+	mnemo_reusedm_add_batch(r, keys, N, out);
+	check(mnemo_reusedm_rate(r) == rate);
+
+	/* sampling is spatial, and does not depend on the way keys are added */
+	memset(sampled, 0, sizeof(sampled));
+	for (size_t i = 0; i < N; i++) {
+		int s = out[i] != MNEMO_REUSE_SKIPPED;
+
+		check(mnemo_reusedm_add(single, keys[i]) == out[i]);
+		if (sampled[keys[i]] == 0) {
+			sampled[keys[i]] = s ? 1 : -1;
+			nkeys++;
+			nsampled += s;
+		}
+		check(sampled[keys[i]] == (s ? 1 : -1));
+		if (s)
+			tracked[ntracked++] = keys[i];
+	}
+	mnemo_reusedm_fini(single);
+	check(mnemo_reusedm_nkeys(r) == nsampled);
+
+	/* within 6 standard deviations of the expected number of keys */
+	expected = rate * nkeys;
+	check((nsampled - expected) * (nsampled - expected) <=
+	      36 * expected * (1 - rate));
+
+	ref = ref_distances(tracked, ntracked);
+	for (size_t i = 0, j = 0; i < N; i++) {
+		if (out[i] == MNEMO_REUSE_SKIPPED)
+			continue;
+		if (ref[j] <= 0)
+			check(out[i] == ref[j]);
+		else
+			check(out[i] == (int64_t)(ref[j] / rate));
+		j++;
+	}
+	mnemo_reusedm_fini(r);
+	free(out);
+	free(ref);
+	free(tracked);
+}
+
+static void check_budget(enum mnemo_reuse_engine engine,
+			 const unsigned long long *keys)
+{
+	struct mnemo_reusedm *r;
+	static int skipped[KEYS];
+	double rate = 1.0;
+
+	r = mnemo_reusedm_init_sampled(0, engine, 1.0, SMAX);
+	memset(skipped, 0, sizeof(skipped));
+	for (size_t i = 0; i < N; i++) {
+		int64_t d = mnemo_reusedm_add(r, keys[i]);
+
+		/* forgotten keys stay out of the sample */
+		check(!skipped[keys[i]] || d == MNEMO_REUSE_SKIPPED);
+		skipped[keys[i]] = d == MNEMO_REUSE_SKIPPED;
+		check(mnemo_reusedm_nkeys(r) <= SMAX);
+		check(mnemo_reusedm_rate(r) <= rate);
+		rate = mnemo_reusedm_rate(r);
+	}
+	/* all the keys of the trace are over budget */
+	check(rate < 1.0 && mnemo_reusedm_nkeys(r) >= SMAX / 2);
+	mnemo_reusedm_fini(r);
+}
+
+int main(void)
+{
+	unsigned long long *keys = ref_trace(N, KEYS, 42);
+	int64_t *ref = ref_distances(keys, N);
+
+	check_exact(MNEMO_REUSE_SPLAY, keys, ref);
+	check_exact(MNEMO_REUSE_FENWICK, keys, ref);
+	check_fixed(MNEMO_REUSE_SPLAY, 0.25, keys);
+	check_fixed(MNEMO_REUSE_FENWICK, 0.25, keys);
+	check_fixed(MNEMO_REUSE_SPLAY, 0.01, keys);
+	check_budget(MNEMO_REUSE_SPLAY, keys);
+	check_budget(MNEMO_REUSE_FENWICK, keys);
+	free(keys);
+	free(ref);
+	return EXIT_SUCCESS;
+}
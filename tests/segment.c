@@ -0,0 +1,144 @@
+#include "reference.h"
+
+/* Check segment summaries: a trace cut into segments, some of them empty or a
+ * single access long, summarized separately and merged back in trace order,
+ * must give the histogram of a single replay, bin for bin, whatever the order
+ * of the merges and whether segments went through files. The merged segment
+ * must then go on like the replay.
+ */
+
+#define N 30000
+
+/* bins of width 1, so that histograms hold all the distances of the trace */
+#define NBINS 4001
+
+#define PATH "segment-test.seg"
+#define TRACE_PATH "segment-test.mtr"
+
+static const size_t cuts[] = { 0, 1, 7000, 7000, 15000, 29999, N };
+
+#define NSEGMENTS (sizeof(cuts) / sizeof(cuts[0]) - 1)
+
+static struct mnemo_segment *segment(void)
+{
+	return mnemo_segment_init(0, MNEMO_HISTOGRAM_LINEAR, NBINS, 1);
+}
+
+static void check_histogram(const struct mnemo_histogram *h,
+			    const struct mnemo_histogram *ref)
+{
+	check(mnemo_histogram_nbins(h) == mnemo_histogram_nbins(ref));
+	check(mnemo_histogram_cold(h) == mnemo_histogram_cold(ref));
+	for (size_t b = 0; b < mnemo_histogram_nbins(ref); b++)
+		check(mnemo_histogram_bins(h)[b] ==
+		      mnemo_histogram_bins(ref)[b]);
+}
+
+/* save a segment to a file and load it back, in place of the original */
+static struct mnemo_segment *reload(struct mnemo_segment *s)
+{
+	struct mnemo_segment *ret;
+
+	check(mnemo_segment_save(s, PATH) == 0);
+	ret = mnemo_segment_load(PATH);
+	check(ret != NULL);
+	check(mnemo_segment_accesses(ret) == mnemo_segment_accesses(s));
+	check(mnemo_segment_nkeys(ret) == mnemo_segment_nkeys(s));
+	check_histogram(mnemo_segment_histogram(ret),
+			mnemo_segment_histogram(s));
+	mnemo_segment_fini(s);
+	return ret;
+}
+
+int main(void)
+{
+	unsigned long long *keys = malloc(N * sizeof(*keys)), state = 42;
+	struct mnemo_segment *s[NSEGMENTS];
+	struct mnemo_histogram *h;
+	struct mnemo_reusedm *r;
+	struct mnemo_trace_writer *w;
+	struct mnemo_trace *t;
+
+	check(keys != NULL);
+	for (size_t i = 0; i < N; i++)
+		keys[i] = ref_next(&state) % (i % 3 ? 500 : 4000);
+	r = mnemo_reusedm_init(0);
+	h = mnemo_histogram_init(MNEMO_HISTOGRAM_LINEAR, NBINS, 1);
+	mnemo_reusedm_attach(r, h);
+	mnemo_reusedm_add_batch(r, keys, N, NULL);
+
+	/* merged left to right */
+	for (size_t i = 0; i < NSEGMENTS; i++) {
+		s[i] = segment();
+		mnemo_segment_add_batch(s[i], &keys[cuts[i]],
+					cuts[i + 1] - cuts[i]);
+	}
+	for (size_t i = 1; i < NSEGMENTS; i++) {
+		mnemo_segment_merge(s[0], s[i]);
+		mnemo_segment_fini(s[i]);
+	}
+	check(mnemo_segment_accesses(s[0]) == N);
+	check(mnemo_segment_nkeys(s[0]) == mnemo_reusedm_nkeys(r));
+	check_histogram(mnemo_segment_histogram(s[0]), h);
+	mnemo_segment_fini(s[0]);
+
+	/* merged as a tree, through files */
+	for (size_t i = 0; i < NSEGMENTS; i++) {
+		s[i] = segment();
+		mnemo_segment_add_batch(s[i], &keys[cuts[i]],
+					cuts[i + 1] - cuts[i]);
+		s[i] = reload(s[i]);
+	}
+	for (size_t step = 1; step < NSEGMENTS; step *= 2) {
+		for (size_t i = 0; i + step < NSEGMENTS; i += 2 * step) {
+			mnemo_segment_merge(s[i], s[i + step]);
+			mnemo_segment_fini(s[i + step]);
+			s[i] = reload(s[i]);
+		}
+	}
+	check_histogram(mnemo_segment_histogram(s[0]), h);
+
+	/* the merged segment goes on like the replay */
+	mnemo_segment_add_batch(s[0], keys, N / 2);
+	mnemo_reusedm_add_batch(r, keys, N / 2, NULL);
+	check_histogram(mnemo_segment_histogram(s[0]), h);
+	mnemo_segment_fini(s[0]);
+
+	/* ranges of blocks of a trace file, the last one running past its end */
+	w = mnemo_trace_writer_open(TRACE_PATH, 1000);
+	check(w != NULL);
+	check(mnemo_trace_writer_add(w, keys, N) == 0);
+	check(mnemo_trace_writer_close(w) == 0);
+	t = mnemo_trace_open(TRACE_PATH);
+	check(t != NULL && mnemo_trace_nblocks(t) == 30);
+	s[0] = segment();
+	check(mnemo_segment_from_trace(s[0], t, 0, 7) == 0);
+	s[1] = segment();
+	check(mnemo_segment_from_trace(s[1], t, 7, 30) == 0);
+	mnemo_segment_merge(s[0], s[1]);
+	mnemo_segment_fini(s[1]);
+	mnemo_trace_close(t);
+	unlink(TRACE_PATH);
+	mnemo_reusedm_reset(r);
+	mnemo_histogram_reset(h);
+	mnemo_reusedm_add_batch(r, keys, N, NULL);
+	check_histogram(mnemo_segment_histogram(s[0]), h);
+
+	/* malformed files */
+	check(mnemo_segment_save(s[0], PATH) == 0);
+	check(truncate(PATH, 100) == 0);
+	errno = 0;
+	check(mnemo_segment_load(PATH) == NULL && errno == EINVAL);
+	check(truncate(PATH, 10) == 0);
+	errno = 0;
+	check(mnemo_segment_load(PATH) == NULL && errno == EINVAL);
+	unlink(PATH);
+	errno = 0;
+	check(mnemo_segment_load(PATH) == NULL && errno == ENOENT);
+
+	mnemo_segment_fini(s[0]);
+	mnemo_reusedm_fini(r);
+	mnemo_histogram_fini(h);
+	free(keys);
+	return EXIT_SUCCESS;
+}
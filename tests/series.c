@@ -0,0 +1,130 @@
+#include "reference.h"
+
+/* Check series of snapshots: intervals end every given number of accesses, and
+ * on marks unless they are empty, skipped accesses included. The snapshot of
+ * an interval is the histogram of the distances of its accesses, so that the
+ * snapshots of a trace sum up to the histogram of a manager that takes none,
+ * with or without sampling.
+ */
+
+#define N 50123
+
+/* keys of the trace are below KEYS */
+#define KEYS 3000
+
+#define LENGTH 1000
+#define NBINS 16
+
+/* sums of weights depend on the order of the additions */
+static int close_to(double a, double b)
+{
+	return a - b <= 1e-9 * b && b - a <= 1e-9 * b;
+}
+
+/* marks at random, sometimes twice in a row */
+static int marked(unsigned long long *state)
+{
+	return ref_next(state) % 4 == 0;
+}
+
+static void check_series(double rate, const unsigned long long *keys)
+{
+	struct mnemo_reusedm *r, *ref;
+	struct mnemo_histogram *h, *href, *interval;
+	struct mnemo_series *s = mnemo_series_init();
+	int64_t *out = malloc(N * sizeof(*out));
+	double *sum = calloc(NBINS, sizeof(*sum)), cold = 0.0;
+	unsigned long long state = 42, start = 0;
+	size_t count = 0, nmarks = 0;
+
+	check(out != NULL && sum != NULL);
+	check(mnemo_series_count(s) == 0 && mnemo_series_nbins(s) == 0);
+	r = mnemo_reusedm_init_sampled(0, MNEMO_REUSE_SPLAY, rate, 0);
+	ref = mnemo_reusedm_init_sampled(0, MNEMO_REUSE_SPLAY, rate, 0);
+	h = mnemo_histogram_init(MNEMO_HISTOGRAM_LOG2, NBINS, 0);
+	href = mnemo_histogram_init(MNEMO_HISTOGRAM_LOG2, NBINS, 0);
+	interval = mnemo_histogram_init(MNEMO_HISTOGRAM_LOG2, NBINS, 0);
+	mnemo_reusedm_attach(r, h);
+	mnemo_reusedm_attach(ref, href);
+	mnemo_reusedm_intervals(r, s, LENGTH);
+	mnemo_reusedm_add_batch(ref, keys, N, NULL);
+	rate = mnemo_reusedm_rate(r);
+
+	/* batches cut at the marks, and single accesses in between */
+	for (size_t i = 0, len; i < N; i += len) {
+		len = ref_next(&state) % 3000 + 1;
+		if (len > N - i)
+			len = N - i;
+		if (ref_next(&state) % 2)
+			mnemo_reusedm_add_batch(r, &keys[i], len, &out[i]);
+		else
+			for (size_t j = i; j < i + len; j++)
+				out[j] = mnemo_reusedm_add64(r, keys[j]);
+		for (; marked(&state); nmarks++)
+			mnemo_reusedm_mark(r);
+	}
+	/* the last interval is closed by a mark, and not by the next one */
+	mnemo_reusedm_mark(r);
+	mnemo_reusedm_mark(r);
+	check(mnemo_series_nbins(s) == NBINS);
+
+	/* each snapshot is the histogram of the accesses of its interval */
+	for (size_t i = 0; i < mnemo_series_count(s); i++) {
+		unsigned long long len = mnemo_series_length(s, i);
+
+		check(mnemo_series_start(s, i) == start);
+		check(len > 0 && len <= LENGTH);
+		/* intervals only end early on marks */
+		count += len != LENGTH;
+		mnemo_histogram_reset(interval);
+		for (unsigned long long j = start; j < start + len; j++)
+			mnemo_histogram_add(interval, out[j], 1.0 / rate);
+		check(mnemo_series_cold(s, i) == mnemo_histogram_cold(interval));
+		for (size_t b = 0; b < NBINS; b++) {
+			check(mnemo_series_bins(s, i)[b] ==
+			      mnemo_histogram_bins(interval)[b]);
+			sum[b] += mnemo_series_bins(s, i)[b];
+		}
+		cold += mnemo_series_cold(s, i);
+		start += len;
+	}
+	check(start == N);
+	check(count > 1 && count <= nmarks + 1);
+	check(mnemo_series_count(s) >= N / LENGTH);
+
+	/* snapshots restart the histogram from zero, and sum up to the whole */
+	check(mnemo_histogram_cold(h) == 0.0);
+	check(close_to(cold, mnemo_histogram_cold(href)));
+	for (size_t b = 0; b < NBINS; b++) {
+		check(mnemo_histogram_bins(h)[b] == 0.0);
+		check(close_to(sum[b], mnemo_histogram_bins(href)[b]));
+	}
+
+	/* no snapshots once detached, nor in a reset series */
+	count = mnemo_series_count(s);
+	mnemo_reusedm_intervals(r, NULL, 0);
+	mnemo_reusedm_add_batch(r, keys, 2 * LENGTH, NULL);
+	mnemo_reusedm_mark(r);
+	check(mnemo_series_count(s) == count);
+	mnemo_series_reset(s);
+	check(mnemo_series_count(s) == 0);
+
+	mnemo_reusedm_fini(r);
+	mnemo_reusedm_fini(ref);
+	mnemo_histogram_fini(h);
+	mnemo_histogram_fini(href);
+	mnemo_histogram_fini(interval);
+	mnemo_series_fini(s);
+	free(out);
+	free(sum);
+}
+
+int main(void)
+{
+	unsigned long long *keys = ref_trace(N, KEYS, 42);
+
+	check_series(1.0, keys);
+	check_series(0.25, keys);
+	free(keys);
+	return EXIT_SUCCESS;
+}
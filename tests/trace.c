@@ -0,0 +1,314 @@
+#include "reference.h"
+
+#include <internal/endian.h>
+
+#include <sys/stat.h>
+
+/* Check trace files: the keys of raw and compressed traces decode block by
+ * block to the keys written, and adding a trace to a reuse distance manager
+ * gives the distances of mnemo_reusedm_add_batch, in memory and in the output
+ * file. Raw traces span several windows of the batch loop. Compressed traces
+ * mix keys of all sizes, and malformed headers, indexes and blocks must be
+ * rejected, including headers whose counts would overflow.
+ */
+
+/* one window of a raw trace, and a partial one */
+#define N ((1 << 20) + 4321)
+
+#define PATH "trace-test.trc"
+#define OUT_PATH "trace-test.out"
+
+/* size of the index of a compressed trace */
+#define INDEX(nblocks) (((nblocks) + 1) * 8)
+
+static unsigned long long *trace(size_t n)
+{
+	unsigned long long *ret = ref_trace(n, 70000, 42), state = 7;
+
+	/* cache lines, and a few keys far apart */
+	for (size_t i = 0; i < n; i++)
+		ret[i] = i % 97 == 0 ? ref_next(&state) : ret[i] << 6;
+	return ret;
+}
+
+/* distances of a trace in a single batch, counted in a histogram */
+static int64_t *distances(const unsigned long long *keys, size_t n,
+			  struct mnemo_histogram **h)
+{
+	struct mnemo_reusedm *r = mnemo_reusedm_init(0);
+	int64_t *ret = malloc(n * sizeof(*ret));
+
+	check(ret != NULL);
+	*h = mnemo_histogram_init(MNEMO_HISTOGRAM_LOG2, 40, 0);
+	mnemo_reusedm_attach(r, *h);
+	mnemo_reusedm_add_batch(r, keys, n, ret);
+	mnemo_reusedm_fini(r);
+	return ret;
+}
+
+static void write_file(const char *path, const void *buf, size_t size)
+{
+	FILE *f = fopen(path, "wb");
+
+	check(f != NULL);
+	check(size == 0 || fwrite(buf, size, 1, f) == 1);
+	check(fclose(f) == 0);
+}
+
+/* overwrite a 64-bit word of a file */
+static void corrupt(long offset, uint64_t value)
+{
+	unsigned char word[8];
+	FILE *f = fopen(PATH, "r+b");
+
+	mnemo_put64(word, value);
+	check(f != NULL);
+	check(fseek(f, offset, SEEK_SET) == 0);
+	check(fwrite(word, sizeof(word), 1, f) == 1);
+	check(fclose(f) == 0);
+}
+
+/* the blocks of a trace must decode to its keys, and the trace must give the
+ * distances of a batch, in the output file too.
+ */
+static void check_trace(const unsigned long long *keys, size_t n,
+			size_t nblocks)
+{
+	struct mnemo_histogram *ref, *h;
+	struct mnemo_reusedm *r;
+	struct mnemo_trace *t;
+	int64_t *dist = distances(keys, n, &ref);
+	unsigned long long *buf = malloc((n + 1) * sizeof(*buf));
+	unsigned char word[8];
+	size_t i = 0;
+	FILE *f;
+
+	check(buf != NULL);
+	t = mnemo_trace_open(PATH);
+	check(t != NULL);
+	check(mnemo_trace_length(t) == n);
+	check(mnemo_trace_nblocks(t) == nblocks);
+	for (size_t b = 0; b < nblocks; b++) {
+		size_t len = mnemo_trace_block_length(t, b);
+
+		check(len > 0 && (b + 1 == nblocks ||
+				  len == mnemo_trace_block_length(t, 0)));
+		check(mnemo_trace_decode(t, b, &buf[i]) == 0);
+		i += len;
+	}
+	check(i == n);
+	check(n == 0 || !memcmp(buf, keys, n * sizeof(*keys)));
+
+	r = mnemo_reusedm_init(0);
+	h = mnemo_histogram_init(MNEMO_HISTOGRAM_LOG2, 40, 0);
+	mnemo_reusedm_attach(r, h);
+	check(mnemo_reuse_from_trace(r, t, OUT_PATH) == 0);
+	check(mnemo_reusedm_nkeys(r) == mnemo_histogram_cold(ref));
+	check(mnemo_histogram_cold(h) == mnemo_histogram_cold(ref));
+	for (size_t b = 0; b < 40; b++)
+		check(mnemo_histogram_bins(h)[b] ==
+		      mnemo_histogram_bins(ref)[b]);
+	f = fopen(OUT_PATH, "rb");
+	check(f != NULL);
+	for (i = 0; fread(word, sizeof(word), 1, f) == 1; i++)
+		check(i < n && (int64_t)mnemo_get64(word) == dist[i]);
+	check(i == n && fclose(f) == 0);
+	unlink(OUT_PATH);
+
+	/* without an output, after a reset */
+	mnemo_reusedm_reset(r);
+	mnemo_histogram_reset(h);
+	check(mnemo_reuse_from_trace(r, t, NULL) == 0);
+	check(mnemo_histogram_cold(h) == mnemo_histogram_cold(ref));
+	mnemo_trace_close(t);
+	mnemo_reusedm_fini(r);
+	mnemo_histogram_fini(h);
+	mnemo_histogram_fini(ref);
+	free(dist);
+	free(buf);
+}
+
+static void check_raw(const unsigned long long *keys)
+{
+	unsigned char *raw = malloc(N * 8);
+
+	check(raw != NULL);
+	for (size_t i = 0; i < N; i++)
+		mnemo_put64(&raw[i * 8], keys[i]);
+	write_file(PATH, raw, N * 8);
+	check_trace(keys, N, 2);
+	write_file(PATH, raw, 8 * 1000);
+	check_trace(keys, 1000, 1);
+	write_file(PATH, raw, 0);
+	check_trace(keys, 0, 0);
+
+	/* not a whole number of keys */
+	write_file(PATH, raw, 8 * 1000 + 3);
+	errno = 0;
+	check(mnemo_trace_open(PATH) == NULL && errno == EINVAL);
+	unlink(PATH);
+	errno = 0;
+	check(mnemo_trace_open(PATH) == NULL && errno == ENOENT);
+	free(raw);
+}
+
+/* write a compressed trace in pieces of varying sizes */
+static void write_compressed(const unsigned long long *keys, size_t n,
+			     size_t blocksize)
+{
+	struct mnemo_trace_writer *w = mnemo_trace_writer_open(PATH, blocksize);
+
+	check(w != NULL);
+	for (size_t i = 0, len = 1; i < n; i += len, len = 3 * len + 1) {
+		if (len > n - i)
+			len = n - i;
+		check(mnemo_trace_writer_add(w, &keys[i], len) == 0);
+	}
+	check(mnemo_trace_writer_add(w, keys, 0) == 0);
+	check(mnemo_trace_writer_close(w) == 0);
+}
+
+static void check_compressed(const unsigned long long *keys)
+{
+	write_compressed(keys, N, 0);
+	check_trace(keys, N, (N + 65535) / 65536);
+	write_compressed(keys, 100000, 1000);
+	check_trace(keys, 100000, 100);
+	write_compressed(keys, 1, 1);
+	check_trace(keys, 1, 1);
+	write_compressed(keys, 0, 10);
+	check_trace(keys, 0, 0);
+#if SIZE_MAX > UINT32_MAX
+	errno = 0;
+	check(mnemo_trace_writer_open(PATH, (size_t)UINT32_MAX + 1) == NULL &&
+	      errno == EINVAL);
+#endif
+}
+
+static void check_open_rejected(void)
+{
+	errno = 0;
+	check(mnemo_trace_open(PATH) == NULL && errno == EINVAL);
+}
+
+/* a compressed trace of 3 blocks of 4 random keys, which take all the bytes
+ * of their varints.
+ */
+static void check_rejected(void)
+{
+	unsigned long long keys[10], buf[4], state = 3;
+	unsigned char header[48];
+	struct mnemo_trace *t;
+	struct mnemo_reusedm *r;
+	struct stat st;
+	long index;
+
+	for (size_t i = 0; i < 10; i++)
+		keys[i] = ref_next(&state) | 1ULL << 63;
+	write_compressed(keys, 10, 4);
+	check(stat(PATH, &st) == 0);
+	index = st.st_size - INDEX(3);
+
+	/* bad versions, block sizes, counts and index offsets */
+	corrupt(8, 2 | (uint64_t)4 << 32);
+	check_open_rejected();
+	corrupt(8, 1);
+	check_open_rejected();
+	corrupt(8, 1 | (uint64_t)4 << 32);
+	corrupt(16, 13);
+	check_open_rejected();
+	corrupt(16, 8);
+	check_open_rejected();
+	corrupt(16, 0);
+	check_open_rejected();
+	corrupt(16, 12);
+	corrupt(24, 2);
+	check_open_rejected();
+	corrupt(24, 4);
+	check_open_rejected();
+	corrupt(24, UINT64_MAX);
+	check_open_rejected();
+	corrupt(24, 3);
+	corrupt(32, index - 8);
+	check_open_rejected();
+	corrupt(32, index + 4);
+	check_open_rejected();
+	corrupt(32, 8);
+	check_open_rejected();
+	corrupt(32, index);
+	t = mnemo_trace_open(PATH);
+	check(t != NULL && mnemo_trace_length(t) == 12);
+	mnemo_trace_close(t);
+
+	/* headers of empty traces, whose counts overflow: the index would have
+	 * 2^64 entries, or the number of blocks wraps to 0 past the last key.
+	 */
+	memset(header, 0, sizeof(header));
+	memcpy(header, "MNEMOTRC", 8);
+	mnemo_put64(&header[8], 1 | (uint64_t)1 << 32);
+	mnemo_put64(&header[16], UINT64_MAX);
+	mnemo_put64(&header[24], UINT64_MAX);
+	mnemo_put64(&header[32], 40);
+	write_file(PATH, header, 40);
+	check_open_rejected();
+	mnemo_put64(&header[8], 1 | (uint64_t)4 << 32);
+	mnemo_put64(&header[16], UINT64_MAX - 1);
+	mnemo_put64(&header[24], 0);
+	mnemo_put64(&header[40], 40);
+	write_file(PATH, header, 48);
+	check_open_rejected();
+	mnemo_put64(&header[16], 0);
+	write_file(PATH, header, 48);
+	t = mnemo_trace_open(PATH);
+	check(t != NULL && mnemo_trace_length(t) == 0);
+	check(mnemo_trace_nblocks(t) == 0);
+	mnemo_trace_close(t);
+
+	/* truncated traces */
+	write_compressed(keys, 10, 4);
+	check(truncate(PATH, st.st_size - 8) == 0);
+	check_open_rejected();
+	check(truncate(PATH, 39) == 0);
+	check_open_rejected();
+
+	/* corrupted indexes and blocks are only found once decoded */
+	write_compressed(keys, 10, 4);
+	corrupt(index + 8, index);
+	t = mnemo_trace_open(PATH);
+	check(t != NULL);
+	check(mnemo_trace_decode(t, 0, buf) == -EINVAL);
+	check(mnemo_trace_decode(t, 1, buf) == -EINVAL);
+	check(mnemo_trace_decode(t, 2, buf) == 0);
+	mnemo_trace_close(t);
+	write_compressed(keys, 10, 4);
+	corrupt(index, 0);
+	t = mnemo_trace_open(PATH);
+	check(t != NULL && mnemo_trace_decode(t, 0, buf) == -EINVAL);
+	mnemo_trace_close(t);
+	write_compressed(keys, 10, 4);
+	/* continuation bits past the end of the last block */
+	corrupt(index - 8, UINT64_MAX);
+	t = mnemo_trace_open(PATH);
+	check(t != NULL);
+	check(mnemo_trace_decode(t, 1, buf) == 0);
+	check(!memcmp(buf, &keys[4], sizeof(buf)));
+	check(mnemo_trace_decode(t, 2, buf) == -EINVAL);
+	r = mnemo_reusedm_init(0);
+	check(mnemo_reuse_from_trace(r, t, NULL) == -EINVAL);
+	/* the blocks before the corrupted one are added */
+	check(mnemo_reusedm_nkeys(r) == 8);
+	mnemo_reusedm_fini(r);
+	mnemo_trace_close(t);
+	unlink(PATH);
+}
+
+int main(void)
+{
+	unsigned long long *keys = trace(N);
+
+	check_raw(keys);
+	check_compressed(keys);
+	check_rejected();
+	free(keys);
+	return EXIT_SUCCESS;
+}